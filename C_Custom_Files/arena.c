@@ -0,0 +1,120 @@
+#include "arena.h"
+#include <sys/mman.h>
+
+#define ARENA_PAGE_BYTES 4096
+
+static bool use_huge_pages = false;
+
+void arena_set_huge_pages(bool enabled) {
+    use_huge_pages = enabled;
+}
+
+static size_t round_up(size_t bytes, size_t multiple) {
+    return (bytes + multiple - 1) / multiple * multiple;
+}
+
+// Map a zeroed block with room for at least bytes after the header. Huge
+// pages are tried first when enabled; without reserved huge pages the
+// mapping fails and normal pages are used instead.
+static ArenaBlock* map_block(size_t bytes) {
+    size_t mapped = round_up(sizeof(ArenaBlock) + bytes, ARENA_PAGE_BYTES);
+    void* memory = MAP_FAILED;
+#ifdef MAP_HUGETLB
+    if (use_huge_pages) {
+        size_t huge = round_up(mapped, ARENA_HUGE_PAGE_BYTES);
+        memory = mmap(NULL, huge, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (memory != MAP_FAILED) mapped = huge;
+    }
+#endif
+    if (memory == MAP_FAILED) {
+        memory = mmap(NULL, mapped, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (memory == MAP_FAILED) return NULL;
+    }
+
+    ArenaBlock* block = memory;
+    block->next = NULL;
+    block->used = 0;
+    block->size = mapped - sizeof(ArenaBlock);
+    block->mapped = mapped;
+    return block;
+}
+
+// Arenas map nothing until the first allocation
+void arena_init(Arena* arena, size_t block_size) {
+    arena->blocks = NULL;
+    arena->block_size = block_size;
+    arena->reserved = 0;
+    for (size_t i = 0; i < ARENA_SIZE_CLASSES; i++) arena->free_lists[i] = NULL;
+}
+
+// Allocate bytes: reuse a freed block of the same size class, else bump the
+// newest block, else map another. Allocations over a quarter of a block get
+// a mapping of their own so they don't strand the rest of the current one.
+void* arena_alloc(Arena* arena, size_t bytes) {
+    size_t size = bytes ? round_up(bytes, ARENA_ALIGN) : ARENA_ALIGN;
+    size_t size_class = size / ARENA_ALIGN - 1;
+    if (size_class < ARENA_SIZE_CLASSES && arena->free_lists[size_class]) {
+        void* reused = arena->free_lists[size_class];
+        arena->free_lists[size_class] = *(void**)reused;
+        return reused;
+    }
+
+    ArenaBlock* head = arena->blocks;
+    if (!head || head->size - head->used < size) {
+        bool dedicated = size > arena->block_size / 4;
+        ArenaBlock* block = map_block(dedicated ? size : arena->block_size - sizeof(ArenaBlock));
+        if (!block) return NULL;
+        arena->reserved += block->mapped;
+        if (dedicated && head) {
+            // Keep bumping the current block; the new one is already full
+            block->next = head->next;
+            head->next = block;
+            block->used = size;
+            return block->data;
+        }
+        block->next = head;
+        arena->blocks = head = block;
+    }
+    void* pointer = head->data + head->used;
+    head->used += size;
+    return pointer;
+}
+
+// Return an allocation of the given size for reuse. Sizes past the last
+// free list stay put until the arena is released.
+void arena_free(Arena* arena, void* pointer, size_t bytes) {
+    if (!pointer) return;
+    size_t size = bytes ? round_up(bytes, ARENA_ALIGN) : ARENA_ALIGN;
+    size_t size_class = size / ARENA_ALIGN - 1;
+    if (size_class >= ARENA_SIZE_CLASSES) return;
+    *(void**)pointer = arena->free_lists[size_class];
+    arena->free_lists[size_class] = pointer;
+}
+
+// Take over every block of from, leaving it empty; from's free lists are
+// dropped. The current block keeps being bumped from.
+void arena_adopt(Arena* arena, Arena* from) {
+    if (from->blocks) {
+        ArenaBlock* last = from->blocks;
+        while (last->next) last = last->next;
+        if (arena->blocks) {
+            last->next = arena->blocks->next;
+            arena->blocks->next = from->blocks;
+        } else {
+            arena->blocks = from->blocks;
+        }
+        arena->reserved += from->reserved;
+    }
+    arena_init(from, from->block_size);
+}
+
+// Unmap every block: the cost is one call per block, not per allocation
+void arena_release(Arena* arena) {
+    ArenaBlock* block = arena->blocks;
+    while (block) {
+        ArenaBlock* next = block->next;
+        munmap(block, block->mapped);
+        block = next;
+    }
+    arena_init(arena, arena->block_size);
+}
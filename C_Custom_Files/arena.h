@@ -0,0 +1,41 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stddef.h>
+#include <stdbool.h>
+
+#define ARENA_ALIGN 16                  // Every allocation is 16-byte aligned
+#define ARENA_SIZE_CLASSES 16           // Free lists for freed blocks up to 256 bytes
+#define ARENA_HUGE_PAGE_BYTES (2u << 20)
+
+// One mapping that allocations are bump-allocated from
+typedef struct ArenaBlock {
+    struct ArenaBlock* next;
+    size_t used;
+    size_t size;                // Usable bytes after the header
+    size_t mapped;              // Bytes mapped, header included
+    char data[];
+} ArenaBlock;
+
+// Bump allocator over large mappings. Small freed allocations go on a free
+// list per 16-byte size class and are handed out again before new space;
+// releasing the arena unmaps block by block, never allocation by allocation.
+typedef struct {
+    ArenaBlock* blocks;         // Newest first; the head is bumped from
+    size_t block_size;          // Bytes mapped per block
+    size_t reserved;            // Bytes mapped across all blocks
+    void* free_lists[ARENA_SIZE_CLASSES];
+} Arena;
+
+// Back blocks with MAP_HUGETLB pages where the system has them reserved
+// (falls back to normal pages otherwise). Set before creating arenas.
+void arena_set_huge_pages(bool enabled);
+
+// Function prototypes
+void arena_init(Arena* arena, size_t block_size);
+void* arena_alloc(Arena* arena, size_t bytes);
+void arena_free(Arena* arena, void* pointer, size_t bytes);
+void arena_adopt(Arena* arena, Arena* from);
+void arena_release(Arena* arena);
+
+#endif // ARENA_H
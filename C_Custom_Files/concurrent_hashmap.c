@@ -0,0 +1,97 @@
+#include "concurrent_hashmap.h"
+#include <string.h>
+#include <stdlib.h>
+
+// Pick a shard from the top bits of the mixed key hash. Each shard's slot comes
+// from bits 32 and up of the same product, so the two stay independent until a
+// shard outgrows 2^(32 - shard bits) slots.
+static inline HashMapShard* shard_for(ConcurrentHashMap* map, const HashMapKey* key) {
+    uint64_t h = (uint64_t)hashmap_key_hash(key) * 0x9E3779B97F4A7C15ULL;
+    return &map->shards[map->shard_count == 1 ? 0 : (size_t)(h >> map->shard_shift)];
+}
+
+// Create a map with shard_count stripes (rounded up to a power of two)
+ConcurrentHashMap* chashmap_create(size_t capacity, size_t shard_count) {
+    ConcurrentHashMap* map = malloc(sizeof(ConcurrentHashMap));
+    if (!map) return NULL;
+
+    size_t shards = 1;
+    unsigned bits = 0;
+    while (shards < shard_count) {
+        shards <<= 1;
+        bits++;
+    }
+    map->shard_count = shards;
+    map->shard_shift = 64 - bits;
+    if (posix_memalign((void**)&map->shards, CHASHMAP_CACHE_LINE, shards * sizeof(HashMapShard)) != 0) {
+        free(map);
+        return NULL;
+    }
+
+    size_t per_shard = capacity / shards + 1;
+    for (size_t i = 0; i < shards; i++) {
+        map->shards[i].map = hashmap_create(per_shard);
+        if (!map->shards[i].map) {
+            map->shard_count = i;
+            chashmap_destroy(map);
+            return NULL;
+        }
+        pthread_mutex_init(&map->shards[i].lock, NULL);
+    }
+    return map;
+}
+
+void chashmap_destroy(ConcurrentHashMap* map) {
+    if (!map) return;
+    for (size_t i = 0; i < map->shard_count; i++) {
+        pthread_mutex_destroy(&map->shards[i].lock);
+        hashmap_destroy(map->shards[i].map);
+    }
+    free(map->shards);
+    free(map);
+}
+
+bool chashmap_set(ConcurrentHashMap* map, const HashMapKey* key, uint16_t value1, uint16_t value2, int32_t latitude, int32_t longitude) {
+    HashMapShard* shard = shard_for(map, key);
+    pthread_mutex_lock(&shard->lock);
+    bool ok = hashmap_set_key(shard->map, key, value1, value2, latitude, longitude);
+    pthread_mutex_unlock(&shard->lock);
+    return ok;
+}
+
+bool chashmap_get(ConcurrentHashMap* map, const HashMapKey* key, uint16_t* value1, uint16_t* value2, int32_t* latitude, int32_t* longitude) {
+    HashMapShard* shard = shard_for(map, key);
+    pthread_mutex_lock(&shard->lock);
+    bool found = hashmap_get_key(shard->map, key, value1, value2, latitude, longitude);
+    pthread_mutex_unlock(&shard->lock);
+    return found;
+}
+
+bool chashmap_delete(ConcurrentHashMap* map, const HashMapKey* key) {
+    HashMapShard* shard = shard_for(map, key);
+    pthread_mutex_lock(&shard->lock);
+    bool removed = hashmap_delete_key(shard->map, key);
+    pthread_mutex_unlock(&shard->lock);
+    return removed;
+}
+
+// Atomic read-merge-write of one key: the merge callback sees and edits the
+// current values while the shard is held, so concurrent upserts never interleave
+bool chashmap_upsert(ConcurrentHashMap* map, const HashMapKey* key, HashMapMergeFn merge, void* context) {
+    HashMapShard* shard = shard_for(map, key);
+    pthread_mutex_lock(&shard->lock);
+    bool ok = hashmap_upsert(shard->map, key, merge, context);
+    pthread_mutex_unlock(&shard->lock);
+    return ok;
+}
+
+// Total entries; only exact when no writers are running
+size_t chashmap_size(ConcurrentHashMap* map) {
+    size_t size = 0;
+    for (size_t i = 0; i < map->shard_count; i++) {
+        pthread_mutex_lock(&map->shards[i].lock);
+        size += map->shards[i].map->size;
+        pthread_mutex_unlock(&map->shards[i].lock);
+    }
+    return size;
+}
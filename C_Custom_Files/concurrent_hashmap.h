@@ -0,0 +1,34 @@
+#ifndef CONCURRENT_HASHMAP_H
+#define CONCURRENT_HASHMAP_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include "hashmap.h"
+
+#define CHASHMAP_DEFAULT_SHARDS 64
+#define CHASHMAP_CACHE_LINE 64
+
+// One lock stripe, padded so neighbouring locks do not share a cache line
+typedef struct {
+    pthread_mutex_t lock;
+    HashMap* map;
+} __attribute__((aligned(CHASHMAP_CACHE_LINE))) HashMapShard;
+
+typedef struct {
+    HashMapShard* shards;       // Power-of-two array of stripes
+    size_t shard_count;         // Number of shards
+    unsigned shard_shift;       // 64 - log2(shard_count)
+} ConcurrentHashMap;
+
+// Function prototypes
+ConcurrentHashMap* chashmap_create(size_t capacity, size_t shard_count);
+void chashmap_destroy(ConcurrentHashMap* map);
+bool chashmap_set(ConcurrentHashMap* map, const HashMapKey* key, uint16_t value1, uint16_t value2, int32_t latitude, int32_t longitude);
+bool chashmap_get(ConcurrentHashMap* map, const HashMapKey* key, uint16_t* value1, uint16_t* value2, int32_t* latitude, int32_t* longitude);
+bool chashmap_delete(ConcurrentHashMap* map, const HashMapKey* key);
+bool chashmap_upsert(ConcurrentHashMap* map, const HashMapKey* key, HashMapMergeFn merge, void* context);
+size_t chashmap_size(ConcurrentHashMap* map);
+
+#endif // CONCURRENT_HASHMAP_H
@@ -0,0 +1,140 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include "concurrent_hashmap.h"
+
+#define DEFAULT_DEVICES 2000000
+#define DEFAULT_UPSERTS 16000000
+#define KEY_LENGTH 37  // 36-character UUID + terminator
+
+typedef struct {
+    ConcurrentHashMap* map;
+    const HashMapKey* keys;
+    const uint32_t* picks;      // Key index per upsert
+    size_t begin;
+    size_t end;
+} Worker;
+
+// Monotonic clock in seconds
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// xorshift64* generator so runs are reproducible
+static uint64_t rng_state = 0x9E3779B97F4A7C15ULL;
+static uint64_t next_random(void) {
+    rng_state ^= rng_state >> 12;
+    rng_state ^= rng_state << 25;
+    rng_state ^= rng_state >> 27;
+    return rng_state * 0x2545F4914F6CDD1DULL;
+}
+
+static void random_uuid(char* out) {
+    static const char hex[] = "0123456789abcdef";
+    uint64_t a = next_random();
+    uint64_t b = next_random();
+    for (int i = 0, n = 0; i < 36; i++) {
+        if (i == 8 || i == 13 || i == 18 || i == 23) {
+            out[i] = '-';
+            continue;
+        }
+        uint64_t word = n < 16 ? a : b;
+        out[i] = hex[(word >> ((n % 16) * 4)) & 0xF];
+        n++;
+    }
+    out[36] = '\0';
+}
+
+// Same min/max night-time merge that mobile_map_filter performs per ping
+static bool merge_min_max(bool found, uint16_t* value1, uint16_t* value2,
+                          int32_t* latitude, int32_t* longitude, void* context) {
+    uint16_t t = (uint16_t)(uintptr_t)context;
+    if (!found) {
+        *value1 = *value2 = t;
+        *latitude = 34000000;
+        *longitude = -118000000;
+        return true;
+    }
+    bool changed = false;
+    if (t < *value1) { *value1 = t; changed = true; }
+    if (t > *value2) { *value2 = t; changed = true; }
+    return changed;
+}
+
+static void* worker_main(void* arg) {
+    Worker* worker = arg;
+    for (size_t i = worker->begin; i < worker->end; i++) {
+        uintptr_t t = (i * 7919) % 2400;
+        chashmap_upsert(worker->map, &worker->keys[worker->picks[i]], merge_min_max, (void*)t);
+    }
+    return NULL;
+}
+
+// Run one configuration and return upserts per second
+static double run(const HashMapKey* keys, const uint32_t* picks, size_t devices, size_t upserts,
+                  int threads, size_t shards) {
+    ConcurrentHashMap* map = chashmap_create(devices, shards);
+    if (!map) {
+        fprintf(stderr, "Failed to create concurrent hashmap\n");
+        exit(1);
+    }
+    pthread_t tids[64];
+    Worker workers[64];
+    double start = now_seconds();
+    for (int t = 0; t < threads; t++) {
+        workers[t].map = map;
+        workers[t].keys = keys;
+        workers[t].picks = picks;
+        workers[t].begin = upserts * t / threads;
+        workers[t].end = upserts * (t + 1) / threads;
+        pthread_create(&tids[t], NULL, worker_main, &workers[t]);
+    }
+    for (int t = 0; t < threads; t++) {
+        pthread_join(tids[t], NULL);
+    }
+    double seconds = now_seconds() - start;
+    chashmap_destroy(map);
+    return upserts / seconds;
+}
+
+int main(int argc, char* argv[]) {
+    size_t devices = argc > 1 ? strtoull(argv[1], NULL, 10) : DEFAULT_DEVICES;
+    size_t upserts = argc > 2 ? strtoull(argv[2], NULL, 10) : DEFAULT_UPSERTS;
+    size_t shards = argc > 3 ? strtoull(argv[3], NULL, 10) : CHASHMAP_DEFAULT_SHARDS;
+
+    char* text = malloc(devices * KEY_LENGTH);
+    HashMapKey* keys = malloc(devices * sizeof(HashMapKey));
+    uint32_t* picks = malloc(upserts * sizeof(uint32_t));
+    if (!text || !keys || !picks) {
+        fprintf(stderr, "Out of memory generating keys\n");
+        return 1;
+    }
+    for (size_t i = 0; i < devices; i++) {
+        random_uuid(text + i * KEY_LENGTH);
+        hashmap_key_init(&keys[i], text + i * KEY_LENGTH, KEY_LENGTH - 1);
+    }
+    for (size_t i = 0; i < upserts; i++) {
+        picks[i] = (uint32_t)(next_random() % devices);
+    }
+
+    printf("concurrent_hashmap_bench: %zu devices, %zu upserts, %zu shards\n", devices, upserts, shards);
+    printf("%-8s %12s %12s %10s\n", "threads", "sharded", "global-lock", "speedup");
+    static const int thread_counts[] = {1, 2, 4, 8, 16, 32};
+    double base = 0;
+    for (size_t i = 0; i < sizeof(thread_counts) / sizeof(thread_counts[0]); i++) {
+        int threads = thread_counts[i];
+        double sharded = run(keys, picks, devices, upserts, threads, shards);
+        double global = run(keys, picks, devices, upserts, threads, 1);
+        if (i == 0) base = sharded;
+        printf("%-8d %9.2f M/s %9.2f M/s %9.2fx\n", threads, sharded / 1e6, global / 1e6, sharded / base);
+    }
+
+    free(text);
+    free(keys);
+    free(picks);
+    return 0;
+}
@@ -0,0 +1,338 @@
+#include "csv_reader.h"
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <pthread.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define CSV_HAVE_X86 1
+#elif defined(__aarch64__)
+#include <arm_neon.h>
+#define CSV_HAVE_NEON 1
+#endif
+
+// Per-block character classes, bit i for byte i
+typedef struct {
+    uint64_t commas;
+    uint64_t newlines;
+    uint64_t quotes;
+} CsvBlockMasks;
+
+typedef void (*CsvScanFn)(const char* p, CsvBlockMasks* masks);
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+// Bit i set where byte i of word equals the byte repeated in pattern. The
+// zero-byte test is exact (no false positives from borrows), and the
+// multiply gathers each byte's flag into the top byte.
+static inline uint64_t swar_match(uint64_t word, uint64_t pattern) {
+    const uint64_t low7 = 0x7F7F7F7F7F7F7F7FULL;
+    uint64_t x = word ^ pattern;
+    uint64_t zero = ~(((x & low7) + low7) | x | low7);
+    return ((zero >> 7) * 0x0102040810204080ULL) >> 56;
+}
+
+// Portable fallback: eight bytes at a time in general-purpose registers
+static void scan_block_scalar(const char* p, CsvBlockMasks* masks) {
+    uint64_t commas = 0, newlines = 0, quotes = 0;
+    for (int i = 0; i < CSV_BLOCK_SIZE; i += 8) {
+        uint64_t word;
+        memcpy(&word, p + i, sizeof(word));
+        commas |= swar_match(word, 0x2C2C2C2C2C2C2C2CULL) << i;
+        newlines |= swar_match(word, 0x0A0A0A0A0A0A0A0AULL) << i;
+        quotes |= swar_match(word, 0x2222222222222222ULL) << i;
+    }
+    masks->commas = commas;
+    masks->newlines = newlines;
+    masks->quotes = quotes;
+}
+#else
+static void scan_block_scalar(const char* p, CsvBlockMasks* masks) {
+    uint64_t commas = 0, newlines = 0, quotes = 0;
+    for (int i = 0; i < CSV_BLOCK_SIZE; i++) {
+        uint64_t bit = 1ULL << i;
+        if (p[i] == ',') commas |= bit;
+        else if (p[i] == '\n') newlines |= bit;
+        else if (p[i] == '"') quotes |= bit;
+    }
+    masks->commas = commas;
+    masks->newlines = newlines;
+    masks->quotes = quotes;
+}
+#endif
+
+#ifdef CSV_HAVE_X86
+// 16 bytes per compare; SSE2 is part of the x86-64 baseline
+static void scan_block_sse2(const char* p, CsvBlockMasks* masks) {
+    const __m128i comma = _mm_set1_epi8(',');
+    const __m128i newline = _mm_set1_epi8('\n');
+    const __m128i quote = _mm_set1_epi8('"');
+    uint64_t commas = 0, newlines = 0, quotes = 0;
+    for (int i = 0; i < CSV_BLOCK_SIZE; i += 16) {
+        __m128i bytes = _mm_loadu_si128((const __m128i*)(p + i));
+        commas |= (uint64_t)(uint16_t)_mm_movemask_epi8(_mm_cmpeq_epi8(bytes, comma)) << i;
+        newlines |= (uint64_t)(uint16_t)_mm_movemask_epi8(_mm_cmpeq_epi8(bytes, newline)) << i;
+        quotes |= (uint64_t)(uint16_t)_mm_movemask_epi8(_mm_cmpeq_epi8(bytes, quote)) << i;
+    }
+    masks->commas = commas;
+    masks->newlines = newlines;
+    masks->quotes = quotes;
+}
+
+__attribute__((target("avx2")))
+static void scan_block_avx2(const char* p, CsvBlockMasks* masks) {
+    const __m256i comma = _mm256_set1_epi8(',');
+    const __m256i newline = _mm256_set1_epi8('\n');
+    const __m256i quote = _mm256_set1_epi8('"');
+    __m256i lo = _mm256_loadu_si256((const __m256i*)p);
+    __m256i hi = _mm256_loadu_si256((const __m256i*)(p + 32));
+    masks->commas = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(lo, comma)) |
+                    (uint64_t)(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(hi, comma)) << 32;
+    masks->newlines = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(lo, newline)) |
+                      (uint64_t)(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(hi, newline)) << 32;
+    masks->quotes = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(lo, quote)) |
+                    (uint64_t)(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(hi, quote)) << 32;
+}
+#endif
+
+#ifdef CSV_HAVE_NEON
+// NEON has no movemask: weight each matching lane by its bit and add pairwise
+static inline uint64_t neon_movemask64(uint8x16_t m0, uint8x16_t m1, uint8x16_t m2, uint8x16_t m3) {
+    const uint8x16_t weights = { 1, 2, 4, 8, 16, 32, 64, 128, 1, 2, 4, 8, 16, 32, 64, 128 };
+    uint8x16_t sum0 = vpaddq_u8(vandq_u8(m0, weights), vandq_u8(m1, weights));
+    uint8x16_t sum1 = vpaddq_u8(vandq_u8(m2, weights), vandq_u8(m3, weights));
+    sum0 = vpaddq_u8(sum0, sum1);
+    sum0 = vpaddq_u8(sum0, sum0);
+    return vgetq_lane_u64(vreinterpretq_u64_u8(sum0), 0);
+}
+
+static void scan_block_neon(const char* p, CsvBlockMasks* masks) {
+    const uint8_t* bytes = (const uint8_t*)p;
+    uint8x16_t b0 = vld1q_u8(bytes), b1 = vld1q_u8(bytes + 16);
+    uint8x16_t b2 = vld1q_u8(bytes + 32), b3 = vld1q_u8(bytes + 48);
+    uint8x16_t comma = vdupq_n_u8(','), newline = vdupq_n_u8('\n'), quote = vdupq_n_u8('"');
+    masks->commas = neon_movemask64(vceqq_u8(b0, comma), vceqq_u8(b1, comma),
+                                    vceqq_u8(b2, comma), vceqq_u8(b3, comma));
+    masks->newlines = neon_movemask64(vceqq_u8(b0, newline), vceqq_u8(b1, newline),
+                                      vceqq_u8(b2, newline), vceqq_u8(b3, newline));
+    masks->quotes = neon_movemask64(vceqq_u8(b0, quote), vceqq_u8(b1, quote),
+                                    vceqq_u8(b2, quote), vceqq_u8(b3, quote));
+}
+#endif
+
+static CsvScanFn scan_block = NULL;
+static CsvScanner active_scanner = CSV_SCANNER_AUTO;
+
+// Switch block scanners; fails if this CPU cannot run the requested one.
+// Call before readers are in use on other threads.
+bool csv_scanner_select(CsvScanner scanner) {
+    if (scanner == CSV_SCANNER_AUTO) {
+#if defined(CSV_HAVE_X86)
+        __builtin_cpu_init();
+        scanner = __builtin_cpu_supports("avx2") ? CSV_SCANNER_AVX2 : CSV_SCANNER_SSE2;
+#elif defined(CSV_HAVE_NEON)
+        scanner = CSV_SCANNER_NEON;
+#else
+        scanner = CSV_SCANNER_SCALAR;
+#endif
+    }
+
+    CsvScanFn fn = NULL;
+    switch (scanner) {
+        case CSV_SCANNER_SCALAR:
+            fn = scan_block_scalar;
+            break;
+#ifdef CSV_HAVE_X86
+        case CSV_SCANNER_SSE2:
+            fn = scan_block_sse2;
+            break;
+        case CSV_SCANNER_AVX2:
+            __builtin_cpu_init();
+            if (__builtin_cpu_supports("avx2")) fn = scan_block_avx2;
+            break;
+#endif
+#ifdef CSV_HAVE_NEON
+        case CSV_SCANNER_NEON:
+            fn = scan_block_neon;
+            break;
+#endif
+        default:
+            break;
+    }
+    if (!fn) return false;
+    scan_block = fn;
+    active_scanner = scanner;
+    return true;
+}
+
+static void select_default_scanner(void) {
+    if (!scan_block) csv_scanner_select(CSV_SCANNER_AUTO);
+}
+
+const char* csv_scanner_name(void) {
+    static const char* names[] = { "auto", "scalar", "sse2", "avx2", "neon" };
+    return names[active_scanner];
+}
+
+// Map the whole file and position the reader on the rows that start in
+// [begin, end). A row belongs to the range holding its first byte, so a
+// range that begins mid-row skips ahead to the next line; the last row may
+// run past end. Assumes no quoted field contains a newline when split.
+bool csv_reader_open_range(CsvReader* reader, const char* path, size_t begin, size_t end) {
+    static pthread_once_t scanner_once = PTHREAD_ONCE_INIT;
+    pthread_once(&scanner_once, select_default_scanner);
+
+    memset(reader, 0, sizeof(*reader));
+    reader->fd = open(path, O_RDONLY);
+    if (reader->fd < 0) return false;
+
+    struct stat st;
+    if (fstat(reader->fd, &st) != 0) {
+        close(reader->fd);
+        reader->fd = -1;
+        return false;
+    }
+    reader->size = (size_t)st.st_size;
+    if (end > reader->size) end = reader->size;
+    if (begin > end) begin = end;
+
+    if (reader->size > 0) {
+        void* data = mmap(NULL, reader->size, PROT_READ, MAP_PRIVATE, reader->fd, 0);
+        if (data == MAP_FAILED) {
+            close(reader->fd);
+            reader->fd = -1;
+            return false;
+        }
+        madvise(data, reader->size, MADV_SEQUENTIAL);
+        reader->data = data;
+    }
+
+    const char* file_end = reader->data + reader->size;
+    const char* cursor = reader->data + begin;
+    if (begin > 0 && cursor[-1] != '\n') {
+        const char* newline = memchr(cursor, '\n', (size_t)(file_end - cursor));
+        cursor = newline ? newline + 1 : file_end;
+    }
+    reader->cursor = cursor;
+    reader->end = reader->data + end;
+    return true;
+}
+
+bool csv_reader_open(CsvReader* reader, const char* path) {
+    return csv_reader_open_range(reader, path, 0, (size_t)-1);
+}
+
+void csv_reader_close(CsvReader* reader) {
+    if (reader->data) munmap((void*)reader->data, reader->size);
+    if (reader->fd >= 0) close(reader->fd);
+    reader->data = NULL;
+    reader->fd = -1;
+}
+
+// Set bits of x and every bit above each one, toggling: a mask of the
+// bytes between an opening quote (inclusive) and its closing quote
+static inline uint64_t prefix_xor(uint64_t x) {
+    x ^= x << 1;
+    x ^= x << 2;
+    x ^= x << 4;
+    x ^= x << 8;
+    x ^= x << 16;
+    x ^= x << 32;
+    return x;
+}
+
+// Load the block starting at p into the structural index. carry_quote says
+// whether p is inside a quoted field. The tail of the file is scanned from a
+// zero-padded copy, and the end of the file acts as a final row terminator,
+// even inside an unterminated quote, so no row runs past the mapping.
+static void load_block(CsvReader* reader, const char* p, bool carry_quote) {
+    const char* file_end = reader->data + reader->size;
+    size_t avail = p < file_end ? (size_t)(file_end - p) : 0;
+    CsvBlockMasks masks;
+    uint64_t eof = 0;
+    if (avail >= CSV_BLOCK_SIZE) {
+        scan_block(p, &masks);
+    } else {
+        char tail[CSV_BLOCK_SIZE] __attribute__((aligned(CSV_BLOCK_SIZE))) = {0};
+        memcpy(tail, p, avail);
+        scan_block(tail, &masks);
+        eof = 1ULL << avail;
+    }
+
+    uint64_t quoted = prefix_xor(masks.quotes) ^ (carry_quote ? ~0ULL : 0);
+    reader->block = p;
+    reader->delimiters = ((masks.commas | masks.newlines) & ~quoted) | eof;
+    reader->newlines = (masks.newlines & ~quoted) | eof;
+    reader->in_quote = (quoted >> 63) != 0;
+}
+
+// Store the field [start, stop), dropping a CR before the row end and the
+// surrounding quotes of a quoted field
+static inline void set_field(CsvField* field, const char* start, const char* stop, bool row_done) {
+    if (row_done && stop > start && stop[-1] == '\r') stop--;
+    if (stop > start && *start == '"') {
+        start++;
+        if (stop > start && stop[-1] == '"') stop--;
+    }
+    field->ptr = start;
+    field->len = (size_t)(stop - start);
+}
+
+// Split the next row into fields. Empty fields are returned as zero-length
+// spans (consecutive commas are never merged). Fields past max_fields are
+// not split: the reader jumps to the row end, counting the delimiters it
+// passes. Returns the number of fields in the row (which may exceed
+// max_fields), or -1 when the range is exhausted.
+int csv_reader_next(CsvReader* reader, CsvField* fields, int max_fields) {
+    const char* p = reader->cursor;
+    const char* file_end = reader->data + reader->size;
+    if (p >= reader->end || p >= file_end) return -1;
+
+    // Rows start outside quotes, so a fresh block needs no carried state
+    if (!reader->block || p < reader->block || p >= reader->block + CSV_BLOCK_SIZE) {
+        load_block(reader, p, false);
+    }
+    uint64_t bits = reader->delimiters & (~0ULL << (p - reader->block));
+
+    int count = 0;
+    const char* start = p;
+    for (;;) {
+        while (bits == 0) {
+            load_block(reader, reader->block + CSV_BLOCK_SIZE, reader->in_quote);
+            bits = reader->delimiters;
+        }
+
+        if (count >= max_fields) {
+            // Only the row end matters now: count the fields up to it
+            uint64_t ends = bits & reader->newlines;
+            if (ends == 0) {
+                count += __builtin_popcountll(bits);
+                bits = 0;
+                continue;
+            }
+            uint64_t row_end = ends & -ends;
+            count += __builtin_popcountll(bits & (row_end - 1)) + 1;
+            const char* stop = reader->block + __builtin_ctzll(ends);
+            reader->cursor = stop < file_end ? stop + 1 : file_end;
+            break;
+        }
+
+        int index = __builtin_ctzll(bits);
+        const char* stop = reader->block + index;
+        bool row_done = (reader->newlines >> index) & 1;
+        bits &= bits - 1;
+        set_field(&fields[count], start, stop, row_done);
+        count++;
+
+        if (row_done) {
+            reader->cursor = stop < file_end ? stop + 1 : file_end;
+            break;
+        }
+        start = stop + 1;
+    }
+
+    reader->rows++;
+    return count;
+}
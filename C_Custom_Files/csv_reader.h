@@ -0,0 +1,51 @@
+#ifndef CSV_READER_H
+#define CSV_READER_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#define CSV_BLOCK_SIZE 64       // Bytes classified per scanner call, one bit each
+
+// A field inside the mapped file; not NUL-terminated. Quoted fields exclude
+// their surrounding quotes, and escaped quotes ("") are left as-is.
+typedef struct {
+    const char* ptr;
+    size_t len;
+} CsvField;
+
+// Zero-copy reader over an mmap'd CSV file (or a byte range of one)
+typedef struct {
+    int fd;
+    const char* data;           // Start of the mapping
+    size_t size;                // File size
+    const char* cursor;         // Start of the next row
+    const char* end;            // Rows starting at or after this belong to the next range
+    size_t rows;                // Rows returned so far
+    // Structural index of the current block: bit i describes block[i]
+    const char* block;
+    uint64_t delimiters;        // Commas and newlines outside quotes
+    uint64_t newlines;          // Newlines outside quotes
+    bool in_quote;              // Whether the block ends inside a quoted field
+} CsvReader;
+
+// Block scanner implementations, picked at runtime from CPUID
+typedef enum {
+    CSV_SCANNER_AUTO,
+    CSV_SCANNER_SCALAR,
+    CSV_SCANNER_SSE2,
+    CSV_SCANNER_AVX2,
+    CSV_SCANNER_NEON
+} CsvScanner;
+
+// Function prototypes
+bool csv_reader_open(CsvReader* reader, const char* path);
+bool csv_reader_open_range(CsvReader* reader, const char* path, size_t begin, size_t end);
+void csv_reader_close(CsvReader* reader);
+int csv_reader_next(CsvReader* reader, CsvField* fields, int max_fields);
+
+// Scanner selection (the first reader opened picks CSV_SCANNER_AUTO)
+bool csv_scanner_select(CsvScanner scanner);
+const char* csv_scanner_name(void);
+
+#endif // CSV_READER_H
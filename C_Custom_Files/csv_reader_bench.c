@@ -0,0 +1,75 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sys/stat.h>
+#include "csv_reader.h"
+
+#define DEFAULT_PASSES 5
+#define PING_COLUMNS 11  // Columns the ping parsers request (0..10)
+
+// Monotonic clock in seconds
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// Read the whole file once, touching every returned field so nothing is
+// optimized away. Returns the number of rows.
+static size_t read_file(const char* path, int max_fields, size_t* checksum) {
+    CsvReader reader;
+    if (!csv_reader_open(&reader, path)) return 0;
+    CsvField fields[64];
+    int count;
+    while ((count = csv_reader_next(&reader, fields, max_fields)) >= 0) {
+        int n = count < max_fields ? count : max_fields;
+        for (int i = 0; i < n; i++) {
+            *checksum += fields[i].len;
+        }
+    }
+    size_t rows = reader.rows;
+    csv_reader_close(&reader);
+    return rows;
+}
+
+static void run(const char* path, size_t bytes, int passes, int max_fields) {
+    size_t checksum = 0, rows = 0;
+    read_file(path, max_fields, &checksum);  // Warm the page cache
+    double start = now_seconds();
+    for (int i = 0; i < passes; i++) {
+        rows = read_file(path, max_fields, &checksum);
+    }
+    double seconds = now_seconds() - start;
+    printf("%-8s %2d fields  %10zu rows  %8.3f s  %6.2f GB/s  %7.1f Mrows/s  (checksum %zu)\n",
+           csv_scanner_name(), max_fields, rows, seconds,
+           (double)bytes * passes / seconds / 1e9, (double)rows * passes / seconds / 1e6, checksum);
+}
+
+int main(int argc, char* argv[]) {
+    if (argc < 2) {
+        fprintf(stderr, "Usage: %s <file.csv> [passes]\n", argv[0]);
+        return 1;
+    }
+    const char* path = argv[1];
+    int passes = argc > 2 ? atoi(argv[2]) : DEFAULT_PASSES;
+    if (passes < 1) passes = 1;
+
+    struct stat st;
+    if (stat(path, &st) != 0) {
+        fprintf(stderr, "Cannot stat %s\n", path);
+        return 1;
+    }
+    size_t bytes = (size_t)st.st_size;
+    printf("csv_reader_bench: %s, %zu bytes, %d passes\n", path, bytes, passes);
+
+    static const CsvScanner scanners[] = {
+        CSV_SCANNER_SCALAR, CSV_SCANNER_SSE2, CSV_SCANNER_AVX2, CSV_SCANNER_NEON
+    };
+    for (size_t i = 0; i < sizeof(scanners) / sizeof(scanners[0]); i++) {
+        if (!csv_scanner_select(scanners[i])) continue;
+        run(path, bytes, passes, PING_COLUMNS);
+        run(path, bytes, passes, 64);
+    }
+    return 0;
+}
@@ -0,0 +1,118 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "csv_reader.h"
+
+// Reader tests on small files written here, run with every block scanner
+// this CPU supports. A quote left open on the last row must end at the end
+// of the file, as the scalar reader did, never scan past the mapping.
+
+static int failures = 0;
+
+#define CHECK(condition) do { \
+    if (!(condition)) { \
+        fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition); \
+        failures++; \
+    } \
+} while (0)
+
+#define MAX_FIELDS 8
+
+static bool write_file(const char* path, const char* data, size_t length) {
+    FILE* file = fopen(path, "wb");
+    if (!file) return false;
+    bool ok = fwrite(data, 1, length, file) == length;
+    return fclose(file) == 0 && ok;
+}
+
+static bool field_is(const CsvField* field, const char* text, size_t length) {
+    return field->len == length && memcmp(field->ptr, text, length) == 0;
+}
+
+// Fields inside the mapping, with nothing left after the last row
+static void check_rest_empty(CsvReader* reader) {
+    CsvField fields[MAX_FIELDS];
+    CHECK(csv_reader_next(reader, fields, MAX_FIELDS) == -1);
+}
+
+static void test_rows(const char* path) {
+    const char data[] = "a,b\r\n\"x,y\",\n1,\"2\"";
+    CHECK(write_file(path, data, sizeof(data) - 1));
+    CsvReader reader;
+    CHECK(csv_reader_open(&reader, path));
+    CsvField fields[MAX_FIELDS];
+    CHECK(csv_reader_next(&reader, fields, MAX_FIELDS) == 2);
+    CHECK(field_is(&fields[0], "a", 1) && field_is(&fields[1], "b", 1));
+    CHECK(csv_reader_next(&reader, fields, MAX_FIELDS) == 2);
+    CHECK(field_is(&fields[0], "x,y", 3) && field_is(&fields[1], "", 0));
+    CHECK(csv_reader_next(&reader, fields, MAX_FIELDS) == 2);
+    CHECK(field_is(&fields[0], "1", 1) && field_is(&fields[1], "2", 1));
+    check_rest_empty(&reader);
+    csv_reader_close(&reader);
+}
+
+// A file holding only a row with an open quote
+static void test_open_quote_short(const char* path) {
+    const char data[] = "a,\"bc";
+    CHECK(write_file(path, data, sizeof(data) - 1));
+    CsvReader reader;
+    CHECK(csv_reader_open(&reader, path));
+    CsvField fields[MAX_FIELDS];
+    CHECK(csv_reader_next(&reader, fields, MAX_FIELDS) == 2);
+    CHECK(field_is(&fields[0], "a", 1) && field_is(&fields[1], "bc", 2));
+    check_rest_empty(&reader);
+    csv_reader_close(&reader);
+}
+
+// A page-sized file whose last row opens a quote: the end of the file falls
+// on a block boundary, right at the end of the mapping
+static void test_open_quote_page(const char* path) {
+    const size_t size = 4096;
+    char* data = malloc(size);
+    CHECK(data != NULL);
+    if (!data) return;
+    memcpy(data, "a,b\n1,\"", 7);
+    memset(data + 7, 'z', size - 7);
+    CHECK(write_file(path, data, size));
+
+    CsvReader reader;
+    CHECK(csv_reader_open(&reader, path));
+    CsvField fields[MAX_FIELDS];
+    CHECK(csv_reader_next(&reader, fields, MAX_FIELDS) == 2);
+    CHECK(csv_reader_next(&reader, fields, MAX_FIELDS) == 2);
+    CHECK(field_is(&fields[0], "1", 1) && field_is(&fields[1], data + 7, size - 7));
+    check_rest_empty(&reader);
+    csv_reader_close(&reader);
+
+    // Same file with the fields past the first skipped to the row end
+    CHECK(csv_reader_open(&reader, path));
+    CHECK(csv_reader_next(&reader, fields, 1) == 2);
+    CHECK(csv_reader_next(&reader, fields, 1) == 2);
+    CHECK(field_is(&fields[0], "1", 1));
+    check_rest_empty(&reader);
+    csv_reader_close(&reader);
+    free(data);
+}
+
+int main(void) {
+    const char* tmpdir = getenv("TMPDIR");
+    char path[4096];
+    snprintf(path, sizeof(path), "%s/csv_reader_test_%d.csv", tmpdir && *tmpdir ? tmpdir : "/tmp", (int)getpid());
+
+    const CsvScanner scanners[] = { CSV_SCANNER_SCALAR, CSV_SCANNER_SSE2, CSV_SCANNER_AVX2, CSV_SCANNER_NEON };
+    for (size_t i = 0; i < sizeof(scanners) / sizeof(scanners[0]); i++) {
+        if (!csv_scanner_select(scanners[i])) continue;
+        test_rows(path);
+        test_open_quote_short(path);
+        test_open_quote_page(path);
+    }
+    unlink(path);
+
+    if (failures) {
+        fprintf(stderr, "csv_reader_test: %d failures\n", failures);
+        return 1;
+    }
+    printf("csv_reader_test: ok\n");
+    return 0;
+}
@@ -0,0 +1,199 @@
+#include "file_pool.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <dirent.h>
+#include <pthread.h>
+#include <sys/stat.h>
+
+// One unit of work: a whole file, or a byte range of one
+typedef struct {
+    const char* path;
+    size_t begin;
+    size_t end;
+} PoolItem;
+
+typedef struct {
+    const PoolItem* items;
+    size_t count;
+    FileTaskFn task;            // Whole-file callback, or
+    FileRangeTaskFn range_task; // byte-range callback
+    void* context;
+    size_t next;                // Next item index, claimed atomically
+} PoolState;
+
+typedef struct {
+    PoolState* state;
+    size_t worker;
+} PoolWorker;
+
+bool file_list_add(FileList* list, const char* path) {
+    if (list->count == list->capacity) {
+        size_t capacity = list->capacity == 0 ? 64 : list->capacity * 2;
+        char** paths = realloc(list->paths, capacity * sizeof(char*));
+        if (!paths) return false;
+        list->paths = paths;
+        list->capacity = capacity;
+    }
+    list->paths[list->count] = strdup(path);
+    if (!list->paths[list->count]) return false;
+    list->count++;
+    return true;
+}
+
+// Add the entries of dir_path that are directories (want_dirs) or regular
+// files and whose name contains name_filter (NULL matches all)
+static size_t scan_directory(FileList* list, const char* dir_path, const char* name_filter, bool want_dirs) {
+    DIR* dir = opendir(dir_path);
+    if (!dir) return 0;
+
+    size_t added = 0;
+    struct dirent* entry;
+    while ((entry = readdir(dir)) != NULL) {
+        // Skip . and .. directories
+        if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0) {
+            continue;
+        }
+        if (name_filter && strstr(entry->d_name, name_filter) == NULL) {
+            continue;
+        }
+
+        char full_path[4096];
+        snprintf(full_path, sizeof(full_path), "%s/%s", dir_path, entry->d_name);
+
+        struct stat st;
+        if (stat(full_path, &st) == -1) {
+            continue;
+        }
+        if (want_dirs ? !S_ISDIR(st.st_mode) : !S_ISREG(st.st_mode)) {
+            continue;
+        }
+        if (file_list_add(list, full_path)) added++;
+    }
+
+    closedir(dir);
+    return added;
+}
+
+// Add every regular file in dir_path whose name contains name_filter (NULL
+// matches all). Returns the number of files added, or 0 if the directory
+// cannot be opened.
+size_t file_list_scan(FileList* list, const char* dir_path, const char* name_filter) {
+    return scan_directory(list, dir_path, name_filter, false);
+}
+
+// Add every subdirectory of dir_path (e.g. one per day)
+size_t file_list_scan_dirs(FileList* list, const char* dir_path) {
+    return scan_directory(list, dir_path, NULL, true);
+}
+
+void file_list_free(FileList* list) {
+    for (size_t i = 0; i < list->count; i++) {
+        free(list->paths[i]);
+    }
+    free(list->paths);
+    list->paths = NULL;
+    list->count = list->capacity = 0;
+}
+
+static void* pool_worker_main(void* arg) {
+    PoolWorker* worker = arg;
+    PoolState* state = worker->state;
+    for (;;) {
+        size_t index = __atomic_fetch_add(&state->next, 1, __ATOMIC_RELAXED);
+        if (index >= state->count) break;
+        const PoolItem* item = &state->items[index];
+        if (state->range_task) {
+            state->range_task(item->path, item->begin, item->end, worker->worker, state->context);
+        } else {
+            state->task(item->path, worker->worker, state->context);
+        }
+    }
+    return NULL;
+}
+
+// Run the items on `threads` workers that claim them one at a time. With one
+// thread (or one item) everything runs on the calling thread.
+static void run_items(PoolState* state, size_t threads) {
+    if (threads <= 1 || state->count <= 1) {
+        PoolWorker worker = { state, 0 };
+        pool_worker_main(&worker);
+        return;
+    }
+
+    pthread_t* tids = malloc(threads * sizeof(pthread_t));
+    PoolWorker* workers = malloc(threads * sizeof(PoolWorker));
+    if (!tids || !workers) {
+        free(tids);
+        free(workers);
+        PoolWorker worker = { state, 0 };
+        pool_worker_main(&worker);
+        return;
+    }
+
+    size_t started = 0;
+    for (size_t i = 0; i < threads; i++) {
+        workers[i].state = state;
+        workers[i].worker = i;
+        if (pthread_create(&tids[i], NULL, pool_worker_main, &workers[i]) != 0) break;
+        started++;
+    }
+    // If no thread could be started, do the work here
+    if (started == 0) {
+        pool_worker_main(&workers[0]);
+    }
+    for (size_t i = 0; i < started; i++) {
+        pthread_join(tids[i], NULL);
+    }
+    free(tids);
+    free(workers);
+}
+
+// Run task over every file using `threads` workers
+void file_pool_run(const FileList* list, size_t threads, FileTaskFn task, void* context) {
+    PoolItem* items = malloc((list->count ? list->count : 1) * sizeof(PoolItem));
+    if (!items) return;
+    for (size_t i = 0; i < list->count; i++) {
+        items[i].path = list->paths[i];
+        items[i].begin = 0;
+        items[i].end = (size_t)-1;
+    }
+    PoolState state = { items, list->count, task, NULL, context, 0 };
+    run_items(&state, threads);
+    free(items);
+}
+
+// Run task over byte ranges of about range_bytes (0 = whole files), so one
+// large file can keep several workers busy. Ranges are handed out in file
+// order; the reader snaps each range to line boundaries.
+void file_pool_run_ranges(const FileList* list, size_t threads, size_t range_bytes,
+                          FileRangeTaskFn task, void* context) {
+    size_t count = 0, capacity = list->count ? list->count : 1;
+    PoolItem* items = malloc(capacity * sizeof(PoolItem));
+    if (!items) return;
+
+    for (size_t i = 0; i < list->count; i++) {
+        struct stat st;
+        size_t size = stat(list->paths[i], &st) == 0 ? (size_t)st.st_size : 0;
+        size_t pieces = range_bytes == 0 || size <= range_bytes ? 1 : (size + range_bytes - 1) / range_bytes;
+        for (size_t k = 0; k < pieces; k++) {
+            if (count == capacity) {
+                capacity *= 2;
+                PoolItem* grown = realloc(items, capacity * sizeof(PoolItem));
+                if (!grown) {
+                    free(items);
+                    return;
+                }
+                items = grown;
+            }
+            items[count].path = list->paths[i];
+            items[count].begin = pieces == 1 ? 0 : k * range_bytes;
+            items[count].end = pieces == 1 || k + 1 == pieces ? (size_t)-1 : (k + 1) * range_bytes;
+            count++;
+        }
+    }
+
+    PoolState state = { items, count, NULL, task, context, 0 };
+    run_items(&state, threads);
+    free(items);
+}
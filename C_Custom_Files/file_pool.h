@@ -0,0 +1,29 @@
+#ifndef FILE_POOL_H
+#define FILE_POOL_H
+
+#include <stddef.h>
+#include <stdbool.h>
+
+// Paths collected from a directory, processed later by a worker pool
+typedef struct {
+    char** paths;
+    size_t count;
+    size_t capacity;
+} FileList;
+
+// Called once per file on some worker; worker is in [0, threads)
+typedef void (*FileTaskFn)(const char* path, size_t worker, void* context);
+
+// Called once per byte range [begin, end) of a file (end may be SIZE_MAX)
+typedef void (*FileRangeTaskFn)(const char* path, size_t begin, size_t end, size_t worker, void* context);
+
+// Function prototypes
+bool file_list_add(FileList* list, const char* path);
+size_t file_list_scan(FileList* list, const char* dir_path, const char* name_filter);
+size_t file_list_scan_dirs(FileList* list, const char* dir_path);
+void file_list_free(FileList* list);
+void file_pool_run(const FileList* list, size_t threads, FileTaskFn task, void* context);
+void file_pool_run_ranges(const FileList* list, size_t threads, size_t range_bytes,
+                          FileRangeTaskFn task, void* context);
+
+#endif // FILE_POOL_H
@@ -0,0 +1,140 @@
+#include "fixed_point.h"
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#define MAX_DECIMALS 9
+#define MAX_FAST_DIGITS 15      // Integer + kept fraction digits; far from int64 overflow
+
+static const int64_t powers_of_ten[MAX_DECIMALS + 1] = {
+    1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000, 1000000000
+};
+
+// Rare shapes (exponents, very long numbers) go through strtod
+static bool parse_slow(const char* text, size_t length, int decimals, int64_t* out) {
+    char buffer[64];
+    if (length >= sizeof(buffer)) return false;
+    memcpy(buffer, text, length);
+    buffer[length] = '\0';
+
+    char* end;
+    double value = strtod(buffer, &end);
+    if (end != buffer + length) return false;
+    return fixed_from_double(value, decimals, out);
+}
+
+// Parse a decimal such as "-118.2437" into an integer scaled by
+// 10^decimals, rounding half away from zero on the first dropped digit.
+// Returns false for empty or non-numeric text.
+bool fixed_parse(const char* text, size_t length, int decimals, int64_t* out) {
+    if (decimals < 0 || decimals > MAX_DECIMALS) return false;
+
+    const char* p = text;
+    const char* end = text + length;
+    bool negative = false;
+    if (p < end && (*p == '-' || *p == '+')) {
+        negative = *p == '-';
+        p++;
+    }
+
+    int64_t value = 0;
+    int digits = 0;             // Digits accumulated into value
+    int fraction = 0;           // Fraction digits accumulated
+    bool seen_digit = false;
+    bool round_up = false;
+
+    while (p < end && (unsigned)(*p - '0') <= 9) {
+        if (++digits > MAX_FAST_DIGITS) return parse_slow(text, length, decimals, out);
+        value = value * 10 + (*p - '0');
+        seen_digit = true;
+        p++;
+    }
+    if (p < end && *p == '.') {
+        p++;
+        while (p < end && (unsigned)(*p - '0') <= 9) {
+            if (fraction < decimals) {
+                if (++digits > MAX_FAST_DIGITS) return parse_slow(text, length, decimals, out);
+                value = value * 10 + (*p - '0');
+                fraction++;
+            } else if (fraction == decimals) {
+                round_up = *p >= '5';
+                fraction++;     // Later digits cannot change the rounding
+            }
+            seen_digit = true;
+            p++;
+        }
+    }
+    if (p != end) {
+        return seen_digit && (*p == 'e' || *p == 'E') ? parse_slow(text, length, decimals, out) : false;
+    }
+    if (!seen_digit) return false;
+
+    if (fraction < decimals) value *= powers_of_ten[decimals - fraction];
+    value += round_up;
+    *out = negative ? -value : value;
+    return true;
+}
+
+// Degrees to int32 microdegrees; false if empty, invalid or out of range
+bool fixed_parse_microdegrees(const char* text, size_t length, int32_t* out) {
+    int64_t value;
+    if (!fixed_parse(text, length, MICRODEGREE_DECIMALS, &value)) return false;
+    if (value < INT32_MIN || value > INT32_MAX) return false;
+    *out = (int32_t)value;
+    return true;
+}
+
+// Meters per second to int16 cm/s, saturating; false if empty or invalid
+bool fixed_parse_speed(const char* text, size_t length, int16_t* out) {
+    int64_t value;
+    if (!fixed_parse(text, length, SPEED_DECIMALS, &value)) return false;
+    *out = value > INT16_MAX ? INT16_MAX : value < INT16_MIN ? INT16_MIN : (int16_t)value;
+    return true;
+}
+
+// Binary doubles (Parquet columns) to a scaled integer, rounding half away
+// from zero; false for NaN, infinities and values out of int64 range
+bool fixed_from_double(double value, int decimals, int64_t* out) {
+    if (decimals < 0 || decimals > MAX_DECIMALS || !isfinite(value)) return false;
+    value *= (double)powers_of_ten[decimals];
+    if (fabs(value) >= 9.0e18) return false;
+    *out = llround(value);
+    return true;
+}
+
+bool fixed_microdegrees_from_double(double degrees, int32_t* out) {
+    int64_t value;
+    if (!fixed_from_double(degrees, MICRODEGREE_DECIMALS, &value)) return false;
+    if (value < INT32_MIN || value > INT32_MAX) return false;
+    *out = (int32_t)value;
+    return true;
+}
+
+bool fixed_speed_from_double(double mps, int16_t* out) {
+    int64_t value;
+    if (!fixed_from_double(mps, SPEED_DECIMALS, &value)) return false;
+    *out = value > INT16_MAX ? INT16_MAX : value < INT16_MIN ? INT16_MIN : (int16_t)value;
+    return true;
+}
+
+// Write a scaled integer as a decimal with exactly `decimals` fraction
+// digits (same text as printf("%.*f") of the real value): at most
+// FIXED_WRITE_MAX bytes, no terminator. Returns the length.
+size_t fixed_write(char* out, int64_t value, int decimals) {
+    char digits[24];
+    uint64_t magnitude = value < 0 ? -(uint64_t)value : (uint64_t)value;
+    int count = 0;
+    do {
+        digits[count++] = (char)('0' + magnitude % 10);
+        magnitude /= 10;
+    } while (magnitude > 0 || count <= decimals);
+
+    char* p = out;
+    if (value < 0) *p++ = '-';
+    while (count > decimals) *p++ = digits[--count];
+    if (decimals > 0) {
+        *p++ = '.';
+        while (count > 0) *p++ = digits[--count];
+    }
+    return (size_t)(p - out);
+}
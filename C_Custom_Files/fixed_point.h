@@ -0,0 +1,28 @@
+#ifndef FIXED_POINT_H
+#define FIXED_POINT_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+// Coordinates are int32 microdegrees (1e-6 deg, ~11 cm); speed is int16
+// centimeters per second (up to +-327.67 m/s, saturating)
+#define MICRODEGREE_DECIMALS 6
+#define MICRODEGREES(degrees) ((int32_t)((degrees) * 1000000.0 + ((degrees) < 0 ? -0.5 : 0.5)))
+#define SPEED_DECIMALS 2
+#define SPEED_CMS(mps) ((int16_t)((mps) * 100.0 + ((mps) < 0 ? -0.5 : 0.5)))
+
+// Longest fixed_write output: sign, 20 digits, point (decimals <= 9, the
+// MAX_DECIMALS limit in fixed_point.c)
+#define FIXED_WRITE_MAX 23
+
+// Function prototypes
+bool fixed_parse(const char* text, size_t length, int decimals, int64_t* out);
+bool fixed_parse_microdegrees(const char* text, size_t length, int32_t* out);
+bool fixed_parse_speed(const char* text, size_t length, int16_t* out);
+bool fixed_from_double(double value, int decimals, int64_t* out);
+bool fixed_microdegrees_from_double(double degrees, int32_t* out);
+bool fixed_speed_from_double(double mps, int16_t* out);
+size_t fixed_write(char* out, int64_t value, int decimals);
+
+#endif // FIXED_POINT_H
@@ -1,172 +1,208 @@
 #include "hashmap.h"
 #include <string.h>
 #include <stdlib.h>
-#include <math.h>
-
-// Hash function (djb2 algorithm)
-static size_t hash(const char* key, size_t capacity) {
-    size_t hash_value = 5381;
-    int c;
-    while ((c = *key++)) {
-        hash_value = ((hash_value << 5) + hash_value) + c; // hash * 33 + c
-    }
-    return hash_value % capacity;
+
+uint64_t hashmap_hash_secret = 0xb54ccba3108928e3ULL;  // HASHMAP_DEFAULT_SEED, mixed
+
+// Seed the key hash; maps built under another seed must be rebuilt
+void hashmap_set_seed(uint64_t seed) {
+    hashmap_hash_secret = seed ^ hashmap_wy_mix(seed ^ HASHMAP_WY_P0, HASHMAP_WY_P1);
 }
 
-// Check if a number is prime
-static bool is_prime(size_t n) {
-    if (n < 2) return false;
-    for (size_t i = 2; i <= sqrt(n); i++) {
-        if (n % i == 0) return false;
-    }
-    return true;
+// Key of a stored slot in lookup form (string keys point at the slot's copy)
+void hashmap_entry_key(const Entry* entry, HashMapKey* key) {
+    device_key_lookup(&entry->key, entry->tag, key);
 }
 
-// Find the next prime number >= n
-static size_t next_prime(size_t n) {
-    while (!is_prime(n)) {
-        n++;
+// Hex decode table: low nibble is the digit value, high bits flag validity and case
+#define HEX_VALID 0x80
+#define HEX_UPPER 0x40
+#define HEX_LOWER 0x20
+static const uint8_t hex_table[256] = {
+    ['0'] = HEX_VALID | 0,
+    ['1'] = HEX_VALID | 1,
+    ['2'] = HEX_VALID | 2,
+    ['3'] = HEX_VALID | 3,
+    ['4'] = HEX_VALID | 4,
+    ['5'] = HEX_VALID | 5,
+    ['6'] = HEX_VALID | 6,
+    ['7'] = HEX_VALID | 7,
+    ['8'] = HEX_VALID | 8,
+    ['9'] = HEX_VALID | 9,
+    ['A'] = HEX_VALID | HEX_UPPER | 10,
+    ['B'] = HEX_VALID | HEX_UPPER | 11,
+    ['C'] = HEX_VALID | HEX_UPPER | 12,
+    ['D'] = HEX_VALID | HEX_UPPER | 13,
+    ['E'] = HEX_VALID | HEX_UPPER | 14,
+    ['F'] = HEX_VALID | HEX_UPPER | 15,
+    ['a'] = HEX_VALID | HEX_LOWER | 10,
+    ['b'] = HEX_VALID | HEX_LOWER | 11,
+    ['c'] = HEX_VALID | HEX_LOWER | 12,
+    ['d'] = HEX_VALID | HEX_LOWER | 13,
+    ['e'] = HEX_VALID | HEX_LOWER | 14,
+    ['f'] = HEX_VALID | HEX_LOWER | 15
+};
+
+// Offsets of the 32 hex digits in a canonical UUID
+static const uint8_t uuid_digit_offsets[32] = {
+    0, 1, 2, 3, 4, 5, 6, 7, 9, 10, 11, 12, 14, 15, 16, 17,
+    19, 20, 21, 22, 24, 25, 26, 27, 28, 29, 30, 31, 32, 33, 34, 35
+};
+
+// Parse key text once: canonical single-case UUIDs become two 64-bit words,
+// everything else (including mixed-case UUIDs) keeps the string path
+void hashmap_key_init(HashMapKey* key, const char* str, size_t length) {
+    key->str = str;
+    key->length = length;
+    key->hi = key->lo = 0;
+    key->kind = HASHMAP_KEY_STRING;
+    if (length != HASHMAP_UUID_LENGTH ||
+        str[8] != '-' || str[13] != '-' || str[18] != '-' || str[23] != '-') {
+        return;
     }
-    return n;
-}
 
-// Resize the hashmap when load factor exceeds 70%
-static void hashmap_resize(HashMap* map) {
-    size_t new_capacity = next_prime(map->capacity * 2);
-    Entry** new_entries = calloc(new_capacity, sizeof(Entry*));
-    if (!new_entries) return;
-
-    // Rehash all entries into the new table
-    for (size_t i = 0; i < map->capacity; i++) {
-        Entry* entry = map->entries[i];
-        while (entry) {
-            Entry* next = entry->next;
-            size_t new_index = hash(entry->key, new_capacity);
-            entry->next = new_entries[new_index];
-            new_entries[new_index] = entry;
-            entry = next;
+    // Branch-free decode: AND the flags to check validity, OR them to see the case
+    const unsigned char* p = (const unsigned char*)str;
+    uint64_t words[2] = {0, 0};
+    uint8_t all = 0xFF, any = 0;
+    for (int w = 0; w < 2; w++) {
+        for (int i = 0; i < 16; i++) {
+            uint8_t t = hex_table[p[uuid_digit_offsets[w * 16 + i]]];
+            all &= t;
+            any |= t;
+            words[w] = (words[w] << 4) | (t & 0x0F);
         }
     }
+    if (!(all & HEX_VALID)) return;
+    if ((any & HEX_UPPER) && (any & HEX_LOWER)) return;
+
+    key->hi = words[0];
+    key->lo = words[1];
+    key->kind = (any & HEX_UPPER) ? HASHMAP_KEY_UUID_UPPER : HASHMAP_KEY_UUID_LOWER;
+}
+
+// Write key text into buffer; returns its length (buffer needs length + 1 bytes)
+size_t hashmap_key_format(const HashMapKey* key, char* buffer, size_t size) {
+    if (key->kind == HASHMAP_KEY_STRING) {
+        if (size == 0) return key->length;
+        size_t n = key->length < size ? key->length : size - 1;
+        memcpy(buffer, key->str, n);
+        buffer[n] = '\0';
+        return key->length;
+    }
+    if (size <= HASHMAP_UUID_LENGTH) {
+        if (size > 0) buffer[0] = '\0';
+        return HASHMAP_UUID_LENGTH;
+    }
 
-    free(map->entries);
-    map->entries = new_entries;
-    map->capacity = new_capacity;
-    map->resize_threshold = (size_t)(new_capacity * 0.7);
+    const char* digits = key->kind == HASHMAP_KEY_UUID_UPPER ? "0123456789ABCDEF" : "0123456789abcdef";
+    int nibble = 0;
+    for (size_t i = 0; i < HASHMAP_UUID_LENGTH; i++) {
+        if (i == 8 || i == 13 || i == 18 || i == 23) {
+            buffer[i] = '-';
+            continue;
+        }
+        uint64_t word = nibble < 16 ? key->hi : key->lo;
+        buffer[i] = digits[(word >> ((15 - (nibble & 15)) * 4)) & 0xF];
+        nibble++;
+    }
+    buffer[HASHMAP_UUID_LENGTH] = '\0';
+    return HASHMAP_UUID_LENGTH;
 }
 
-// Create a hashmap with initial prime capacity
+// Create a hashmap with at least the given capacity, rounded up to a power of two
 HashMap* hashmap_create(size_t capacity) {
     HashMap* map = malloc(sizeof(HashMap));
     if (!map) return NULL;
-
-    map->capacity = next_prime(capacity);
-    map->entries = calloc(map->capacity, sizeof(Entry*));
-    if (!map->entries) {
+    if (!hashmap_table_init(map, capacity)) {
         free(map);
         return NULL;
     }
-    map->size = 0;
-    map->resize_threshold = (size_t)(map->capacity * 0.7);
     return map;
 }
 
+// Pre-size for an expected number of entries so inserts up to that count
+// never stop for a rehash; a map already large enough is left alone
+bool hashmap_reserve(HashMap* map, size_t expected_entries) {
+    return hashmap_table_reserve(map, expected_entries);
+}
+
 // Destroy the hashmap and free all memory
 void hashmap_destroy(HashMap* map) {
     if (!map) return;
-    for (size_t i = 0; i < map->capacity; ++i) {
-        Entry* entry = map->entries[i];
-        while (entry) {
-            Entry* next = entry->next;
-            free(entry->key);
-            free(entry);
-            entry = next;
-        }
-    }
-    free(map->entries);
+    hashmap_table_release(map);
     free(map);
 }
 
-// Insert or update a key with integer and float values
-bool hashmap_set(HashMap* map, const char* key, uint16_t value1, uint16_t value2, float latitude, float longitude) {
-    size_t index = hash(key, map->capacity);
-    Entry* entry = map->entries[index];
-
-    // Check for existing key and update
-    while (entry) {
-        if (strcmp(entry->key, key) == 0) {
-            entry->value1 = value1 & 0x0FFF; // 12-bit mask
-            entry->value2 = value2 & 0x0FFF;
-            entry->latitude = latitude;
-            entry->longitude = longitude;
-            return true;
-        }
-        entry = entry->next;
-    }
+// Insert or update a key with its time values and location (microdegrees)
+bool hashmap_set_key(HashMap* map, const HashMapKey* key, uint16_t value1, uint16_t value2, int32_t latitude, int32_t longitude) {
+    bool inserted;
+    Entry* entry = hashmap_table_upsert(map, key, &inserted);
+    if (!entry) return false;
+    entry->value1 = value1;
+    entry->value2 = value2;
+    entry->latitude = latitude;
+    entry->longitude = longitude;
+    return true;
+}
 
-    // Create new entry
-    Entry* new_entry = malloc(sizeof(Entry));
-    if (!new_entry) return false;
+// Find or insert in one hash and one probe: a miss inserts from the same hash
+Entry* hashmap_upsert_key(HashMap* map, const HashMapKey* key, bool* inserted) {
+    return hashmap_table_upsert(map, key, inserted);
+}
 
-    new_entry->key = malloc(strlen(key) + 1);
-    if (!new_entry->key) {
-        free(new_entry);
-        return false;
-    }
-    strcpy(new_entry->key, key);
-
-    new_entry->value1 = value1 & 0x0FFF;
-    new_entry->value2 = value2 & 0x0FFF;
-    new_entry->latitude = latitude;
-    new_entry->longitude = longitude;
-    new_entry->next = map->entries[index];
-    map->entries[index] = new_entry;
-    map->size++;
-
-    // Resize if load factor exceeds threshold
-    if (map->size > map->resize_threshold) {
-        hashmap_resize(map);
+// Read-modify-write through a merge callback. A new key the callback
+// declines to store is removed again.
+bool hashmap_upsert(HashMap* map, const HashMapKey* key, HashMapMergeFn merge, void* context) {
+    bool inserted;
+    Entry* entry = hashmap_table_upsert(map, key, &inserted);
+    if (!entry) return false;
+
+    uint16_t value1 = entry->value1, value2 = entry->value2;
+    int32_t latitude = entry->latitude, longitude = entry->longitude;
+    if (merge(!inserted, &value1, &value2, &latitude, &longitude, context)) {
+        entry->value1 = value1;
+        entry->value2 = value2;
+        entry->latitude = latitude;
+        entry->longitude = longitude;
+    } else if (inserted) {
+        hashmap_table_remove_slot(map, entry);
     }
     return true;
 }
 
 // Retrieve values for a key
-bool hashmap_get(HashMap* map, const char* key, uint16_t* value1, uint16_t* value2, float* latitude, float* longitude) {
-    size_t index = hash(key, map->capacity);
-    Entry* entry = map->entries[index];
-
-    while (entry) {
-        if (strcmp(entry->key, key) == 0) {
-            *value1 = entry->value1;
-            *value2 = entry->value2;
-            *latitude = entry->latitude;
-            *longitude = entry->longitude;
-            return true;
-        }
-        entry = entry->next;
-    }
-    return false;
+bool hashmap_get_key(HashMap* map, const HashMapKey* key, uint16_t* value1, uint16_t* value2, int32_t* latitude, int32_t* longitude) {
+    Entry* entry = hashmap_table_find(map, key, hashmap_key_hash(key));
+    if (!entry) return false;
+
+    *value1 = entry->value1;
+    *value2 = entry->value2;
+    *latitude = entry->latitude;
+    *longitude = entry->longitude;
+    return true;
+}
+
+// Delete a key-value pair, shifting the following cluster back one slot
+bool hashmap_delete_key(HashMap* map, const HashMapKey* key) {
+    return hashmap_table_remove(map, key);
+}
+
+// String-key wrappers: parse, then use the key path
+bool hashmap_set(HashMap* map, const char* key, uint16_t value1, uint16_t value2, int32_t latitude, int32_t longitude) {
+    HashMapKey parsed;
+    hashmap_key_init(&parsed, key, strlen(key));
+    return hashmap_set_key(map, &parsed, value1, value2, latitude, longitude);
+}
+
+bool hashmap_get(HashMap* map, const char* key, uint16_t* value1, uint16_t* value2, int32_t* latitude, int32_t* longitude) {
+    HashMapKey parsed;
+    hashmap_key_init(&parsed, key, strlen(key));
+    return hashmap_get_key(map, &parsed, value1, value2, latitude, longitude);
 }
 
-// Delete a key-value pair
 bool hashmap_delete(HashMap* map, const char* key) {
-    size_t index = hash(key, map->capacity);
-    Entry* entry = map->entries[index];
-    Entry* prev = NULL;
-
-    while (entry) {
-        if (strcmp(entry->key, key) == 0) {
-            if (prev) {
-                prev->next = entry->next;
-            } else {
-                map->entries[index] = entry->next;
-            }
-            free(entry->key);
-            free(entry);
-            map->size--;
-            return true;
-        }
-        prev = entry;
-        entry = entry->next;
-    }
-    return false;
-}
\ No newline at end of file
+    HashMapKey parsed;
+    hashmap_key_init(&parsed, key, strlen(key));
+    return hashmap_delete_key(map, &parsed);
+}
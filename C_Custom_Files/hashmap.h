@@ -4,28 +4,231 @@
 #include <stdint.h>
 #include <stdbool.h>
 #include <stdlib.h>
+#include <string.h>
+#include "arena.h"
 
-typedef struct Entry {
-    char* key;                  // Key (string)
-    uint16_t value1;            // First 12-bit integer
-    uint16_t value2;            // Second 12-bit integer
-    float latitude;             // Latitude (float)
-    float longitude;            // Longitude (float)
-    struct Entry* next;         // Pointer to next entry
-} Entry;
+// Key kinds: canonical UUIDs are stored as 128-bit binary, anything else as a string.
+// Lower/upper case is remembered so a binary key formats back to its original text.
+#define HASHMAP_KEY_STRING 0
+#define HASHMAP_KEY_UUID_LOWER 1
+#define HASHMAP_KEY_UUID_UPPER 2
 
+#define HASHMAP_UUID_LENGTH 36  // xxxxxxxx-xxxx-xxxx-xxxx-xxxxxxxxxxxx
+
+// Key hash seed until hashmap_set_seed. Fixed so map iteration order (and
+// with it output order) is reproducible; set a random seed when key ids may
+// be chosen to collide.
+#define HASHMAP_DEFAULT_SEED 0x2545F4914F6CDD1DULL
+
+// A key parsed once by the caller and reused across lookups
 typedef struct {
-    Entry** entries;            // Array of entry pointers
-    size_t capacity;            // Total capacity
-    size_t size;                // Current number of entries
-    size_t resize_threshold;    // Resize threshold (70% load factor)
-} HashMap;
+    uint64_t hi;                // UUID bits 127..64 (UUID keys)
+    uint64_t lo;                // UUID bits 63..0 (UUID keys)
+    const char* str;            // Key text (string keys, not owned)
+    size_t length;              // Key text length (string keys)
+    uint8_t kind;               // HASHMAP_KEY_*
+} HashMapKey;
+
+// A device key as stored in a table slot; the slot's tag byte holds its kind
+typedef union {
+    struct {
+        uint64_t hi;
+        uint64_t lo;
+    } uuid;                     // Binary UUID key
+    struct {
+        char* str;              // Arena copy of a non-UUID key
+        size_t length;
+    } string;
+} DeviceKey;
+
+// --- Key hash (wyhash), inline so table probes specialize on it ---
+
+#define HASHMAP_WY_P0 0xa0761d6478bd642fULL
+#define HASHMAP_WY_P1 0xe7037ed1a0b428dbULL
+#define HASHMAP_WY_P2 0x8ebc6af09c88c6e3ULL
+#define HASHMAP_WY_P3 0x589965cc75374cc3ULL
+
+extern uint64_t hashmap_hash_secret;    // Seed, mixed with the constants once
+
+// 64x64 -> 128 bit multiply, folded to 64 bits
+static inline uint64_t hashmap_wy_mix(uint64_t a, uint64_t b) {
+    __uint128_t product = (__uint128_t)a * b;
+    return (uint64_t)product ^ (uint64_t)(product >> 64);
+}
+
+static inline uint64_t hashmap_read64(const unsigned char* p) {
+    uint64_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static inline uint64_t hashmap_read32(const unsigned char* p) {
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+// Seeded hash for string keys (wyhash): 16 bytes per 128-bit multiply, three
+// independent lanes above 48 bytes so 64- and 128-hex ids pipeline well
+static inline uint64_t hashmap_hash_string(const char* key, size_t length) {
+    const unsigned char* p = (const unsigned char*)key;
+    uint64_t seed = hashmap_hash_secret, a, b;
+    if (length <= 16) {
+        if (length >= 4) {
+            size_t middle = (length >> 3) << 2;
+            a = (hashmap_read32(p) << 32) | hashmap_read32(p + middle);
+            b = (hashmap_read32(p + length - 4) << 32) | hashmap_read32(p + length - 4 - middle);
+        } else if (length > 0) {
+            a = ((uint64_t)p[0] << 16) | ((uint64_t)p[length >> 1] << 8) | p[length - 1];
+            b = 0;
+        } else {
+            a = b = 0;
+        }
+    } else {
+        size_t i = length;
+        if (i > 48) {
+            uint64_t lane1 = seed, lane2 = seed;
+            do {
+                seed = hashmap_wy_mix(hashmap_read64(p) ^ HASHMAP_WY_P1, hashmap_read64(p + 8) ^ seed);
+                lane1 = hashmap_wy_mix(hashmap_read64(p + 16) ^ HASHMAP_WY_P2, hashmap_read64(p + 24) ^ lane1);
+                lane2 = hashmap_wy_mix(hashmap_read64(p + 32) ^ HASHMAP_WY_P3, hashmap_read64(p + 40) ^ lane2);
+                p += 48;
+                i -= 48;
+            } while (i > 48);
+            seed ^= lane1 ^ lane2;
+        }
+        while (i > 16) {
+            seed = hashmap_wy_mix(hashmap_read64(p) ^ HASHMAP_WY_P1, hashmap_read64(p + 8) ^ seed);
+            p += 16;
+            i -= 16;
+        }
+        a = hashmap_read64(p + i - 16);
+        b = hashmap_read64(p + i - 8);
+    }
+    __uint128_t product = (__uint128_t)(a ^ HASHMAP_WY_P1) * (b ^ seed);
+    return hashmap_wy_mix((uint64_t)product ^ HASHMAP_WY_P0 ^ length, (uint64_t)(product >> 64) ^ HASHMAP_WY_P1);
+}
+
+// Hash for binary UUID keys: the 16-byte wyhash round over the two words
+static inline uint64_t hashmap_hash_uuid(uint64_t hi, uint64_t lo, uint8_t kind) {
+    __uint128_t product = (__uint128_t)(hi ^ HASHMAP_WY_P1) * (lo ^ hashmap_hash_secret);
+    return hashmap_wy_mix((uint64_t)product ^ HASHMAP_WY_P0 ^ kind, (uint64_t)(product >> 64) ^ HASHMAP_WY_P1);
+}
+
+static inline uint64_t hashmap_key_hash(const HashMapKey* key) {
+    if (key->kind == HASHMAP_KEY_STRING) return hashmap_hash_string(key->str, key->length);
+    return hashmap_hash_uuid(key->hi, key->lo, key->kind);
+}
+
+// --- Device key operations, as typed_map.h expects them ---
+
+static inline uint64_t device_key_hash(const HashMapKey* key) {
+    return hashmap_key_hash(key);
+}
+
+// Compare a stored key against a parsed key: two integer compares for UUIDs
+static inline bool device_key_matches(const DeviceKey* stored, uint8_t kind, const HashMapKey* key) {
+    if (kind != key->kind) return false;
+    if (key->kind != HASHMAP_KEY_STRING) {
+        return stored->uuid.hi == key->hi && stored->uuid.lo == key->lo;
+    }
+    return stored->string.length == key->length &&
+           memcmp(stored->string.str, key->str, key->length) == 0;
+}
+
+// String keys are copied into an arena per table, bump-allocated from
+// large blocks; a whole table's keys are freed in one go
+static inline void device_key_store_init(Arena* keys) {
+    arena_init(keys, ARENA_HUGE_PAGE_BYTES);
+}
+
+static inline void device_key_store_release(Arena* keys) {
+    arena_release(keys);
+}
+
+// Store a parsed key; string keys are copied to the table's arena
+static inline bool device_key_copy(Arena* keys, DeviceKey* stored, uint8_t* kind, const HashMapKey* key) {
+    *kind = key->kind;
+    if (key->kind != HASHMAP_KEY_STRING) {
+        stored->uuid.hi = key->hi;
+        stored->uuid.lo = key->lo;
+        return true;
+    }
+    stored->string.str = arena_alloc(keys, key->length + 1);
+    if (!stored->string.str) return false;
+    memcpy(stored->string.str, key->str, key->length);
+    stored->string.str[key->length] = '\0';
+    stored->string.length = key->length;
+    return true;
+}
+
+// A removed string key's bytes go on the arena's free list for the next key
+static inline void device_key_release(Arena* keys, DeviceKey* stored, uint8_t kind) {
+    if (kind == HASHMAP_KEY_STRING) arena_free(keys, stored->string.str, stored->string.length + 1);
+}
+
+// Stored key in lookup form (string keys point at the stored copy)
+static inline void device_key_lookup(const DeviceKey* stored, uint8_t kind, HashMapKey* key) {
+    key->kind = kind;
+    if (kind == HASHMAP_KEY_STRING) {
+        key->str = stored->string.str;
+        key->length = stored->string.length;
+        key->hi = key->lo = 0;
+    } else {
+        key->str = NULL;
+        key->length = HASHMAP_UUID_LENGTH;
+        key->hi = stored->uuid.hi;
+        key->lo = stored->uuid.lo;
+    }
+}
+
+// --- HashMap: device key to a time window and a location ---
+
+#define HASHMAP_FIELDS \
+    uint16_t value1;            /* First value (mobile_map_filter: earliest HHMM) */ \
+    uint16_t value2;            /* Second value (mobile_map_filter: latest HHMM) */ \
+    int32_t latitude;           /* Latitude (microdegrees) */ \
+    int32_t longitude;          /* Longitude (microdegrees) */
+
+#define TYPED_MAP_NAME HashMap
+#define TYPED_MAP_SLOT Entry
+#define TYPED_MAP_PREFIX hashmap_table
+#define TYPED_MAP_KEY HashMapKey
+#define TYPED_MAP_STORED DeviceKey
+#define TYPED_MAP_KEY_OPS device_key
+#define TYPED_MAP_KEY_STORE Arena
+#define TYPED_MAP_FIELDS HASHMAP_FIELDS
+#include "typed_map.h"
+
+// Merge callback for upserts: sees the current values (zeroed when found is
+// false) and edits them; returns true to store them
+typedef bool (*HashMapMergeFn)(bool found, uint16_t* value1, uint16_t* value2,
+                               int32_t* latitude, int32_t* longitude, void* context);
+
+// Key helpers
+void hashmap_set_seed(uint64_t seed);
+void hashmap_key_init(HashMapKey* key, const char* str, size_t length);
+size_t hashmap_key_format(const HashMapKey* key, char* buffer, size_t size);
+void hashmap_entry_key(const Entry* entry, HashMapKey* key);
 
 // Function prototypes
 HashMap* hashmap_create(size_t capacity);
+bool hashmap_reserve(HashMap* map, size_t expected_entries);
 void hashmap_destroy(HashMap* map);
-bool hashmap_set(HashMap* map, const char* key, uint16_t value1, uint16_t value2, float latitude, float longitude);
-bool hashmap_get(HashMap* map, const char* key, uint16_t* value1, uint16_t* value2, float* latitude, float* longitude);
+bool hashmap_set(HashMap* map, const char* key, uint16_t value1, uint16_t value2, int32_t latitude, int32_t longitude);
+bool hashmap_get(HashMap* map, const char* key, uint16_t* value1, uint16_t* value2, int32_t* latitude, int32_t* longitude);
 bool hashmap_delete(HashMap* map, const char* key);
 
-#endif // HASHMAP_H
\ No newline at end of file
+// Variants taking a pre-parsed key
+bool hashmap_set_key(HashMap* map, const HashMapKey* key, uint16_t value1, uint16_t value2, int32_t latitude, int32_t longitude);
+bool hashmap_get_key(HashMap* map, const HashMapKey* key, uint16_t* value1, uint16_t* value2, int32_t* latitude, int32_t* longitude);
+bool hashmap_delete_key(HashMap* map, const HashMapKey* key);
+
+// Single-probe read-modify-write. hashmap_upsert_key returns the key's slot,
+// inserted with zeroed values when absent (*inserted says which); the
+// pointer is valid until the next insert or delete. Hot loops can call the
+// inline hashmap_table_upsert instead. hashmap_upsert runs merge on the slot.
+Entry* hashmap_upsert_key(HashMap* map, const HashMapKey* key, bool* inserted);
+bool hashmap_upsert(HashMap* map, const HashMapKey* key, HashMapMergeFn merge, void* context);
+
+#endif // HASHMAP_H
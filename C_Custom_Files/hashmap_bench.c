@@ -0,0 +1,145 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "hashmap.h"
+
+#define DEFAULT_KEYS 2000000
+#define KEY_LENGTH 37  // 36-character UUID + terminator
+
+// Monotonic clock in seconds
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// xorshift64* generator so runs are reproducible
+static uint64_t rng_state = 0x9E3779B97F4A7C15ULL;
+static uint64_t next_random(void) {
+    rng_state ^= rng_state >> 12;
+    rng_state ^= rng_state << 25;
+    rng_state ^= rng_state >> 27;
+    return rng_state * 0x2545F4914F6CDD1DULL;
+}
+
+// Write a random lowercase UUID (same shape as advertiser_id) into out
+static void random_uuid(char* out) {
+    static const char hex[] = "0123456789abcdef";
+    uint64_t a = next_random();
+    uint64_t b = next_random();
+    for (int i = 0, n = 0; i < 36; i++) {
+        if (i == 8 || i == 13 || i == 18 || i == 23) {
+            out[i] = '-';
+            continue;
+        }
+        uint64_t word = n < 16 ? a : b;
+        out[i] = hex[(word >> ((n % 16) * 4)) & 0xF];
+        n++;
+    }
+    out[36] = '\0';
+}
+
+static void report(const char* label, size_t ops, double seconds) {
+    printf("%-12s %10zu ops  %8.3f s  %8.2f Mops/s  %7.1f ns/op\n",
+           label, ops, seconds, ops / seconds / 1e6, seconds * 1e9 / ops);
+}
+
+int main(int argc, char* argv[]) {
+    size_t n = argc > 1 ? strtoull(argv[1], NULL, 10) : DEFAULT_KEYS;
+    size_t initial_capacity = argc > 2 ? strtoull(argv[2], NULL, 10) : 2000003;
+
+    char* keys = malloc(n * KEY_LENGTH);
+    char* misses = malloc(n * KEY_LENGTH);
+    if (!keys || !misses) {
+        fprintf(stderr, "Out of memory generating keys\n");
+        return 1;
+    }
+    for (size_t i = 0; i < n; i++) {
+        random_uuid(keys + i * KEY_LENGTH);
+        random_uuid(misses + i * KEY_LENGTH);
+    }
+
+    // Probe in a shuffled order: pings do not arrive sorted by first-seen device,
+    // and sequential order would let chained nodes ride the hardware prefetcher
+    size_t* order = malloc(n * sizeof(size_t));
+    if (!order) {
+        fprintf(stderr, "Out of memory generating keys\n");
+        return 1;
+    }
+    for (size_t i = 0; i < n; i++) order[i] = i;
+    for (size_t i = n; i > 1; i--) {
+        size_t j = next_random() % i;
+        size_t tmp = order[i - 1];
+        order[i - 1] = order[j];
+        order[j] = tmp;
+    }
+
+    printf("hashmap_bench: %zu keys, initial capacity %zu\n", n, initial_capacity);
+
+    HashMap* map = hashmap_create(initial_capacity);
+    if (!map) {
+        fprintf(stderr, "Failed to create hashmap\n");
+        return 1;
+    }
+
+    double start = now_seconds();
+    for (size_t i = 0; i < n; i++) {
+        hashmap_set(map, keys + i * KEY_LENGTH, (uint16_t)i, (uint16_t)(i >> 12), 34000000, -118000000);
+    }
+    report("insert", n, now_seconds() - start);
+
+    uint16_t v1, v2;
+    int32_t lat, lon;
+    size_t found = 0;
+    start = now_seconds();
+    for (size_t i = 0; i < n; i++) {
+        found += hashmap_get(map, keys + order[i] * KEY_LENGTH, &v1, &v2, &lat, &lon);
+    }
+    report("lookup-hit", n, now_seconds() - start);
+
+    // Keys parsed once up front, as the ingest loop does per row
+    HashMapKey* parsed = malloc(n * sizeof(HashMapKey));
+    if (!parsed) {
+        fprintf(stderr, "Out of memory generating keys\n");
+        return 1;
+    }
+    for (size_t i = 0; i < n; i++) {
+        hashmap_key_init(&parsed[i], keys + i * KEY_LENGTH, KEY_LENGTH - 1);
+    }
+    size_t found_parsed = 0;
+    start = now_seconds();
+    for (size_t i = 0; i < n; i++) {
+        found_parsed += hashmap_get_key(map, &parsed[order[i]], &v1, &v2, &lat, &lon);
+    }
+    report("lookup-key", n, now_seconds() - start);
+
+    start = now_seconds();
+    for (size_t i = 0; i < n; i++) {
+        found += hashmap_get(map, misses + i * KEY_LENGTH, &v1, &v2, &lat, &lon);
+    }
+    report("lookup-miss", n, now_seconds() - start);
+
+    start = now_seconds();
+    for (size_t i = 0; i < n; i++) {
+        hashmap_set(map, keys + order[i] * KEY_LENGTH, (uint16_t)(i + 1), (uint16_t)i, 34500000, -118500000);
+    }
+    report("update", n, now_seconds() - start);
+
+    start = now_seconds();
+    for (size_t i = 0; i < n; i++) {
+        hashmap_delete(map, keys + order[i] * KEY_LENGTH);
+    }
+    report("delete", n, now_seconds() - start);
+
+    if (found != n || found_parsed != n) {
+        fprintf(stderr, "Unexpected lookup result: found %zu and %zu of %zu\n", found, found_parsed, n);
+    }
+
+    hashmap_destroy(map);
+    free(keys);
+    free(misses);
+    free(order);
+    free(parsed);
+    return found == n && found_parsed == n ? 0 : 1;
+}
@@ -0,0 +1,664 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <unistd.h>
+#include "hashmap.h"
+#include "concurrent_hashmap.h"
+
+// Microbenchmark suite for device maps: insert-heavy, lookup-hit,
+// lookup-miss, update-in-place, merge, delete-churn and destroy workloads at
+// several key counts, reporting ns/op percentiles. Operations are timed in batches of
+// -b ops (clock reads would otherwise dominate a ~20 ns op), so a
+// percentile is over per-batch averages; -b 1 times every op.
+//
+// Every implementation is driven through a MapImpl adapter taking raw key
+// text, as the ingest loops see it. Keys are generated, or read one per line
+// from a file with -f (e.g. advertiser ids cut from a day of pings). To compare a replacement map, add an
+// adapter for it to IMPLEMENTATIONS and pick it with -i.
+
+typedef struct {
+    const char* name;
+    void* (*create)(size_t expected_keys);  // 0: no size hint, start small
+    void (*destroy)(void* map);
+    bool (*set)(void* map, const char* key, size_t length, uint16_t value);
+    bool (*get)(void* map, const char* key, size_t length, uint16_t* value);
+    bool (*remove)(void* map, const char* key, size_t length);
+    // Fold a time into the key's [earliest, latest] window, as the ingest does
+    bool (*merge)(void* map, const char* key, size_t length, uint16_t time);
+    size_t (*capacity)(void* map);          // Slots, for the load factor
+    size_t (*probe_length)(void* map, size_t* longest);  // Summed over keys
+} MapImpl;
+
+#define UNSIZED_CAPACITY 1024
+#define DEFAULT_BATCH 16
+#define MAX_KEY_LENGTH 64
+#define KEY_STRIDE (MAX_KEY_LENGTH + 1)
+
+// --- HashMap, through the parsed-key API the tools use ---
+
+static void* hashmap_adapter_create(size_t expected_keys) {
+    HashMap* map = hashmap_create(UNSIZED_CAPACITY);
+    if (map && !hashmap_reserve(map, expected_keys)) {
+        hashmap_destroy(map);
+        return NULL;
+    }
+    return map;
+}
+
+static void hashmap_adapter_destroy(void* map) {
+    hashmap_destroy(map);
+}
+
+static bool hashmap_adapter_set(void* map, const char* key, size_t length, uint16_t value) {
+    HashMapKey parsed;
+    hashmap_key_init(&parsed, key, length);
+    return hashmap_set_key(map, &parsed, value, value, 34000000, -118000000);
+}
+
+static bool hashmap_adapter_get(void* map, const char* key, size_t length, uint16_t* value) {
+    HashMapKey parsed;
+    hashmap_key_init(&parsed, key, length);
+    uint16_t other;
+    int32_t latitude, longitude;
+    return hashmap_get_key(map, &parsed, value, &other, &latitude, &longitude);
+}
+
+static bool hashmap_adapter_remove(void* map, const char* key, size_t length) {
+    HashMapKey parsed;
+    hashmap_key_init(&parsed, key, length);
+    return hashmap_delete_key(map, &parsed);
+}
+
+static size_t hashmap_adapter_capacity(void* map) {
+    return ((HashMap*)map)->capacity;
+}
+
+// Slots a lookup visits to reach each key: its stored probe distance
+static size_t hashmap_adapter_probe_length(void* map, size_t* longest) {
+    const HashMap* hmap = map;
+    size_t total = 0;
+    for (size_t i = 0; i < hmap->capacity; i++) {
+        uint8_t dist = hmap->slots[i].dist;
+        total += dist;
+        if (dist > *longest) *longest = dist;
+    }
+    return total;
+}
+
+// The window rule of mobile_map_filter's update_device; 0 is unset
+static bool merge_window(bool found, uint16_t* value1, uint16_t* value2,
+                         int32_t* latitude, int32_t* longitude, void* context) {
+    uint16_t time = *(const uint16_t*)context;
+    bool new_min = !found || *value1 == 0 || time < *value1;
+    bool new_max = !found || *value2 == 0 || time > *value2;
+    if (new_min) {
+        *value1 = time;
+        *latitude = 34000000;
+        *longitude = -118000000;
+    }
+    if (new_max) *value2 = time;
+    return new_min || new_max;
+}
+
+static bool hashmap_adapter_merge(void* map, const char* key, size_t length, uint16_t time) {
+    HashMapKey parsed;
+    hashmap_key_init(&parsed, key, length);
+    return hashmap_upsert(map, &parsed, merge_window, &time);
+}
+
+// The same merge as a lookup then a store: two probes per op
+static bool hashmap_getset_adapter_merge(void* map, const char* key, size_t length, uint16_t time) {
+    HashMapKey parsed;
+    hashmap_key_init(&parsed, key, length);
+    uint16_t value1 = 0, value2 = 0;
+    int32_t latitude = 0, longitude = 0;
+    bool found = hashmap_get_key(map, &parsed, &value1, &value2, &latitude, &longitude);
+    if (!merge_window(found, &value1, &value2, &latitude, &longitude, &time)) return true;
+    return hashmap_set_key(map, &parsed, value1, value2, latitude, longitude);
+}
+
+// --- ConcurrentHashMap on one thread: HashMap plus striping and locks ---
+
+static void* chashmap_adapter_create(size_t expected_keys) {
+    return chashmap_create(expected_keys ? expected_keys * 10 / 7 + 1 : UNSIZED_CAPACITY, CHASHMAP_DEFAULT_SHARDS);
+}
+
+static void chashmap_adapter_destroy(void* map) {
+    chashmap_destroy(map);
+}
+
+static bool chashmap_adapter_set(void* map, const char* key, size_t length, uint16_t value) {
+    HashMapKey parsed;
+    hashmap_key_init(&parsed, key, length);
+    return chashmap_set(map, &parsed, value, value, 34000000, -118000000);
+}
+
+static bool chashmap_adapter_get(void* map, const char* key, size_t length, uint16_t* value) {
+    HashMapKey parsed;
+    hashmap_key_init(&parsed, key, length);
+    uint16_t other;
+    int32_t latitude, longitude;
+    return chashmap_get(map, &parsed, value, &other, &latitude, &longitude);
+}
+
+static bool chashmap_adapter_remove(void* map, const char* key, size_t length) {
+    HashMapKey parsed;
+    hashmap_key_init(&parsed, key, length);
+    return chashmap_delete(map, &parsed);
+}
+
+static bool chashmap_adapter_merge(void* map, const char* key, size_t length, uint16_t time) {
+    HashMapKey parsed;
+    hashmap_key_init(&parsed, key, length);
+    return chashmap_upsert(map, &parsed, merge_window, &time);
+}
+
+static size_t chashmap_adapter_capacity(void* map) {
+    ConcurrentHashMap* cmap = map;
+    size_t capacity = 0;
+    for (size_t i = 0; i < cmap->shard_count; i++) capacity += cmap->shards[i].map->capacity;
+    return capacity;
+}
+
+static size_t chashmap_adapter_probe_length(void* map, size_t* longest) {
+    ConcurrentHashMap* cmap = map;
+    size_t total = 0;
+    for (size_t i = 0; i < cmap->shard_count; i++) total += hashmap_adapter_probe_length(cmap->shards[i].map, longest);
+    return total;
+}
+
+static const MapImpl IMPLEMENTATIONS[] = {
+    { "hashmap", hashmap_adapter_create, hashmap_adapter_destroy, hashmap_adapter_set,
+      hashmap_adapter_get, hashmap_adapter_remove, hashmap_adapter_merge, hashmap_adapter_capacity,
+      hashmap_adapter_probe_length },
+    { "hashmap-getset", hashmap_adapter_create, hashmap_adapter_destroy, hashmap_adapter_set,
+      hashmap_adapter_get, hashmap_adapter_remove, hashmap_getset_adapter_merge, hashmap_adapter_capacity,
+      hashmap_adapter_probe_length },
+    { "chashmap", chashmap_adapter_create, chashmap_adapter_destroy, chashmap_adapter_set,
+      chashmap_adapter_get, chashmap_adapter_remove, chashmap_adapter_merge, chashmap_adapter_capacity,
+      chashmap_adapter_probe_length },
+};
+#define IMPLEMENTATION_COUNT (sizeof(IMPLEMENTATIONS) / sizeof(IMPLEMENTATIONS[0]))
+
+// --- Keys and access patterns ---
+
+typedef enum { KEYS_UUID, KEYS_HEX, KEYS_SEQUENTIAL } KeyShape;
+
+typedef struct {
+    char* text;                 // count keys, stride bytes apart
+    uint8_t* lengths;
+    size_t count;
+    size_t stride;
+} KeySet;
+
+// xorshift64* generator so runs are reproducible
+static uint64_t rng_state = 0x9E3779B97F4A7C15ULL;
+static uint64_t next_random(void) {
+    rng_state ^= rng_state >> 12;
+    rng_state ^= rng_state << 25;
+    rng_state ^= rng_state >> 27;
+    return rng_state * 0x2545F4914F6CDD1DULL;
+}
+
+static double next_uniform(void) {
+    return (next_random() >> 11) * 0x1.0p-53;
+}
+
+// UUIDs take the binary key path, 64-hex hashed ids and sequential ids
+// (a shared prefix plus a counter, the worst case for a weak string hash)
+// the string path
+static size_t make_key(char* out, KeyShape shape, size_t index) {
+    static const char hex[] = "0123456789abcdef";
+    if (shape == KEYS_SEQUENTIAL) {
+        return (size_t)snprintf(out, KEY_STRIDE, "device-%012zu", index);
+    }
+    size_t length = shape == KEYS_UUID ? 36 : 64;
+    uint64_t bits = 0;
+    for (size_t i = 0, n = 0; i < length; i++) {
+        if (shape == KEYS_UUID && (i == 8 || i == 13 || i == 18 || i == 23)) {
+            out[i] = '-';
+            continue;
+        }
+        if (n % 16 == 0) bits = next_random();
+        out[i] = hex[bits & 15];
+        bits >>= 4;
+        n++;
+    }
+    out[length] = '\0';
+    return length;
+}
+
+static bool make_keys(KeySet* keys, KeyShape shape, size_t count) {
+    keys->text = malloc(count * KEY_STRIDE);
+    keys->lengths = malloc(count);
+    keys->count = count;
+    keys->stride = KEY_STRIDE;
+    if (!keys->text || !keys->lengths) return false;
+    for (size_t i = 0; i < count; i++) {
+        keys->lengths[i] = (uint8_t)make_key(keys->text + i * KEY_STRIDE, shape, i);
+    }
+    return true;
+}
+
+// Read one key per line, shuffled so a sorted file still probes at random.
+// The stride fits the longest key; empty and over-long lines are skipped.
+static bool load_keys(KeySet* keys, const char* path) {
+    FILE* f = fopen(path, "r");
+    if (!f) return false;
+    char* line = NULL;
+    size_t line_capacity = 0, stride = 1;
+    ssize_t length;
+    keys->count = 0;
+    while ((length = getline(&line, &line_capacity, f)) > 0) {
+        while (length > 0 && (line[length - 1] == '\n' || line[length - 1] == '\r')) length--;
+        if (length == 0 || length > UINT8_MAX) continue;
+        keys->count++;
+        if ((size_t)length + 1 > stride) stride = (size_t)length + 1;
+    }
+    keys->stride = stride;
+    keys->text = malloc(keys->count * stride);
+    keys->lengths = malloc(keys->count);
+    bool ok = keys->text && keys->lengths;
+    rewind(f);
+    for (size_t i = 0; ok && i < keys->count && (length = getline(&line, &line_capacity, f)) > 0; ) {
+        while (length > 0 && (line[length - 1] == '\n' || line[length - 1] == '\r')) length--;
+        if (length == 0 || length > UINT8_MAX) continue;
+        memcpy(keys->text + i * stride, line, (size_t)length);
+        keys->text[i * stride + length] = '\0';
+        keys->lengths[i++] = (uint8_t)length;
+    }
+    free(line);
+    fclose(f);
+    for (size_t i = keys->count; ok && i > 1; i--) {
+        size_t j = next_random() % i;
+        char swap[UINT8_MAX + 1];
+        memcpy(swap, keys->text + (i - 1) * stride, stride);
+        memcpy(keys->text + (i - 1) * stride, keys->text + j * stride, stride);
+        memcpy(keys->text + j * stride, swap, stride);
+        uint8_t swap_length = keys->lengths[i - 1];
+        keys->lengths[i - 1] = keys->lengths[j];
+        keys->lengths[j] = swap_length;
+    }
+    return ok;
+}
+
+static void free_keys(KeySet* keys) {
+    free(keys->text);
+    free(keys->lengths);
+}
+
+// Access order over count keys: a shuffle, or zipf-like skew (P(k) ~ 1/k,
+// hot ranks scattered over the key set) as with a few chatty devices
+static uint32_t* make_order(size_t count, bool skewed) {
+    uint32_t* order = malloc(count * sizeof(uint32_t));
+    uint32_t* rank = malloc(count * sizeof(uint32_t));
+    if (!order || !rank) {
+        free(order);
+        free(rank);
+        return NULL;
+    }
+    for (size_t i = 0; i < count; i++) rank[i] = (uint32_t)i;
+    for (size_t i = count; i > 1; i--) {
+        size_t j = next_random() % i;
+        uint32_t tmp = rank[i - 1];
+        rank[i - 1] = rank[j];
+        rank[j] = tmp;
+    }
+    if (!skewed) {
+        free(order);
+        return rank;
+    }
+    double log_count = log((double)count + 1.0);
+    for (size_t i = 0; i < count; i++) {
+        size_t k = (size_t)exp(next_uniform() * log_count) - 1;
+        order[i] = rank[k < count ? k : count - 1];
+    }
+    free(rank);
+    return order;
+}
+
+// --- Timing ---
+
+typedef struct {
+    double* samples;            // ns/op per batch
+    size_t count;
+    size_t capacity;
+    size_t ops;
+    uint64_t total_ns;
+} Timing;
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+static void timing_reset(Timing* timing) {
+    timing->count = 0;
+    timing->ops = 0;
+    timing->total_ns = 0;
+}
+
+static void timing_add(Timing* timing, uint64_t ns, size_t ops) {
+    if (timing->count == timing->capacity) {
+        size_t capacity = timing->capacity ? timing->capacity * 2 : 4096;
+        double* samples = realloc(timing->samples, capacity * sizeof(double));
+        if (!samples) return;
+        timing->samples = samples;
+        timing->capacity = capacity;
+    }
+    timing->samples[timing->count++] = (double)ns / ops;
+    timing->ops += ops;
+    timing->total_ns += ns;
+}
+
+static int compare_doubles(const void* a, const void* b) {
+    double x = *(const double*)a, y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+static double percentile(const Timing* timing, double p) {
+    if (timing->count == 0) return 0;
+    size_t index = (size_t)(p / 100.0 * (timing->count - 1) + 0.5);
+    return timing->samples[index];
+}
+
+static void report(const char* impl, size_t keys, const char* workload, Timing* timing, double load) {
+    qsort(timing->samples, timing->count, sizeof(double), compare_doubles);
+    double mean = timing->ops ? (double)timing->total_ns / timing->ops : 0;
+    printf("%-14s %9zu  %-13s %9zu %8.2f %8.1f %8.1f %8.1f %8.1f %9.1f %10.1f  %.2f\n",
+           impl, keys, workload, timing->ops, mean > 0 ? 1e3 / mean : 0, mean,
+           percentile(timing, 50), percentile(timing, 90), percentile(timing, 99), percentile(timing, 99.9),
+           timing->count ? timing->samples[timing->count - 1] : 0, load);
+}
+
+// --- Workloads ---
+
+typedef struct {
+    const MapImpl* impl;
+    const KeySet* keys;         // [0, n) are inserted, [n, 2n) are never present
+    size_t n;
+    const uint32_t* order;      // n indices into [0, n)
+    size_t batch;
+    Timing timing;
+    size_t failures;
+} Suite;
+
+#define KEY(suite, i) ((suite)->keys->text + (size_t)(i) * (suite)->keys->stride), ((suite)->keys->lengths[(i)])
+
+static double load_factor(const Suite* suite, void* map, size_t size) {
+    size_t capacity = suite->impl->capacity(map);
+    return capacity ? (double)size / capacity : 0;
+}
+
+static void run_insert(Suite* suite, void* map, size_t first) {
+    timing_reset(&suite->timing);
+    for (size_t i = 0; i < suite->n; i += suite->batch) {
+        size_t end = i + suite->batch < suite->n ? i + suite->batch : suite->n;
+        uint64_t start = now_ns();
+        for (size_t j = i; j < end; j++) {
+            suite->failures += !suite->impl->set(map, KEY(suite, first + j), (uint16_t)j);
+        }
+        timing_add(&suite->timing, now_ns() - start, end - i);
+    }
+}
+
+static void run_lookup(Suite* suite, void* map, bool hit) {
+    timing_reset(&suite->timing);
+    uint16_t value;
+    for (size_t i = 0; i < suite->n; i += suite->batch) {
+        size_t end = i + suite->batch < suite->n ? i + suite->batch : suite->n;
+        size_t found = 0;
+        uint64_t start = now_ns();
+        for (size_t j = i; j < end; j++) {
+            size_t k = hit ? suite->order[j] : suite->n + suite->order[j];
+            found += suite->impl->get(map, KEY(suite, k), &value);
+        }
+        timing_add(&suite->timing, now_ns() - start, end - i);
+        suite->failures += hit ? (end - i) - found : found;
+    }
+}
+
+static void run_update(Suite* suite, void* map) {
+    timing_reset(&suite->timing);
+    for (size_t i = 0; i < suite->n; i += suite->batch) {
+        size_t end = i + suite->batch < suite->n ? i + suite->batch : suite->n;
+        uint64_t start = now_ns();
+        for (size_t j = i; j < end; j++) {
+            suite->failures += !suite->impl->set(map, KEY(suite, suite->order[j]), (uint16_t)(j + 1));
+        }
+        timing_add(&suite->timing, now_ns() - start, end - i);
+    }
+}
+
+// Keys the access order touches: all n when uniform, fewer under skew
+static size_t distinct_keys(const Suite* suite) {
+    uint8_t* seen = calloc(suite->n, 1);
+    if (!seen) return suite->n;
+    size_t count = 0;
+    for (size_t i = 0; i < suite->n; i++) {
+        count += !seen[suite->order[i]];
+        seen[suite->order[i]] = 1;
+    }
+    free(seen);
+    return count;
+}
+
+// Ingest-shaped read-modify-write on a fresh map: two passes over the
+// access order, so the first touch of a key inserts and later ones merge
+static void run_merge(Suite* suite, void* map) {
+    timing_reset(&suite->timing);
+    for (size_t i = 0; i < 2 * suite->n; i += suite->batch) {
+        size_t end = i + suite->batch < 2 * suite->n ? i + suite->batch : 2 * suite->n;
+        uint64_t start = now_ns();
+        for (size_t j = i; j < end; j++) {
+            uint16_t time = (uint16_t)(j % 2359 + 1);
+            suite->failures += !suite->impl->merge(map, KEY(suite, suite->order[j % suite->n]), time);
+        }
+        timing_add(&suite->timing, now_ns() - start, end - i);
+    }
+}
+
+// Steady-state churn at n keys: each op pair drops a live key and adds a
+// new one (key n + j takes the place of key j, in insertion order)
+static void run_churn(Suite* suite, void* map) {
+    timing_reset(&suite->timing);
+    for (size_t i = 0; i < suite->n; i += suite->batch) {
+        size_t end = i + suite->batch < suite->n ? i + suite->batch : suite->n;
+        uint64_t start = now_ns();
+        for (size_t j = i; j < end; j++) {
+            suite->failures += !suite->impl->remove(map, KEY(suite, j));
+            suite->failures += !suite->impl->set(map, KEY(suite, suite->n + j), (uint16_t)j);
+        }
+        timing_add(&suite->timing, now_ns() - start, 2 * (end - i));
+    }
+}
+
+// Whether name is an item of a comma-separated list (NULL: everything)
+static bool list_contains(const char* list, const char* name) {
+    if (!list) return true;
+    size_t length = strlen(name);
+    for (const char* p = list; (p = strstr(p, name)) != NULL; p += length) {
+        if ((p == list || p[-1] == ',') && (p[length] == ',' || p[length] == '\0')) return true;
+    }
+    return false;
+}
+
+// One implementation at one size. Churn runs last on the grown map since
+// it leaves a different key set behind; presized inserts and merges get a
+// fresh map.
+static void run_suite(Suite* suite, const char* workloads) {
+    const char* name = suite->impl->name;
+    void* map = suite->impl->create(0);
+    if (!map) {
+        fprintf(stderr, "%s: create failed\n", name);
+        suite->failures++;
+        return;
+    }
+    run_insert(suite, map, 0);
+    if (list_contains(workloads, "insert")) report(name, suite->n, "insert", &suite->timing, load_factor(suite, map, suite->n));
+    double load = load_factor(suite, map, suite->n);
+    if (list_contains(workloads, "probe-length")) {
+        size_t longest = 0;
+        size_t total = suite->impl->probe_length(map, &longest);
+        printf("%-14s %9zu  %-13s mean %.3f slots, longest %zu, at load %.2f\n",
+               name, suite->n, "probe-length", (double)total / suite->n, longest, load);
+    }
+    if (list_contains(workloads, "lookup-hit")) {
+        run_lookup(suite, map, true);
+        report(name, suite->n, "lookup-hit", &suite->timing, load);
+    }
+    if (list_contains(workloads, "lookup-miss")) {
+        run_lookup(suite, map, false);
+        report(name, suite->n, "lookup-miss", &suite->timing, load);
+    }
+    if (list_contains(workloads, "update")) {
+        run_update(suite, map);
+        report(name, suite->n, "update", &suite->timing, load);
+    }
+    if (list_contains(workloads, "delete-churn")) {
+        run_churn(suite, map);
+        report(name, suite->n, "delete-churn", &suite->timing, load_factor(suite, map, suite->n));
+    }
+    // Teardown is one call, timed whole: what a day turnover pays per map
+    uint64_t start = now_ns();
+    suite->impl->destroy(map);
+    if (list_contains(workloads, "destroy")) {
+        double elapsed = (double)(now_ns() - start);
+        printf("%-14s %9zu  %-13s %.3f ms, %.2f ns/key\n",
+               name, suite->n, "destroy", elapsed / 1e6, elapsed / suite->n);
+    }
+
+    if (list_contains(workloads, "insert-sized")) {
+        map = suite->impl->create(suite->n);
+        if (!map) {
+            fprintf(stderr, "%s: create failed\n", name);
+            suite->failures++;
+            return;
+        }
+        run_insert(suite, map, 0);
+        report(name, suite->n, "insert-sized", &suite->timing, load_factor(suite, map, suite->n));
+        suite->impl->destroy(map);
+    }
+
+    if (list_contains(workloads, "merge")) {
+        map = suite->impl->create(0);
+        if (!map) {
+            fprintf(stderr, "%s: create failed\n", name);
+            suite->failures++;
+            return;
+        }
+        run_merge(suite, map);
+        report(name, suite->n, "merge", &suite->timing, load_factor(suite, map, distinct_keys(suite)));
+        suite->impl->destroy(map);
+    }
+}
+
+static void usage(const char* program) {
+    fprintf(stderr, "Usage: %s [-i impl,...] [-n keys,...] [-k uuid|hex|sequential] [-f key_file] [-a uniform|zipf] "
+            "[-b batch] [-w workload,...] [-H]\n", program);
+    fprintf(stderr, "  implementations:");
+    for (size_t i = 0; i < IMPLEMENTATION_COUNT; i++) fprintf(stderr, " %s", IMPLEMENTATIONS[i].name);
+    fprintf(stderr, "\n  workloads: insert lookup-hit lookup-miss update delete-churn insert-sized merge probe-length destroy\n");
+    fprintf(stderr, "  -H backs key arenas with huge pages\n");
+}
+
+int main(int argc, char* argv[]) {
+    const char* impl_list = NULL;
+    const char* size_list = "10000,100000,1000000,10000000";
+    const char* workloads = NULL;
+    const char* key_file = NULL;
+    KeyShape shape = KEYS_UUID;
+    bool skewed = false;
+    size_t batch = DEFAULT_BATCH;
+    int opt;
+    while ((opt = getopt(argc, argv, "i:n:k:f:a:b:w:H")) != -1) {
+        switch (opt) {
+            case 'i': impl_list = optarg; break;
+            case 'n': size_list = optarg; break;
+            case 'w': workloads = optarg; break;
+            case 'f': key_file = optarg; break;
+            case 'b': batch = strtoull(optarg, NULL, 10); break;
+            case 'H': arena_set_huge_pages(true); break;
+            case 'k':
+                if (strcmp(optarg, "uuid") == 0) shape = KEYS_UUID;
+                else if (strcmp(optarg, "hex") == 0) shape = KEYS_HEX;
+                else if (strcmp(optarg, "sequential") == 0) shape = KEYS_SEQUENTIAL;
+                else { usage(argv[0]); return 1; }
+                break;
+            case 'a':
+                if (strcmp(optarg, "uniform") == 0) skewed = false;
+                else if (strcmp(optarg, "zipf") == 0) skewed = true;
+                else { usage(argv[0]); return 1; }
+                break;
+            default:
+                usage(argv[0]);
+                return 1;
+        }
+    }
+    if (batch < 1) batch = 1;
+    for (size_t i = 0; impl_list && i < IMPLEMENTATION_COUNT; i++) {
+        if (list_contains(impl_list, IMPLEMENTATIONS[i].name)) break;
+        if (i + 1 == IMPLEMENTATION_COUNT) {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+
+    // File keys are loaded once; each size takes its first 2n
+    KeySet file_keys = {0};
+    if (key_file && !load_keys(&file_keys, key_file)) {
+        fprintf(stderr, "Failed to read keys from %s\n", key_file);
+        free_keys(&file_keys);
+        return 1;
+    }
+
+    printf("hashmap_suite: %s keys, %s access, %zu ops per timed batch\n",
+           key_file ? key_file : shape == KEYS_UUID ? "uuid" : shape == KEYS_HEX ? "hex" : "sequential",
+           skewed ? "zipf" : "uniform", batch);
+    printf("%-14s %9s  %-13s %9s %8s %8s %8s %8s %8s %9s %10s  %s\n", "impl", "keys", "workload", "ops",
+           "Mops/s", "mean ns", "p50", "p90", "p99", "p99.9", "max", "load");
+
+    size_t failures = 0;
+    for (const char* p = size_list; *p; ) {
+        char* end;
+        size_t n = strtoull(p, &end, 10);
+        p = *end == ',' ? end + 1 : end;
+        if (n == 0 || n > UINT32_MAX / 2) {
+            if (*end && *end != ',') break;
+            continue;
+        }
+
+        if (key_file && n > file_keys.count / 2) {
+            fprintf(stderr, "%s holds %zu keys, too few for %zu\n", key_file, file_keys.count, n);
+            continue;
+        }
+
+        rng_state = 0x9E3779B97F4A7C15ULL;
+        KeySet keys = file_keys;
+        uint32_t* order = NULL;
+        if ((!key_file && !make_keys(&keys, shape, 2 * n)) || !(order = make_order(n, skewed))) {
+            fprintf(stderr, "Out of memory generating %zu keys\n", 2 * n);
+            if (!key_file) free_keys(&keys);
+            free_keys(&file_keys);
+            return 1;
+        }
+        for (size_t i = 0; i < IMPLEMENTATION_COUNT; i++) {
+            if (impl_list && !list_contains(impl_list, IMPLEMENTATIONS[i].name)) continue;
+            Suite suite = { &IMPLEMENTATIONS[i], &keys, n, order, batch, {0}, 0 };
+            run_suite(&suite, workloads);
+            free(suite.timing.samples);
+            failures += suite.failures;
+        }
+        free(order);
+        if (!key_file) free_keys(&keys);
+    }
+    free_keys(&file_keys);
+
+    if (failures) {
+        fprintf(stderr, "%zu operations failed or returned unexpected results\n", failures);
+    }
+    return failures ? 1 : 0;
+}
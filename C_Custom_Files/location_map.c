@@ -0,0 +1,158 @@
+#include "location_map.h"
+#include <string.h>
+#include <stdlib.h>
+
+#define PING_BLOCK_SIZE (4u << 20)      // Bytes per pool block
+#define FIRST_CHUNK_POINTS 4            // A device's first chunk
+#define MAX_CHUNK_POINTS 1024           // Chunks double up to this size
+
+// Bump-allocate a chunk from the pool
+static PingChunk* alloc_chunk(LocationMap* map, uint32_t capacity) {
+    PingChunk* chunk = arena_alloc(&map->pings, sizeof(PingChunk) + (size_t)capacity * sizeof(LocationPoint));
+    if (!chunk) return NULL;
+    chunk->next = NULL;
+    chunk->count = 0;
+    chunk->capacity = capacity;
+    return chunk;
+}
+
+// Create a location map sized for roughly capacity devices
+LocationMap* location_map_create(size_t capacity) {
+    LocationMap* map = malloc(sizeof(LocationMap));
+    if (!map) return NULL;
+
+    if (!device_table_init(&map->devices, typed_map_capacity_for(capacity))) {
+        free(map);
+        return NULL;
+    }
+    map->ping_count = 0;
+    arena_init(&map->pings, PING_BLOCK_SIZE);
+    return map;
+}
+
+// Destroy the map: the slot table and key arena, then the ping pool, each
+// freed in whole blocks
+void location_map_destroy(LocationMap* map) {
+    if (!map) return;
+    device_table_release(&map->devices);
+    arena_release(&map->pings);
+    free(map);
+}
+
+// Append one ping to a device's chunk list
+bool location_map_append(LocationMap* map, const HashMapKey* key, const LocationPoint* point) {
+    bool inserted;
+    DeviceSlot* slot = device_table_upsert(&map->devices, key, &inserted);
+    if (!slot) return false;
+
+    PingChunk* tail = slot->tail;
+    if (!tail || tail->count == tail->capacity) {
+        uint32_t capacity = tail ? tail->capacity * 2 : FIRST_CHUNK_POINTS;
+        if (capacity > MAX_CHUNK_POINTS) capacity = MAX_CHUNK_POINTS;
+        PingChunk* chunk = alloc_chunk(map, capacity);
+        if (!chunk) return false;
+        if (tail) tail->next = chunk; else slot->head = chunk;
+        slot->tail = tail = chunk;
+    }
+    tail->points[tail->count++] = *point;
+    slot->count++;
+    map->ping_count++;
+    return true;
+}
+
+// Convenience wrapper taking the advertiser id as text
+bool location_map_add(LocationMap* map, const char* advertiser_id, time_t timestamp, int32_t latitude, int32_t longitude, int16_t speed) {
+    HashMapKey key;
+    hashmap_key_init(&key, advertiser_id, strlen(advertiser_id));
+    LocationPoint point = { timestamp, latitude, longitude, speed };
+    return location_map_append(map, &key, &point);
+}
+
+// Move every device's pings from src into dst and destroy src. Chunk lists are
+// spliced rather than copied: dst adopts src's pool blocks first, so nothing is
+// lost even if dst cannot grow midway (that device's pings are then dropped).
+bool location_map_merge(LocationMap* dst, LocationMap* src) {
+    arena_adopt(&dst->pings, &src->pings);
+
+    bool ok = true;
+    for (size_t i = 0; i < src->devices.capacity; i++) {
+        DeviceSlot* from = &src->devices.slots[i];
+        if (from->dist == 0) continue;
+        HashMapKey key;
+        bool inserted;
+        device_key_lookup(&from->key, from->tag, &key);
+        DeviceSlot* to = device_table_upsert_hashed(&dst->devices, &key, from->hash, &inserted);
+        if (!to) {
+            ok = false;
+            continue;
+        }
+        if (to->tail) to->tail->next = from->head; else to->head = from->head;
+        to->tail = from->tail;
+        to->count += from->count;
+        dst->ping_count += from->count;
+    }
+
+    location_map_destroy(src);
+    return ok;
+}
+
+// Bytes held by the slot table, the key arena and the ping pool
+size_t location_map_memory_usage(const LocationMap* map) {
+    return sizeof(LocationMap) + map->devices.capacity * sizeof(DeviceSlot) +
+           map->devices.keys.reserved + map->pings.reserved;
+}
+
+LocationMapIterator* location_map_iterator_create(LocationMap* map) {
+    LocationMapIterator* iterator = calloc(1, sizeof(LocationMapIterator));
+    if (!iterator) return NULL;
+    iterator->map = map;
+    return iterator;
+}
+
+// Advance to the next device. Single-chunk devices are returned in place;
+// longer lists are gathered into the iterator's reusable scratch buffer.
+bool location_map_iterator_next(LocationMapIterator* iterator, const char** advertiser_id, LocationArray** locations) {
+    DeviceTable* devices = &iterator->map->devices;
+    while (iterator->index < devices->capacity && devices->slots[iterator->index].dist == 0) {
+        iterator->index++;
+    }
+    if (iterator->index >= devices->capacity) return false;
+
+    DeviceSlot* slot = &devices->slots[iterator->index++];
+    if (slot->head == slot->tail) {
+        iterator->current.points = slot->head->points;
+    } else {
+        if (slot->count > iterator->scratch_capacity) {
+            size_t capacity = iterator->scratch_capacity ? iterator->scratch_capacity : 1024;
+            while (capacity < slot->count) capacity *= 2;
+            LocationPoint* scratch = realloc(iterator->scratch, capacity * sizeof(LocationPoint));
+            if (!scratch) return false;
+            iterator->scratch = scratch;
+            iterator->scratch_capacity = capacity;
+        }
+        size_t offset = 0;
+        for (PingChunk* chunk = slot->head; chunk; chunk = chunk->next) {
+            memcpy(iterator->scratch + offset, chunk->points, chunk->count * sizeof(LocationPoint));
+            offset += chunk->count;
+        }
+        iterator->current.points = iterator->scratch;
+    }
+    iterator->current.count = slot->count;
+
+    if (slot->tag == HASHMAP_KEY_STRING) {
+        *advertiser_id = slot->key.string.str;
+    } else {
+        HashMapKey key;
+        device_key_lookup(&slot->key, slot->tag, &key);
+        hashmap_key_format(&key, iterator->key_text, sizeof(iterator->key_text));
+        *advertiser_id = iterator->key_text;
+    }
+    *locations = &iterator->current;
+    return true;
+}
+
+void location_map_iterator_destroy(LocationMapIterator* iterator) {
+    if (!iterator) return;
+    free(iterator->scratch);
+    free(iterator);
+}
@@ -0,0 +1,76 @@
+#ifndef LOCATION_MAP_H
+#define LOCATION_MAP_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <time.h>
+#include "hashmap.h"
+
+// One location ping kept for a device
+typedef struct {
+    time_t timestamp;           // Epoch seconds
+    int32_t latitude;           // Latitude (microdegrees)
+    int32_t longitude;          // Longitude (microdegrees)
+    int16_t speed;              // Speed (cm/s)
+} LocationPoint;
+
+// Contiguous view of one device's pings, as handed out by the iterator
+typedef struct {
+    LocationPoint* points;
+    size_t count;
+} LocationArray;
+
+// Append-only run of pings for one device, carved out of a pool slab
+typedef struct PingChunk {
+    struct PingChunk* next;     // Next chunk of the same device
+    uint32_t count;             // Pings used
+    uint32_t capacity;          // Pings available
+    LocationPoint points[];
+} PingChunk;
+
+// Device table: key to the device's chunk list
+#define LOCATION_MAP_FIELDS \
+    uint32_t count;             /* Total pings for this device */ \
+    PingChunk* head;            /* First chunk */ \
+    PingChunk* tail;            /* Chunk currently appended to */
+
+#define TYPED_MAP_NAME DeviceTable
+#define TYPED_MAP_SLOT DeviceSlot
+#define TYPED_MAP_PREFIX device_table
+#define TYPED_MAP_KEY HashMapKey
+#define TYPED_MAP_STORED DeviceKey
+#define TYPED_MAP_KEY_OPS device_key
+#define TYPED_MAP_KEY_STORE Arena
+#define TYPED_MAP_FIELDS LOCATION_MAP_FIELDS
+#include "typed_map.h"
+
+typedef struct {
+    DeviceTable devices;        // Device slots
+    size_t ping_count;          // Number of pings across all devices
+    Arena pings;                // Pool that chunks are bump-allocated from
+} LocationMap;
+
+typedef struct {
+    LocationMap* map;
+    size_t index;               // Next slot to visit
+    LocationArray current;      // View returned to the caller
+    LocationPoint* scratch;     // Gather buffer for multi-chunk devices
+    size_t scratch_capacity;
+    char key_text[HASHMAP_UUID_LENGTH + 1];
+} LocationMapIterator;
+
+// Function prototypes
+LocationMap* location_map_create(size_t capacity);
+void location_map_destroy(LocationMap* map);
+bool location_map_append(LocationMap* map, const HashMapKey* key, const LocationPoint* point);
+bool location_map_add(LocationMap* map, const char* advertiser_id, time_t timestamp, int32_t latitude, int32_t longitude, int16_t speed);
+bool location_map_merge(LocationMap* dst, LocationMap* src);
+size_t location_map_memory_usage(const LocationMap* map);
+
+// Iteration: each device is returned once as a contiguous, writable array
+LocationMapIterator* location_map_iterator_create(LocationMap* map);
+bool location_map_iterator_next(LocationMapIterator* iterator, const char** advertiser_id, LocationArray** locations);
+void location_map_iterator_destroy(LocationMapIterator* iterator);
+
+#endif // LOCATION_MAP_H
@@ -0,0 +1,69 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "parquet_reader.h"
+
+// Columns the ping tools read when none are named
+static const char* const PING_COLUMNS[] = {
+    "advertiser_id", "local_location_at", "latitude", "longitude", "speed"
+};
+
+// Print the selected columns of a Parquet file as CSV (nulls as empty
+// fields) and a per-column summary on stderr, for checking the native
+// reader against a pandas export of the same file.
+int main(int argc, char* argv[]) {
+    if (argc < 2) {
+        fprintf(stderr, "Usage: %s <file.parquet> [column...]\n", argv[0]);
+        return 1;
+    }
+    const char* const* names = argc > 2 ? (const char* const*)&argv[2] : PING_COLUMNS;
+    size_t count = argc > 2 ? (size_t)(argc - 2) : sizeof(PING_COLUMNS) / sizeof(PING_COLUMNS[0]);
+
+    ParquetReader reader;
+    if (!parquet_open(&reader, argv[1], names, count)) {
+        fprintf(stderr, "Error: %s\n", reader.error);
+        parquet_close(&reader);
+        return 1;
+    }
+
+    size_t* nulls = calloc(count, sizeof(size_t));
+    for (size_t c = 0; c < count; c++) printf("%s%s", c ? "," : "", names[c]);
+    printf("\n");
+
+    size_t rows = 0;
+    for (size_t g = 0; g < reader.row_group_count; g++) {
+        if (!parquet_read_row_group(&reader, g)) {
+            fprintf(stderr, "Error: %s\n", reader.error);
+            free(nulls);
+            parquet_close(&reader);
+            return 1;
+        }
+        for (size_t i = 0; i < reader.group_rows; i++) {
+            for (size_t c = 0; c < count; c++) {
+                const ParquetColumn* column = &reader.columns[c];
+                if (c) putchar(',');
+                if (!column->present[i]) {
+                    nulls[c]++;
+                } else if (column->strings) {
+                    printf("%.*s", (int)column->strings[i].len, column->strings[i].ptr);
+                } else if (column->doubles) {
+                    printf("%.17g", column->doubles[i]);
+                } else {
+                    printf("%lld", (long long)column->ints[i]);
+                }
+            }
+            putchar('\n');
+        }
+        rows += reader.group_rows;
+    }
+
+    fprintf(stderr, "%s: %zu rows in %zu row groups (footer says %lld)\n",
+            argv[1], rows, reader.row_group_count, (long long)reader.rows);
+    for (size_t c = 0; c < count; c++) {
+        fprintf(stderr, "  %-20s type %d%s, %zu nulls\n", names[c], reader.columns[c].type,
+                reader.columns[c].optional ? " optional" : "", nulls[c]);
+    }
+    free(nulls);
+    parquet_close(&reader);
+    return 0;
+}
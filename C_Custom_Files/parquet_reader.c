@@ -0,0 +1,884 @@
+#include "parquet_reader.h"
+#include "snappy.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define PARQUET_MAGIC "PAR1"
+#define PARQUET_MAGIC_LENGTH 4
+#define PARQUET_FOOTER_LENGTH 8     // Metadata length + magic
+#define THRIFT_MAX_DEPTH 32
+
+// Thrift compact protocol types
+#define THRIFT_STOP 0
+#define THRIFT_TRUE 1
+#define THRIFT_FALSE 2
+#define THRIFT_BYTE 3
+#define THRIFT_I16 4
+#define THRIFT_I32 5
+#define THRIFT_I64 6
+#define THRIFT_DOUBLE 7
+#define THRIFT_BINARY 8
+#define THRIFT_LIST 9
+#define THRIFT_SET 10
+#define THRIFT_MAP 11
+#define THRIFT_STRUCT 12
+
+// parquet.thrift enums used here
+#define PAGE_DATA 0
+#define PAGE_DICTIONARY 2
+#define PAGE_DATA_V2 3
+#define ENCODING_PLAIN 0
+#define ENCODING_PLAIN_DICTIONARY 2
+#define ENCODING_RLE 3
+#define ENCODING_RLE_DICTIONARY 8
+#define CODEC_UNCOMPRESSED 0
+#define CODEC_SNAPPY 1
+#define REPETITION_REQUIRED 0
+#define REPETITION_OPTIONAL 1
+
+// Cursor over Thrift compact-protocol bytes; any malformed input sets failed
+typedef struct {
+    const uint8_t* p;
+    const uint8_t* end;
+    bool failed;
+} Thrift;
+
+// The parts of a PageHeader the decoder needs
+typedef struct {
+    int type;
+    int64_t uncompressed_size;
+    int64_t compressed_size;
+    int64_t num_values;
+    int encoding;
+    int definition_encoding;    // Data page v1
+    int64_t definition_length;  // Data page v2: level bytes ahead of the values
+    int64_t repetition_length;
+    bool values_compressed;     // Data page v2
+} PageHeader;
+
+// Decoded dictionary page of one column chunk
+typedef struct {
+    size_t count;
+    ParquetString* strings;
+    double* doubles;
+    int64_t* ints;
+} Dictionary;
+
+static bool fail(ParquetReader* reader, const char* format, ...) {
+    va_list args;
+    va_start(args, format);
+    vsnprintf(reader->error, sizeof(reader->error), format, args);
+    va_end(args);
+    return false;
+}
+
+static uint64_t thrift_varint(Thrift* t) {
+    uint64_t result = 0;
+    for (int shift = 0; shift < 64 && t->p < t->end; shift += 7) {
+        uint8_t byte = *t->p++;
+        result |= (uint64_t)(byte & 0x7F) << shift;
+        if (byte < 0x80) return result;
+    }
+    t->failed = true;
+    return 0;
+}
+
+static int64_t thrift_zigzag(Thrift* t) {
+    uint64_t value = thrift_varint(t);
+    return (int64_t)(value >> 1) ^ -(int64_t)(value & 1);
+}
+
+// Read the next field header of a struct. Returns false at the closing STOP
+// byte (or on malformed input); id carries the previous field id in and out.
+static bool thrift_field(Thrift* t, int16_t* id, uint8_t* type) {
+    if (t->p >= t->end) {
+        t->failed = true;
+        return false;
+    }
+    uint8_t header = *t->p++;
+    if (header == THRIFT_STOP) return false;
+    *type = header & 0x0F;
+    uint8_t delta = header >> 4;
+    *id = delta ? (int16_t)(*id + delta) : (int16_t)thrift_zigzag(t);
+    return !t->failed;
+}
+
+static bool thrift_list(Thrift* t, uint8_t* type, size_t* size) {
+    if (t->p >= t->end) {
+        t->failed = true;
+        return false;
+    }
+    uint8_t header = *t->p++;
+    *type = header & 0x0F;
+    *size = header >> 4;
+    if (*size == 15) *size = (size_t)thrift_varint(t);
+    // Every element takes at least one byte
+    if (*size > (size_t)(t->end - t->p)) t->failed = true;
+    return !t->failed;
+}
+
+static bool thrift_binary(Thrift* t, const uint8_t** ptr, size_t* length) {
+    uint64_t n = thrift_varint(t);
+    if (t->failed || n > (uint64_t)(t->end - t->p)) {
+        t->failed = true;
+        return false;
+    }
+    *ptr = t->p;
+    *length = (size_t)n;
+    t->p += n;
+    return true;
+}
+
+// Skip one value. Booleans are carried in a field's type nibble but take a
+// byte when they are list, set or map elements.
+static void thrift_skip(Thrift* t, uint8_t type, bool element, int depth) {
+    if (depth > THRIFT_MAX_DEPTH) {
+        t->failed = true;
+        return;
+    }
+    switch (type) {
+        case THRIFT_TRUE:
+        case THRIFT_FALSE:
+            if (element) t->p++;
+            break;
+        case THRIFT_BYTE:
+            t->p++;
+            break;
+        case THRIFT_I16:
+        case THRIFT_I32:
+        case THRIFT_I64:
+            thrift_varint(t);
+            break;
+        case THRIFT_DOUBLE:
+            t->p += 8;
+            break;
+        case THRIFT_BINARY: {
+            const uint8_t* ptr;
+            size_t length;
+            thrift_binary(t, &ptr, &length);
+            break;
+        }
+        case THRIFT_LIST:
+        case THRIFT_SET: {
+            uint8_t element_type;
+            size_t size;
+            if (!thrift_list(t, &element_type, &size)) return;
+            for (size_t i = 0; i < size && !t->failed; i++) thrift_skip(t, element_type, true, depth + 1);
+            break;
+        }
+        case THRIFT_MAP: {
+            size_t size = (size_t)thrift_varint(t);
+            if (size == 0 || t->failed) break;
+            if (t->p >= t->end) {
+                t->failed = true;
+                return;
+            }
+            uint8_t types = *t->p++;
+            for (size_t i = 0; i < size && !t->failed; i++) {
+                thrift_skip(t, types >> 4, true, depth + 1);
+                thrift_skip(t, types & 0x0F, true, depth + 1);
+            }
+            break;
+        }
+        case THRIFT_STRUCT: {
+            int16_t id = 0;
+            uint8_t field_type;
+            while (thrift_field(t, &id, &field_type)) thrift_skip(t, field_type, false, depth + 1);
+            break;
+        }
+        default:
+            t->failed = true;
+            break;
+    }
+    if (t->p > t->end) t->failed = true;
+}
+
+// Integer field of the expected type, or skip a mismatched one
+static int64_t thrift_int(Thrift* t, uint8_t type) {
+    if (type == THRIFT_I16 || type == THRIFT_I32 || type == THRIFT_I64) return thrift_zigzag(t);
+    thrift_skip(t, type, false, 0);
+    return 0;
+}
+
+// Metadata of one selected column chunk, with its file layout
+typedef struct {
+    int type;
+    int codec;
+    int64_t values;
+    int64_t compressed_size;
+    int64_t data_page_offset;
+    int64_t dictionary_page_offset;
+    bool external;              // Chunk stored in another file
+} ChunkMeta;
+
+static void parse_column_meta(Thrift* t, ChunkMeta* meta) {
+    int16_t id = 0;
+    uint8_t type;
+    while (thrift_field(t, &id, &type)) {
+        switch (id) {
+            case 1: meta->type = (int)thrift_int(t, type); break;
+            case 4: meta->codec = (int)thrift_int(t, type); break;
+            case 5: meta->values = thrift_int(t, type); break;
+            case 7: meta->compressed_size = thrift_int(t, type); break;
+            case 9: meta->data_page_offset = thrift_int(t, type); break;
+            case 11: meta->dictionary_page_offset = thrift_int(t, type); break;
+            default: thrift_skip(t, type, false, 0); break;
+        }
+    }
+}
+
+static void parse_column_chunk(Thrift* t, ChunkMeta* meta) {
+    int16_t id = 0;
+    uint8_t type;
+    while (thrift_field(t, &id, &type)) {
+        if (id == 1 && type == THRIFT_BINARY) {
+            meta->external = true;
+            thrift_skip(t, type, false, 0);
+        } else if (id == 3 && type == THRIFT_STRUCT) {
+            parse_column_meta(t, meta);
+        } else {
+            thrift_skip(t, type, false, 0);
+        }
+    }
+}
+
+// Fill in one row group, keeping only the chunks of selected leaves.
+// leaf_to_column maps a leaf position to a selected column or SIZE_MAX.
+static bool parse_row_group(ParquetReader* reader, Thrift* t, ParquetRowGroup* group,
+                            const size_t* leaf_to_column, size_t leaf_count) {
+    group->chunks = calloc(reader->column_count, sizeof(ParquetChunk));
+    if (!group->chunks) return fail(reader, "out of memory");
+    group->offset = UINT64_MAX;
+
+    int16_t id = 0;
+    uint8_t type;
+    while (thrift_field(t, &id, &type)) {
+        if (id == 3) {
+            group->rows = thrift_int(t, type);
+        } else if (id == 1 && type == THRIFT_LIST) {
+            uint8_t element_type;
+            size_t size = 0;
+            if (!thrift_list(t, &element_type, &size) || element_type != THRIFT_STRUCT || size != leaf_count) {
+                return fail(reader, "row group has %zu column chunks for %zu columns", size, leaf_count);
+            }
+            for (size_t leaf = 0; leaf < size && !t->failed; leaf++) {
+                ChunkMeta meta = { .dictionary_page_offset = -1 };
+                parse_column_chunk(t, &meta);
+                if (leaf_to_column[leaf] == SIZE_MAX) continue;
+
+                ParquetColumn* column = &reader->columns[leaf_to_column[leaf]];
+                if (meta.external) return fail(reader, "column %s is stored in another file", column->name);
+                if (meta.type != column->type) return fail(reader, "column %s: chunk type differs from schema", column->name);
+                if (meta.codec != CODEC_UNCOMPRESSED && meta.codec != CODEC_SNAPPY) {
+                    return fail(reader, "column %s: unsupported codec %d", column->name, meta.codec);
+                }
+                // A dictionary page, when present, comes first
+                int64_t start = meta.data_page_offset;
+                if (meta.dictionary_page_offset > 0 && meta.dictionary_page_offset < start) {
+                    start = meta.dictionary_page_offset;
+                }
+                if (start < PARQUET_MAGIC_LENGTH || meta.compressed_size < 0 ||
+                    (uint64_t)start + (uint64_t)meta.compressed_size > reader->size) {
+                    return fail(reader, "column %s: chunk outside the file", column->name);
+                }
+                ParquetChunk* chunk = &group->chunks[leaf_to_column[leaf]];
+                chunk->start = (uint64_t)start;
+                chunk->length = (uint64_t)meta.compressed_size;
+                chunk->values = meta.values;
+                chunk->codec = meta.codec;
+                if (chunk->start < group->offset) group->offset = chunk->start;
+            }
+        } else {
+            thrift_skip(t, type, false, 0);
+        }
+    }
+    if (t->failed) return fail(reader, "corrupt row group metadata");
+    if (group->rows < 0) return fail(reader, "corrupt row group row count");
+    if (group->offset == UINT64_MAX) group->offset = 0;  // No columns selected
+    return true;
+}
+
+// Read the schema and match the requested names to leaf columns
+static bool parse_schema(ParquetReader* reader, Thrift* t, size_t** leaf_to_column, size_t* leaf_count) {
+    uint8_t element_type;
+    size_t size;
+    if (!thrift_list(t, &element_type, &size) || element_type != THRIFT_STRUCT || size == 0) {
+        return fail(reader, "corrupt schema");
+    }
+    *leaf_to_column = malloc(size * sizeof(size_t));
+    if (!*leaf_to_column) return fail(reader, "out of memory");
+    *leaf_count = 0;
+
+    for (size_t i = 0; i < size; i++) {
+        int type = -1, repetition = REPETITION_REQUIRED;
+        int64_t children = 0;
+        const uint8_t* name = NULL;
+        size_t name_length = 0;
+
+        int16_t id = 0;
+        uint8_t field_type;
+        while (thrift_field(t, &id, &field_type)) {
+            switch (id) {
+                case 1: type = (int)thrift_int(t, field_type); break;
+                case 3: repetition = (int)thrift_int(t, field_type); break;
+                case 4:
+                    if (field_type == THRIFT_BINARY) thrift_binary(t, &name, &name_length);
+                    else thrift_skip(t, field_type, false, 0);
+                    break;
+                case 5: children = thrift_int(t, field_type); break;
+                default: thrift_skip(t, field_type, false, 0); break;
+            }
+        }
+        if (t->failed) return fail(reader, "corrupt schema element");
+        if (i == 0) continue;  // Root
+        if (children > 0 || repetition > REPETITION_OPTIONAL) {
+            return fail(reader, "nested or repeated columns are not supported");
+        }
+
+        size_t leaf = (*leaf_count)++;
+        (*leaf_to_column)[leaf] = SIZE_MAX;
+        for (size_t c = 0; c < reader->column_count; c++) {
+            ParquetColumn* column = &reader->columns[c];
+            if (strlen(column->name) == name_length && memcmp(column->name, name, name_length) == 0) {
+                column->type = type;
+                column->optional = repetition == REPETITION_OPTIONAL;
+                column->leaf = leaf;
+                (*leaf_to_column)[leaf] = c;
+            }
+        }
+    }
+
+    for (size_t c = 0; c < reader->column_count; c++) {
+        ParquetColumn* column = &reader->columns[c];
+        if (column->type < 0) return fail(reader, "column %s not found", column->name);
+        if (column->type != PARQUET_BYTE_ARRAY && column->type != PARQUET_DOUBLE && column->type != PARQUET_FLOAT &&
+            column->type != PARQUET_INT32 && column->type != PARQUET_INT64) {
+            return fail(reader, "column %s: unsupported type %d", column->name, column->type);
+        }
+    }
+    return true;
+}
+
+static bool parse_file_metadata(ParquetReader* reader, const uint8_t* p, size_t length) {
+    Thrift t = { p, p + length, false };
+    size_t* leaf_to_column = NULL;
+    size_t leaf_count = 0;
+    bool ok = true;
+
+    int16_t id = 0;
+    uint8_t type;
+    while (ok && thrift_field(&t, &id, &type)) {
+        if (id == 2 && type == THRIFT_LIST) {
+            ok = parse_schema(reader, &t, &leaf_to_column, &leaf_count);
+        } else if (id == 3) {
+            reader->rows = thrift_int(&t, type);
+        } else if (id == 4 && type == THRIFT_LIST) {
+            uint8_t element_type;
+            size_t size;
+            if (!leaf_to_column) {
+                ok = fail(reader, "row groups precede the schema");
+            } else if (!thrift_list(&t, &element_type, &size) || element_type != THRIFT_STRUCT) {
+                ok = fail(reader, "corrupt row group list");
+            } else {
+                reader->row_groups = calloc(size ? size : 1, sizeof(ParquetRowGroup));
+                if (!reader->row_groups) ok = fail(reader, "out of memory");
+                for (size_t i = 0; ok && i < size; i++) {
+                    reader->row_group_count++;
+                    ok = parse_row_group(reader, &t, &reader->row_groups[i], leaf_to_column, leaf_count);
+                }
+            }
+        } else {
+            thrift_skip(&t, type, false, 0);
+        }
+    }
+    if (ok && t.failed) ok = fail(reader, "corrupt file metadata");
+    if (ok && !leaf_to_column) ok = fail(reader, "file metadata has no schema");
+    free(leaf_to_column);
+    return ok;
+}
+
+// Whether a path names Parquet data (e.g. "part-00000-...-c000.snappy.parquet");
+// the tools route these to this reader and everything else to the CSV one
+bool parquet_is_file_name(const char* path) {
+    return strstr(path, ".parquet") != NULL;
+}
+
+// Map the file and read its footer. Only the named columns will be decoded.
+// On failure reader->error says why; parquet_close is still safe to call.
+bool parquet_open(ParquetReader* reader, const char* path, const char* const* names, size_t count) {
+    memset(reader, 0, sizeof(*reader));
+    reader->fd = open(path, O_RDONLY);
+    if (reader->fd < 0) return fail(reader, "cannot open %s", path);
+
+    struct stat st;
+    if (fstat(reader->fd, &st) != 0) return fail(reader, "cannot stat %s", path);
+    reader->size = (size_t)st.st_size;
+    if (reader->size < PARQUET_MAGIC_LENGTH + PARQUET_FOOTER_LENGTH) return fail(reader, "%s is too small", path);
+
+    void* data = mmap(NULL, reader->size, PROT_READ, MAP_PRIVATE, reader->fd, 0);
+    if (data == MAP_FAILED) return fail(reader, "cannot map %s", path);
+    reader->data = data;
+
+    const uint8_t* footer = reader->data + reader->size - PARQUET_FOOTER_LENGTH;
+    if (memcmp(reader->data, PARQUET_MAGIC, PARQUET_MAGIC_LENGTH) != 0 ||
+        memcmp(footer + 4, PARQUET_MAGIC, PARQUET_MAGIC_LENGTH) != 0) {
+        return fail(reader, "%s is not a Parquet file", path);
+    }
+    size_t metadata_length = (size_t)footer[0] | (size_t)footer[1] << 8 | (size_t)footer[2] << 16 | (size_t)footer[3] << 24;
+    if (metadata_length > reader->size - PARQUET_MAGIC_LENGTH - PARQUET_FOOTER_LENGTH) {
+        return fail(reader, "%s: corrupt footer", path);
+    }
+
+    reader->columns = calloc(count ? count : 1, sizeof(ParquetColumn));
+    if (!reader->columns) return fail(reader, "out of memory");
+    reader->column_count = count;
+    for (size_t i = 0; i < count; i++) {
+        reader->columns[i].name = strdup(names[i]);
+        reader->columns[i].type = -1;
+        if (!reader->columns[i].name) return fail(reader, "out of memory");
+    }
+
+    return parse_file_metadata(reader, footer - metadata_length, metadata_length);
+}
+
+static bool parse_page_header(Thrift* t, PageHeader* header) {
+    memset(header, 0, sizeof(*header));
+    header->type = -1;
+    header->values_compressed = true;
+
+    int16_t id = 0;
+    uint8_t type;
+    while (thrift_field(t, &id, &type)) {
+        int16_t sub_id = 0;
+        uint8_t sub_type;
+        switch (id) {
+            case 1: header->type = (int)thrift_int(t, type); break;
+            case 2: header->uncompressed_size = thrift_int(t, type); break;
+            case 3: header->compressed_size = thrift_int(t, type); break;
+            case 5:  // DataPageHeader
+                while (type == THRIFT_STRUCT && thrift_field(t, &sub_id, &sub_type)) {
+                    if (sub_id == 1) header->num_values = thrift_int(t, sub_type);
+                    else if (sub_id == 2) header->encoding = (int)thrift_int(t, sub_type);
+                    else if (sub_id == 3) header->definition_encoding = (int)thrift_int(t, sub_type);
+                    else thrift_skip(t, sub_type, false, 0);
+                }
+                if (type != THRIFT_STRUCT) thrift_skip(t, type, false, 0);
+                break;
+            case 7:  // DictionaryPageHeader
+                while (type == THRIFT_STRUCT && thrift_field(t, &sub_id, &sub_type)) {
+                    if (sub_id == 1) header->num_values = thrift_int(t, sub_type);
+                    else if (sub_id == 2) header->encoding = (int)thrift_int(t, sub_type);
+                    else thrift_skip(t, sub_type, false, 0);
+                }
+                if (type != THRIFT_STRUCT) thrift_skip(t, type, false, 0);
+                break;
+            case 8:  // DataPageHeaderV2
+                while (type == THRIFT_STRUCT && thrift_field(t, &sub_id, &sub_type)) {
+                    if (sub_id == 1) header->num_values = thrift_int(t, sub_type);
+                    else if (sub_id == 4) header->encoding = (int)thrift_int(t, sub_type);
+                    else if (sub_id == 5) header->definition_length = thrift_int(t, sub_type);
+                    else if (sub_id == 6) header->repetition_length = thrift_int(t, sub_type);
+                    else if (sub_id == 7) header->values_compressed = sub_type == THRIFT_TRUE;
+                    else thrift_skip(t, sub_type, false, 0);
+                }
+                if (type != THRIFT_STRUCT) thrift_skip(t, type, false, 0);
+                break;
+            default:
+                thrift_skip(t, type, false, 0);
+                break;
+        }
+    }
+    return !t->failed && header->uncompressed_size >= 0 && header->compressed_size >= 0 && header->num_values >= 0;
+}
+
+// Decompressed copy of a page kept alive until the next row group, since
+// decoded strings point into it
+static uint8_t* keep_buffer(ParquetReader* reader, size_t size) {
+    if (reader->buffer_count == reader->buffer_capacity) {
+        size_t capacity = reader->buffer_capacity ? reader->buffer_capacity * 2 : 16;
+        uint8_t** buffers = realloc(reader->buffers, capacity * sizeof(uint8_t*));
+        if (!buffers) return NULL;
+        reader->buffers = buffers;
+        reader->buffer_capacity = capacity;
+    }
+    uint8_t* buffer = malloc(size ? size : 1);
+    if (buffer) reader->buffers[reader->buffer_count++] = buffer;
+    return buffer;
+}
+
+static void release_buffers(ParquetReader* reader) {
+    for (size_t i = 0; i < reader->buffer_count; i++) free(reader->buffers[i]);
+    reader->buffer_count = 0;
+}
+
+// Page (or v2 values section) bytes after the chunk's codec
+static bool page_bytes(ParquetReader* reader, int codec, const uint8_t* body, size_t compressed,
+                       size_t uncompressed, const uint8_t** out) {
+    if (codec == CODEC_UNCOMPRESSED) {
+        if (compressed != uncompressed) return fail(reader, "uncompressed page sizes disagree");
+        *out = body;
+        return true;
+    }
+    uint8_t* buffer = keep_buffer(reader, uncompressed);
+    if (!buffer) return fail(reader, "out of memory");
+    if (!snappy_decompress(body, compressed, buffer, uncompressed)) return fail(reader, "corrupt Snappy page");
+    *out = buffer;
+    return true;
+}
+
+static uint32_t* scratch(ParquetReader* reader, size_t count) {
+    if (count > reader->scratch_capacity) {
+        uint32_t* grown = realloc(reader->scratch, count * sizeof(uint32_t));
+        if (!grown) return NULL;
+        reader->scratch = grown;
+        reader->scratch_capacity = count;
+    }
+    return reader->scratch;
+}
+
+static inline uint32_t unpack_value(const uint8_t* p, size_t index, int bit_width) {
+    size_t bit = index * (size_t)bit_width;
+    const uint8_t* q = p + (bit >> 3);
+    int shift = (int)(bit & 7);
+    int bytes = (shift + bit_width + 7) >> 3;
+    uint64_t bits = 0;
+    for (int i = 0; i < bytes; i++) bits |= (uint64_t)q[i] << (8 * i);
+    uint64_t mask = bit_width == 32 ? 0xFFFFFFFFULL : ((1ULL << bit_width) - 1);
+    return (uint32_t)((bits >> shift) & mask);
+}
+
+// RLE / bit-packed hybrid runs (levels and dictionary indices) into out
+static bool rle_decode(const uint8_t* p, const uint8_t* end, int bit_width, uint32_t* out, size_t count) {
+    if (bit_width < 0 || bit_width > 32) return false;
+    size_t value_bytes = ((size_t)bit_width + 7) / 8;
+    size_t n = 0;
+    while (n < count) {
+        Thrift t = { p, end, false };
+        uint64_t header = thrift_varint(&t);
+        if (t.failed) return false;
+        p = t.p;
+        if (header & 1) {
+            // Groups of 8 values, bit_width bytes per group, LSB first
+            uint64_t groups = header >> 1;
+            if (groups > (uint64_t)(end - p) || groups * (uint64_t)bit_width > (uint64_t)(end - p)) return false;
+            size_t values = (size_t)groups * 8;
+            for (size_t i = 0; i < values && n < count; i++) out[n++] = unpack_value(p, i, bit_width);
+            p += groups * (size_t)bit_width;
+        } else {
+            uint64_t run = header >> 1;
+            if (value_bytes > (size_t)(end - p)) return false;
+            uint32_t value = 0;
+            for (size_t i = 0; i < value_bytes; i++) value |= (uint32_t)p[i] << (8 * i);
+            p += value_bytes;
+            if (run > count - n) run = count - n;
+            for (uint64_t i = 0; i < run; i++) out[n++] = value;
+        }
+    }
+    return true;
+}
+
+// One PLAIN value of the column's type
+static bool read_plain(int type, const uint8_t** p, const uint8_t* end, ParquetString* string, double* real, int64_t* integer) {
+    size_t available = (size_t)(end - *p);
+    switch (type) {
+        case PARQUET_BYTE_ARRAY: {
+            if (available < 4) return false;
+            uint32_t length;
+            memcpy(&length, *p, 4);
+            if (length > available - 4) return false;
+            string->ptr = (const char*)*p + 4;
+            string->len = length;
+            *p += 4 + (size_t)length;
+            return true;
+        }
+        case PARQUET_DOUBLE:
+            if (available < 8) return false;
+            memcpy(real, *p, 8);
+            *p += 8;
+            return true;
+        case PARQUET_FLOAT: {
+            if (available < 4) return false;
+            float value;
+            memcpy(&value, *p, 4);
+            *real = value;
+            *p += 4;
+            return true;
+        }
+        case PARQUET_INT64:
+            if (available < 8) return false;
+            memcpy(integer, *p, 8);
+            *p += 8;
+            return true;
+        case PARQUET_INT32: {
+            if (available < 4) return false;
+            int32_t value;
+            memcpy(&value, *p, 4);
+            *integer = value;
+            *p += 4;
+            return true;
+        }
+        default:
+            return false;
+    }
+}
+
+// Smallest PLAIN encoding of one value: a BYTE_ARRAY is at least its length prefix
+static size_t plain_min_width(int type) {
+    return type == PARQUET_INT64 || type == PARQUET_DOUBLE ? 8 : 4;
+}
+
+// Allocate count values of size bytes, NULL if the size would overflow
+static void* alloc_array(size_t count, size_t size) {
+    size_t bytes;
+    if (__builtin_mul_overflow(count ? count : 1, size, &bytes)) return NULL;
+    return malloc(bytes);
+}
+
+static bool decode_dictionary(ParquetReader* reader, ParquetColumn* column, Dictionary* dictionary,
+                              const uint8_t* p, const uint8_t* end, size_t count) {
+    if (dictionary->count) return fail(reader, "column %s: second dictionary page", column->name);
+    // num_values comes from the file: every entry needs bytes in the page
+    if (count > (size_t)(end - p) / plain_min_width(column->type)) {
+        return fail(reader, "column %s: dictionary of %zu values in %zu bytes", column->name, count, (size_t)(end - p));
+    }
+    dictionary->strings = column->type == PARQUET_BYTE_ARRAY ? alloc_array(count, sizeof(ParquetString)) : NULL;
+    dictionary->doubles = column->type == PARQUET_DOUBLE || column->type == PARQUET_FLOAT ? alloc_array(count, sizeof(double)) : NULL;
+    dictionary->ints = column->type == PARQUET_INT64 || column->type == PARQUET_INT32 ? alloc_array(count, sizeof(int64_t)) : NULL;
+    if (!dictionary->strings && !dictionary->doubles && !dictionary->ints) return fail(reader, "out of memory");
+
+    for (size_t i = 0; i < count; i++) {
+        ParquetString string;
+        double real;
+        int64_t integer;
+        if (!read_plain(column->type, &p, end, &string, &real, &integer)) {
+            return fail(reader, "column %s: truncated dictionary", column->name);
+        }
+        if (dictionary->strings) dictionary->strings[i] = string;
+        else if (dictionary->doubles) dictionary->doubles[i] = real;
+        else dictionary->ints[i] = integer;
+    }
+    dictionary->count = count;
+    return true;
+}
+
+// Values of one data page for rows [row, row + count). levels is NULL for
+// a required column, otherwise 1 marks a present value.
+static bool decode_values(ParquetReader* reader, ParquetColumn* column, const Dictionary* dictionary, int encoding,
+                          const uint8_t* p, const uint8_t* end, const uint32_t* levels, uint32_t* indices,
+                          size_t count, size_t row) {
+    size_t present = count;
+    if (levels) {
+        present = 0;
+        for (size_t i = 0; i < count; i++) present += levels[i] != 0;
+    }
+
+    bool dictionary_encoded = encoding == ENCODING_PLAIN_DICTIONARY || encoding == ENCODING_RLE_DICTIONARY;
+    if (dictionary_encoded) {
+        if (present > 0) {
+            if (p >= end) return fail(reader, "column %s: truncated page", column->name);
+            int bit_width = *p++;
+            if (!rle_decode(p, end, bit_width, indices, present)) {
+                return fail(reader, "column %s: corrupt dictionary indices", column->name);
+            }
+        }
+    } else if (encoding != ENCODING_PLAIN) {
+        return fail(reader, "column %s: unsupported encoding %d", column->name, encoding);
+    }
+
+    size_t next = 0;
+    for (size_t i = 0; i < count; i++) {
+        size_t at = row + i;
+        bool is_present = !levels || levels[i] != 0;
+        column->present[at] = is_present;
+        ParquetString string = { NULL, 0 };
+        double real = 0;
+        int64_t integer = 0;
+        if (is_present) {
+            if (dictionary_encoded) {
+                uint32_t index = indices[next++];
+                if (index >= dictionary->count) return fail(reader, "column %s: dictionary index out of range", column->name);
+                if (dictionary->strings) string = dictionary->strings[index];
+                else if (dictionary->doubles) real = dictionary->doubles[index];
+                else integer = dictionary->ints[index];
+            } else if (!read_plain(column->type, &p, end, &string, &real, &integer)) {
+                return fail(reader, "column %s: truncated page", column->name);
+            }
+        }
+        if (column->strings) column->strings[at] = string;
+        else if (column->doubles) column->doubles[at] = real;
+        else column->ints[at] = integer;
+    }
+    return true;
+}
+
+// Decode every page of one column chunk into rows [0, rows)
+static bool decode_chunk(ParquetReader* reader, ParquetColumn* column, const ParquetChunk* chunk, size_t rows) {
+    const uint8_t* p = reader->data + chunk->start;
+    const uint8_t* end = p + chunk->length;
+    Dictionary dictionary = {0};
+    size_t row = 0;
+    bool ok = true;
+
+    while (ok && row < rows && p < end) {
+        Thrift t = { p, end, false };
+        PageHeader header;
+        if (!parse_page_header(&t, &header)) {
+            ok = fail(reader, "column %s: corrupt page header", column->name);
+            break;
+        }
+        const uint8_t* body = t.p;
+        if (header.compressed_size > end - body) {
+            ok = fail(reader, "column %s: page runs past its chunk", column->name);
+            break;
+        }
+        p = body + header.compressed_size;
+        size_t compressed = (size_t)header.compressed_size;
+        size_t uncompressed = (size_t)header.uncompressed_size;
+        size_t count = (size_t)header.num_values;
+
+        if (header.type == PAGE_DICTIONARY) {
+            const uint8_t* data;
+            ok = page_bytes(reader, chunk->codec, body, compressed, uncompressed, &data) &&
+                 decode_dictionary(reader, column, &dictionary, data, data + uncompressed, count);
+            continue;
+        }
+        if (header.type != PAGE_DATA && header.type != PAGE_DATA_V2) continue;  // Index pages
+
+        if (count > rows - row) {
+            ok = fail(reader, "column %s: pages hold more values than the row group", column->name);
+            break;
+        }
+        uint32_t* levels = column->optional ? scratch(reader, count * 2) : NULL;
+        uint32_t* indices = levels ? levels + count : scratch(reader, count);
+        if (count && !indices) {
+            ok = fail(reader, "out of memory");
+            break;
+        }
+
+        const uint8_t* values;
+        const uint8_t* values_end;
+        if (header.type == PAGE_DATA) {
+            const uint8_t* data;
+            if (!page_bytes(reader, chunk->codec, body, compressed, uncompressed, &data)) {
+                ok = false;
+                break;
+            }
+            values = data;
+            values_end = data + uncompressed;
+            if (levels) {
+                // Definition levels: 4-byte length, then RLE runs of width 1
+                uint32_t length;
+                if (header.definition_encoding != ENCODING_RLE || values_end - values < 4) {
+                    ok = fail(reader, "column %s: unsupported definition levels", column->name);
+                    break;
+                }
+                memcpy(&length, values, 4);
+                if (length > (size_t)(values_end - values - 4) ||
+                    !rle_decode(values + 4, values + 4 + length, 1, levels, count)) {
+                    ok = fail(reader, "column %s: corrupt definition levels", column->name);
+                    break;
+                }
+                values += 4 + (size_t)length;
+            }
+        } else {
+            // v2: levels are never compressed and carry no length prefix
+            size_t level_bytes = (size_t)header.repetition_length + (size_t)header.definition_length;
+            if (header.repetition_length < 0 || header.definition_length < 0 ||
+                level_bytes > compressed || level_bytes > uncompressed) {
+                ok = fail(reader, "column %s: corrupt v2 page", column->name);
+                break;
+            }
+            if (levels && !rle_decode(body + header.repetition_length, body + level_bytes, 1, levels, count)) {
+                ok = fail(reader, "column %s: corrupt definition levels", column->name);
+                break;
+            }
+            int codec = header.values_compressed ? chunk->codec : CODEC_UNCOMPRESSED;
+            if (!page_bytes(reader, codec, body + level_bytes, compressed - level_bytes,
+                            uncompressed - level_bytes, &values)) {
+                ok = false;
+                break;
+            }
+            values_end = values + (uncompressed - level_bytes);
+        }
+
+        ok = decode_values(reader, column, &dictionary, header.encoding, values, values_end, levels, indices, count, row);
+        row += count;
+    }
+
+    if (ok && row != rows) ok = fail(reader, "column %s: %zu of %zu rows in the chunk", column->name, row, rows);
+    free(dictionary.strings);
+    free(dictionary.doubles);
+    free(dictionary.ints);
+    return ok;
+}
+
+// Make room for rows values in every selected column
+static bool reserve_rows(ParquetReader* reader, size_t rows) {
+    for (size_t c = 0; c < reader->column_count; c++) {
+        ParquetColumn* column = &reader->columns[c];
+        if (rows <= column->capacity) continue;
+
+        uint8_t* present = realloc(column->present, rows);
+        if (!present) return fail(reader, "out of memory");
+        column->present = present;
+        if (column->type == PARQUET_BYTE_ARRAY) {
+            ParquetString* strings = realloc(column->strings, rows * sizeof(ParquetString));
+            if (!strings) return fail(reader, "out of memory");
+            column->strings = strings;
+        } else if (column->type == PARQUET_DOUBLE || column->type == PARQUET_FLOAT) {
+            double* doubles = realloc(column->doubles, rows * sizeof(double));
+            if (!doubles) return fail(reader, "out of memory");
+            column->doubles = doubles;
+        } else {
+            int64_t* ints = realloc(column->ints, rows * sizeof(int64_t));
+            if (!ints) return fail(reader, "out of memory");
+            column->ints = ints;
+        }
+        column->capacity = rows;
+    }
+    return true;
+}
+
+// Decode the selected columns of one row group. Values (and the strings
+// they point at) stay valid until the next call or parquet_close.
+bool parquet_read_row_group(ParquetReader* reader, size_t index) {
+    reader->group_rows = 0;
+    release_buffers(reader);
+    if (index >= reader->row_group_count) return fail(reader, "row group %zu out of range", index);
+
+    const ParquetRowGroup* group = &reader->row_groups[index];
+    size_t rows = (size_t)group->rows;
+    if (!reserve_rows(reader, rows)) return false;
+    for (size_t c = 0; c < reader->column_count; c++) {
+        if (!decode_chunk(reader, &reader->columns[c], &group->chunks[c], rows)) return false;
+    }
+    reader->group_rows = rows;
+    return true;
+}
+
+void parquet_close(ParquetReader* reader) {
+    release_buffers(reader);
+    free(reader->buffers);
+    free(reader->scratch);
+    for (size_t i = 0; i < reader->row_group_count; i++) free(reader->row_groups[i].chunks);
+    free(reader->row_groups);
+    for (size_t c = 0; c < reader->column_count; c++) {
+        ParquetColumn* column = &reader->columns[c];
+        free(column->name);
+        free(column->present);
+        free(column->strings);
+        free(column->doubles);
+        free(column->ints);
+    }
+    free(reader->columns);
+    if (reader->data) munmap((void*)reader->data, reader->size);
+    if (reader->fd >= 0) close(reader->fd);
+    memset(reader, 0, sizeof(*reader));
+    reader->fd = -1;
+}
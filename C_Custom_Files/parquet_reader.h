@@ -0,0 +1,78 @@
+#ifndef PARQUET_READER_H
+#define PARQUET_READER_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+// Physical types (parquet.thrift Type)
+#define PARQUET_BOOLEAN 0
+#define PARQUET_INT32 1
+#define PARQUET_INT64 2
+#define PARQUET_INT96 3
+#define PARQUET_FLOAT 4
+#define PARQUET_DOUBLE 5
+#define PARQUET_BYTE_ARRAY 6
+#define PARQUET_FIXED_LEN_BYTE_ARRAY 7
+
+// A BYTE_ARRAY value inside a page buffer or the mapping; not NUL-terminated
+typedef struct {
+    const char* ptr;
+    size_t len;
+} ParquetString;
+
+// Where one selected column lives inside one row group
+typedef struct {
+    uint64_t start;             // First page header (dictionary page if any)
+    uint64_t length;            // Compressed bytes of all pages
+    int64_t values;             // Values, nulls included
+    int codec;                  // 0 uncompressed, 1 Snappy
+} ParquetChunk;
+
+typedef struct {
+    int64_t rows;
+    uint64_t offset;            // Lowest chunk start: the row group "begins" here
+    ParquetChunk* chunks;       // One per selected column
+} ParquetRowGroup;
+
+// One selected column, decoded for the current row group. Only the array
+// matching the type is filled; row i is null when present[i] is 0.
+typedef struct {
+    char* name;
+    int type;                   // PARQUET_*
+    bool optional;              // Has definition levels
+    size_t leaf;                // Position among the file's columns
+    uint8_t* present;
+    ParquetString* strings;     // BYTE_ARRAY
+    double* doubles;            // FLOAT, DOUBLE
+    int64_t* ints;              // INT32, INT64
+    size_t capacity;            // Rows the arrays can hold
+} ParquetColumn;
+
+// Reader over an mmap'd Parquet file that decodes only the selected columns
+// of a flat schema, one row group at a time
+typedef struct {
+    int fd;
+    const uint8_t* data;
+    size_t size;
+    int64_t rows;               // Rows in the file
+    ParquetRowGroup* row_groups;
+    size_t row_group_count;
+    ParquetColumn* columns;     // Selected columns, in the order requested
+    size_t column_count;
+    size_t group_rows;          // Rows decoded by the last parquet_read_row_group
+    uint8_t** buffers;          // Decompressed pages backing the current strings
+    size_t buffer_count;
+    size_t buffer_capacity;
+    uint32_t* scratch;          // Level and dictionary index decoding
+    size_t scratch_capacity;
+    char error[160];            // Why the last call failed
+} ParquetReader;
+
+// Function prototypes
+bool parquet_is_file_name(const char* path);
+bool parquet_open(ParquetReader* reader, const char* path, const char* const* names, size_t count);
+bool parquet_read_row_group(ParquetReader* reader, size_t index);
+void parquet_close(ParquetReader* reader);
+
+#endif // PARQUET_READER_H
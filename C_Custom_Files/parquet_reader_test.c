@@ -0,0 +1,199 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "parquet_reader.h"
+
+// Reader tests on tiny files written here: one required column, a dictionary
+// page and one dictionary-encoded data page. Corrupt dictionary headers must
+// fail the row group cleanly, never size an allocation from the raw count.
+
+static int failures = 0;
+
+#define CHECK(condition) do { \
+    if (!(condition)) { \
+        fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition); \
+        failures++; \
+    } \
+} while (0)
+
+// Thrift compact protocol writer, just enough for a footer and page headers
+typedef struct {
+    uint8_t bytes[1024];
+    size_t length;
+    int16_t last_id[8];         // Last field id per open struct
+    int depth;
+} Writer;
+
+static void put_byte(Writer* w, uint8_t byte) {
+    w->bytes[w->length++] = byte;
+}
+
+static void put_raw(Writer* w, const void* data, size_t length) {
+    memcpy(w->bytes + w->length, data, length);
+    w->length += length;
+}
+
+static void put_varint(Writer* w, uint64_t value) {
+    while (value >= 0x80) {
+        put_byte(w, (uint8_t)(value | 0x80));
+        value >>= 7;
+    }
+    put_byte(w, (uint8_t)value);
+}
+
+static void put_field(Writer* w, int16_t id, uint8_t type) {
+    put_byte(w, (uint8_t)((id - w->last_id[w->depth]) << 4 | type));
+    w->last_id[w->depth] = id;
+}
+
+static void put_int(Writer* w, int16_t id, int64_t value) {
+    put_field(w, id, 6);  // i64; the reader takes any integer width
+    put_varint(w, ((uint64_t)value << 1) ^ (uint64_t)(value >> 63));
+}
+
+static void put_string(Writer* w, int16_t id, const char* text) {
+    put_field(w, id, 8);
+    put_varint(w, strlen(text));
+    put_raw(w, text, strlen(text));
+}
+
+static void begin_struct(Writer* w) {
+    w->last_id[++w->depth] = 0;
+}
+
+static void begin_field_struct(Writer* w, int16_t id) {
+    put_field(w, id, 12);
+    begin_struct(w);
+}
+
+static void end_struct(Writer* w) {
+    put_byte(w, 0);
+    w->depth--;
+}
+
+static void put_list(Writer* w, int16_t id, size_t size) {
+    put_field(w, id, 9);
+    put_byte(w, (uint8_t)(size << 4 | 12));  // List of structs
+}
+
+static void put_page_header(Writer* w, int type, size_t size, int16_t sub_id, int64_t values, int encoding) {
+    begin_struct(w);
+    put_int(w, 1, type);
+    put_int(w, 2, (int64_t)size);
+    put_int(w, 3, (int64_t)size);
+    begin_field_struct(w, sub_id);
+    put_int(w, 1, values);
+    put_int(w, 2, encoding);
+    end_struct(w);
+    end_struct(w);
+}
+
+// Write a two-row file whose column "v" of the given type has a dictionary
+// page claiming dictionary_values entries over the given body bytes
+static bool write_file(const char* path, int type, int64_t dictionary_values,
+                       const void* dictionary, size_t dictionary_length) {
+    Writer w = {0};
+    put_raw(&w, "PAR1", 4);
+
+    size_t chunk_start = w.length;
+    put_page_header(&w, 2, dictionary_length, 7, dictionary_values, 0);
+    put_raw(&w, dictionary, dictionary_length);
+    size_t data_page = w.length;
+    const uint8_t indices[] = { 1, 3, 0x02 };  // Bit width 1, one packed group: 0, 1
+    put_page_header(&w, 0, sizeof(indices), 5, 2, 8);
+    put_raw(&w, indices, sizeof(indices));
+    size_t chunk_length = w.length - chunk_start;
+
+    size_t footer = w.length;
+    begin_struct(&w);
+    put_int(&w, 1, 1);
+    put_list(&w, 2, 2);
+    begin_struct(&w);
+    put_string(&w, 4, "schema");
+    put_int(&w, 5, 1);
+    end_struct(&w);
+    begin_struct(&w);
+    put_int(&w, 1, type);
+    put_int(&w, 3, 0);
+    put_string(&w, 4, "v");
+    end_struct(&w);
+    put_int(&w, 3, 2);
+    put_list(&w, 4, 1);
+    begin_struct(&w);
+    put_list(&w, 1, 1);
+    begin_struct(&w);
+    begin_field_struct(&w, 3);
+    put_int(&w, 1, type);
+    put_int(&w, 4, 0);
+    put_int(&w, 5, 2);
+    put_int(&w, 7, (int64_t)chunk_length);
+    put_int(&w, 9, (int64_t)data_page);
+    put_int(&w, 11, (int64_t)chunk_start);
+    end_struct(&w);
+    end_struct(&w);
+    put_int(&w, 3, 2);
+    end_struct(&w);
+    end_struct(&w);
+
+    uint32_t metadata_length = (uint32_t)(w.length - footer);
+    put_raw(&w, &metadata_length, 4);
+    put_raw(&w, "PAR1", 4);
+
+    FILE* file = fopen(path, "wb");
+    if (!file) return false;
+    bool ok = fwrite(w.bytes, 1, w.length, file) == w.length;
+    return fclose(file) == 0 && ok;
+}
+
+// Open path and decode its only row group
+static bool read_file(const char* path, ParquetReader* reader) {
+    const char* names[] = { "v" };
+    return parquet_open(reader, path, names, 1) && parquet_read_row_group(reader, 0);
+}
+
+static void test_valid_dictionary(const char* path) {
+    const int64_t values[] = { 10, 20 };
+    CHECK(write_file(path, PARQUET_INT64, 2, values, sizeof(values)));
+    ParquetReader reader;
+    bool ok = read_file(path, &reader);
+    CHECK(ok);
+    if (ok) {
+        CHECK(reader.group_rows == 2);
+        CHECK(reader.columns[0].ints[0] == 10 && reader.columns[0].ints[1] == 20);
+    }
+    parquet_close(&reader);
+}
+
+// num_values larger than the page could hold, including counts whose
+// allocation size would wrap
+static void test_corrupt_dictionary(const char* path, int type, int64_t count) {
+    const int64_t values[] = { 10, 20 };
+    CHECK(write_file(path, type, count, values, sizeof(values)));
+    ParquetReader reader;
+    CHECK(!read_file(path, &reader));
+    CHECK(strstr(reader.error, "dictionary") != NULL);
+    parquet_close(&reader);
+}
+
+int main(void) {
+    const char* tmpdir = getenv("TMPDIR");
+    char path[4096];
+    snprintf(path, sizeof(path), "%s/parquet_reader_test_%d.parquet", tmpdir && *tmpdir ? tmpdir : "/tmp", (int)getpid());
+
+    test_valid_dictionary(path);
+    test_corrupt_dictionary(path, PARQUET_INT64, 3);
+    test_corrupt_dictionary(path, PARQUET_INT64, (int64_t)1 << 60);
+    test_corrupt_dictionary(path, PARQUET_DOUBLE, (int64_t)1 << 60);
+    test_corrupt_dictionary(path, PARQUET_INT32, 5);
+    test_corrupt_dictionary(path, PARQUET_BYTE_ARRAY, (int64_t)1 << 60);
+    test_corrupt_dictionary(path, PARQUET_BYTE_ARRAY, ((int64_t)1 << 62) + 1);
+    unlink(path);
+
+    if (failures) {
+        fprintf(stderr, "parquet_reader_test: %d failures\n", failures);
+        return 1;
+    }
+    printf("parquet_reader_test: ok\n");
+    return 0;
+}
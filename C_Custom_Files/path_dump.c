@@ -0,0 +1,81 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include "path_store.h"
+#include "fixed_point.h"
+
+// Print one path as lat_grid;lon_grid;advertiser_id;start;(lat,lon,speed,...)
+static void print_path(const PathStoreCell* cell, const PathStorePath* path) {
+    char number[FIXED_WRITE_MAX + 1];
+    printf("%d;%d;%.*s;%lld;(", cell->lat_grid, cell->lon_grid, (int)path->id_length, path->id,
+           (long long)path->start_time);
+    for (size_t i = 0; i < path->point_count; i++) {
+        const PathStorePoint* point = &path->points[i];
+        if (i > 0) putchar(',');
+        fwrite(number, 1, fixed_write(number, point->latitude, MICRODEGREE_DECIMALS), stdout);
+        putchar(',');
+        fwrite(number, 1, fixed_write(number, point->longitude, MICRODEGREE_DECIMALS), stdout);
+        putchar(',');
+        fwrite(number, 1, fixed_write(number, point->speed, SPEED_DECIMALS), stdout);
+    }
+    fputs(")\n", stdout);
+}
+
+// Print the paths of a path store as text, optionally only one cell (-c)
+// and only paths starting in an inclusive epoch range (-t)
+int main(int argc, char* argv[]) {
+    bool one_cell = false;
+    int lat_grid = 0, lon_grid = 0;
+    long long from = INT64_MIN, to = INT64_MAX;
+    int opt;
+    while ((opt = getopt(argc, argv, "c:t:")) != -1) {
+        if (opt == 'c' && sscanf(optarg, "%d,%d", &lat_grid, &lon_grid) == 2) {
+            one_cell = true;
+        } else if (opt != 't' || sscanf(optarg, "%lld,%lld", &from, &to) != 2) {
+            optind = argc;
+            break;
+        }
+    }
+    if (argc - optind != 1) {
+        fprintf(stderr, "Usage: %s [-c lat_grid,lon_grid] [-t from,to] <paths.store>\n", argv[0]);
+        return 1;
+    }
+
+    PathStore store;
+    if (!path_store_open(&store, argv[optind])) {
+        fprintf(stderr, "Error: %s is not a readable path store\n", argv[optind]);
+        return 1;
+    }
+
+    size_t cell_begin = 0, cell_end = store.cell_count;
+    if (one_cell) {
+        const PathStoreCell* cell = path_store_find_cell(&store, lat_grid, lon_grid);
+        cell_begin = cell ? (size_t)(cell - store.cells) : 0;
+        cell_end = cell ? cell_begin + 1 : 0;
+    }
+
+    printf("lat_grid;lon_grid;advertiser_id;start_timestamp;path_points\n");
+    size_t printed = 0;
+    for (size_t c = cell_begin; c < cell_end; c++) {
+        const PathStoreCell* cell = &store.cells[c];
+        size_t first;
+        size_t count = path_store_cell_range(&store, cell, from, to, &first);
+        for (size_t i = first; i < first + count; i++) {
+            PathStorePath path;
+            if (!path_store_path(&store, i, &path)) {
+                fprintf(stderr, "Error: corrupt path record %zu\n", i);
+                path_store_close(&store);
+                return 1;
+            }
+            print_path(cell, &path);
+            printed++;
+        }
+    }
+
+    fprintf(stderr, "%s: %zu of %llu paths in %zu cells\n", argv[optind], printed,
+            (unsigned long long)store.header->path_count, store.cell_count);
+    path_store_close(&store);
+    return 0;
+}
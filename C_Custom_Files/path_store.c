@@ -0,0 +1,397 @@
+#include "path_store.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define PATH_STORE_BUFFER (1u << 20)   // Scratch and output write size
+#define ALIGN8(n) (((n) + 7) & ~(uint64_t)7)
+
+// Bytes one path takes in the segment
+static uint64_t record_bytes(uint64_t id_length, uint64_t point_count) {
+    return sizeof(PathRecord) + ALIGN8(id_length) + point_count * sizeof(PathStorePoint);
+}
+
+// Map a path store and check that its sections and cells lie inside it.
+// Records are checked as they are read. Returns false for missing,
+// truncated or foreign files; the store is then closed.
+bool path_store_open(PathStore* store, const char* path) {
+    memset(store, 0, sizeof(*store));
+    store->fd = open(path, O_RDONLY);
+    if (store->fd < 0) return false;
+
+    struct stat st;
+    if (fstat(store->fd, &st) != 0 || (size_t)st.st_size < sizeof(PathStoreHeader)) {
+        path_store_close(store);
+        return false;
+    }
+    store->size = (size_t)st.st_size;
+    void* data = mmap(NULL, store->size, PROT_READ, MAP_PRIVATE, store->fd, 0);
+    if (data == MAP_FAILED) {
+        path_store_close(store);
+        return false;
+    }
+    store->data = data;
+    store->header = data;
+
+    const PathStoreHeader* header = store->header;
+    uint64_t size = store->size;
+    bool ok = memcmp(header->magic, PATH_STORE_MAGIC, sizeof(header->magic)) == 0 &&
+              header->version == PATH_STORE_VERSION && header->segment_offset == sizeof(PathStoreHeader) &&
+              header->segment_bytes <= size - header->segment_offset &&
+              header->entry_offset % 8 == 0 && header->entry_offset >= header->segment_offset + header->segment_bytes &&
+              header->entry_offset <= size &&
+              header->path_count <= (size - header->entry_offset) / sizeof(PathStoreEntry) &&
+              header->cell_offset % 8 == 0 &&
+              header->cell_offset >= header->entry_offset + header->path_count * sizeof(PathStoreEntry) &&
+              header->cell_offset <= size &&
+              header->cell_count <= (size - header->cell_offset) / sizeof(PathStoreCell);
+    if (ok) {
+        store->entries = (const PathStoreEntry*)(store->data + header->entry_offset);
+        store->entry_count = (size_t)header->path_count;
+        store->cells = (const PathStoreCell*)(store->data + header->cell_offset);
+        store->cell_count = (size_t)header->cell_count;
+
+        uint64_t segment_end = header->segment_offset + header->segment_bytes;
+        for (size_t i = 0; ok && i < store->cell_count; i++) {
+            const PathStoreCell* cell = &store->cells[i];
+            ok = cell->first_entry <= header->path_count && cell->entry_count <= header->path_count - cell->first_entry &&
+                 cell->offset >= header->segment_offset && cell->offset <= segment_end &&
+                 cell->bytes <= segment_end - cell->offset;
+            if (ok && i > 0) {
+                const PathStoreCell* previous = &store->cells[i - 1];
+                ok = previous->lat_grid < cell->lat_grid ||
+                     (previous->lat_grid == cell->lat_grid && previous->lon_grid < cell->lon_grid);
+            }
+        }
+    }
+    if (!ok) {
+        path_store_close(store);
+        return false;
+    }
+
+    // Queries jump straight to a cell's bytes
+    madvise(data, store->size, MADV_RANDOM);
+    return true;
+}
+
+void path_store_close(PathStore* store) {
+    if (store->data) munmap((void*)store->data, store->size);
+    if (store->fd >= 0) close(store->fd);
+    memset(store, 0, sizeof(*store));
+    store->fd = -1;
+}
+
+// The cell's index entry, or NULL if the store has no paths there
+const PathStoreCell* path_store_find_cell(const PathStore* store, int32_t lat_grid, int32_t lon_grid) {
+    size_t low = 0, high = store->cell_count;
+    while (low < high) {
+        size_t mid = low + (high - low) / 2;
+        const PathStoreCell* cell = &store->cells[mid];
+        if (cell->lat_grid < lat_grid || (cell->lat_grid == lat_grid && cell->lon_grid < lon_grid)) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+    if (low < store->cell_count && store->cells[low].lat_grid == lat_grid && store->cells[low].lon_grid == lon_grid) {
+        return &store->cells[low];
+    }
+    return NULL;
+}
+
+// First entry in [begin, end) whose start is at least time
+static size_t lower_bound(const PathStore* store, size_t begin, size_t end, int64_t time) {
+    while (begin < end) {
+        size_t mid = begin + (end - begin) / 2;
+        if (store->entries[mid].start_time < time) begin = mid + 1;
+        else end = mid;
+    }
+    return begin;
+}
+
+// Entries of a cell whose paths start in [from, to] (inclusive): sets
+// *first and returns how many follow it
+size_t path_store_cell_range(const PathStore* store, const PathStoreCell* cell, int64_t from, int64_t to,
+                             size_t* first) {
+    size_t begin = (size_t)cell->first_entry;
+    size_t end = begin + (size_t)cell->entry_count;
+    *first = lower_bound(store, begin, end, from);
+    if (to < from) return 0;
+    size_t last = to == INT64_MAX ? end : lower_bound(store, *first, end, to + 1);
+    return last - *first;
+}
+
+// Decode the path at an entry. Returns false if the entry is out of range
+// or its record does not fit in the segment.
+bool path_store_path(const PathStore* store, size_t entry, PathStorePath* path) {
+    if (entry >= store->entry_count) return false;
+    const PathStoreHeader* header = store->header;
+    uint64_t offset = store->entries[entry].offset;
+    uint64_t segment_end = header->segment_offset + header->segment_bytes;
+    if (offset % 8 != 0 || offset < header->segment_offset || offset > segment_end ||
+        segment_end - offset < sizeof(PathRecord)) {
+        return false;
+    }
+    const PathRecord* record = (const PathRecord*)(store->data + offset);
+    if (record_bytes(record->id_length, record->point_count) > segment_end - offset) return false;
+
+    path->start_time = record->start_time;
+    path->id = (const char*)(record + 1);
+    path->id_length = record->id_length;
+    path->points = (const PathStorePoint*)(store->data + offset + sizeof(PathRecord) + ALIGN8(record->id_length));
+    path->point_count = record->point_count;
+    return true;
+}
+
+// ---- Writer ----
+
+static bool write_all(int fd, const void* buffer, size_t length) {
+    const char* p = buffer;
+    while (length > 0) {
+        ssize_t written = write(fd, p, length);
+        if (written <= 0) return false;
+        p += written;
+        length -= (size_t)written;
+    }
+    return true;
+}
+
+// Append to the scratch file through the buffer; caller holds the lock
+static void scratch_append(PathStoreWriter* writer, const void* data, size_t length) {
+    const char* p = data;
+    while (length > 0 && !writer->failed) {
+        size_t chunk = PATH_STORE_BUFFER - writer->used;
+        if (chunk > length) chunk = length;
+        memcpy(writer->buffer + writer->used, p, chunk);
+        writer->used += chunk;
+        p += chunk;
+        length -= chunk;
+        if (writer->used == PATH_STORE_BUFFER) {
+            if (!write_all(writer->scratch_fd, writer->buffer, writer->used)) writer->failed = true;
+            writer->scratch_bytes += writer->used;
+            writer->used = 0;
+        }
+    }
+}
+
+// FNV-1a of the advertiser id
+static uint64_t hash_id(const char* p, size_t length) {
+    uint64_t hash = 14695981039346656037ULL;
+    for (size_t i = 0; i < length; i++) {
+        hash = (hash ^ (uint8_t)p[i]) * 1099511628211ULL;
+    }
+    return hash;
+}
+
+static void free_writer(PathStoreWriter* writer) {
+    if (writer->scratch_fd >= 0) close(writer->scratch_fd);
+    pthread_mutex_destroy(&writer->lock);
+    free(writer->path);
+    free(writer->buffer);
+    free(writer->slots);
+    writer->scratch_fd = -1;
+}
+
+// Start a store at path. The store itself is written on close; until then
+// records live in an unlinked scratch file beside it.
+bool path_store_writer_open(PathStoreWriter* writer, const char* path) {
+    memset(writer, 0, sizeof(*writer));
+    writer->scratch_fd = -1;
+    pthread_mutex_init(&writer->lock, NULL);
+    writer->path = strdup(path);
+    writer->buffer = malloc(PATH_STORE_BUFFER);
+    if (!writer->path || !writer->buffer) {
+        free_writer(writer);
+        return false;
+    }
+
+    size_t length = strlen(path) + sizeof(".records");
+    char* scratch = malloc(length);
+    if (!scratch) {
+        free_writer(writer);
+        return false;
+    }
+    snprintf(scratch, length, "%s.records", path);
+    writer->scratch_fd = open(scratch, O_RDWR | O_CREAT | O_TRUNC, 0600);
+    if (writer->scratch_fd >= 0) unlink(scratch);
+    free(scratch);
+    if (writer->scratch_fd < 0) {
+        free_writer(writer);
+        return false;
+    }
+    return true;
+}
+
+// Add one path starting at start_time in a cell. Point time offsets are
+// relative to start_time. Safe to call from several threads.
+bool path_store_writer_add(PathStoreWriter* writer, int32_t lat_grid, int32_t lon_grid, const char* id,
+                           size_t id_length, int64_t start_time, const PathStorePoint* points, size_t count) {
+    if (id_length > UINT32_MAX || count > UINT32_MAX) return false;
+    static const char zeros[8] = {0};
+    PathRecord record = { start_time, (uint32_t)count, (uint32_t)id_length };
+    uint64_t id_hash = hash_id(id, id_length);
+
+    pthread_mutex_lock(&writer->lock);
+    if (writer->slot_count == writer->slot_capacity && !writer->failed) {
+        size_t capacity = writer->slot_capacity ? writer->slot_capacity * 2 : 4096;
+        PathStoreSlot* slots = realloc(writer->slots, capacity * sizeof(PathStoreSlot));
+        if (slots) {
+            writer->slots = slots;
+            writer->slot_capacity = capacity;
+        } else {
+            writer->failed = true;
+        }
+    }
+    if (writer->failed) {
+        pthread_mutex_unlock(&writer->lock);
+        return false;
+    }
+
+    PathStoreSlot* slot = &writer->slots[writer->slot_count++];
+    slot->lat_grid = lat_grid;
+    slot->lon_grid = lon_grid;
+    slot->start_time = start_time;
+    slot->id_hash = id_hash;
+    slot->offset = writer->scratch_bytes + writer->used;
+    slot->bytes = record_bytes(id_length, count);
+    scratch_append(writer, &record, sizeof(record));
+    scratch_append(writer, id, id_length);
+    scratch_append(writer, zeros, (size_t)(ALIGN8(id_length) - id_length));
+    scratch_append(writer, points, count * sizeof(PathStorePoint));
+    writer->point_count += count;
+    bool ok = !writer->failed;
+    pthread_mutex_unlock(&writer->lock);
+    return ok;
+}
+
+static int compare_slots(const void* a, const void* b) {
+    const PathStoreSlot* sa = a;
+    const PathStoreSlot* sb = b;
+    if (sa->lat_grid != sb->lat_grid) return sa->lat_grid < sb->lat_grid ? -1 : 1;
+    if (sa->lon_grid != sb->lon_grid) return sa->lon_grid < sb->lon_grid ? -1 : 1;
+    if (sa->start_time != sb->start_time) return sa->start_time < sb->start_time ? -1 : 1;
+    if (sa->id_hash != sb->id_hash) return sa->id_hash < sb->id_hash ? -1 : 1;
+    return (sa->offset > sb->offset) - (sa->offset < sb->offset);
+}
+
+// Buffered output of the final store
+typedef struct {
+    int fd;
+    char* buffer;
+    size_t used;
+    uint64_t offset;
+    bool failed;
+} StoreOutput;
+
+static void output_write(StoreOutput* out, const void* data, size_t length) {
+    const char* p = data;
+    while (length > 0 && !out->failed) {
+        size_t chunk = PATH_STORE_BUFFER - out->used;
+        if (chunk > length) chunk = length;
+        memcpy(out->buffer + out->used, p, chunk);
+        out->used += chunk;
+        out->offset += chunk;
+        p += chunk;
+        length -= chunk;
+        if (out->used == PATH_STORE_BUFFER) {
+            out->failed = !write_all(out->fd, out->buffer, out->used);
+            out->used = 0;
+        }
+    }
+}
+
+// Copy bytes at offset in the scratch file to the output. Reading with
+// pread rather than mapping the scratch file keeps its pages out of the
+// process's resident set.
+static void output_copy(StoreOutput* out, int fd, uint64_t offset, uint64_t bytes) {
+    while (bytes > 0 && !out->failed) {
+        if (out->used == PATH_STORE_BUFFER) {
+            out->failed = !write_all(out->fd, out->buffer, out->used);
+            out->used = 0;
+            continue;
+        }
+        size_t chunk = PATH_STORE_BUFFER - out->used;
+        if (chunk > bytes) chunk = (size_t)bytes;
+        ssize_t got = pread(fd, out->buffer + out->used, chunk, (off_t)offset);
+        if (got <= 0) {
+            out->failed = true;
+            break;
+        }
+        out->used += (size_t)got;
+        out->offset += (uint64_t)got;
+        offset += (uint64_t)got;
+        bytes -= (uint64_t)got;
+    }
+}
+
+// Sort the paths into cell and time order and write the store: segment,
+// entries, cells, then the header. The store replaces path atomically.
+// Returns false if any write failed along the way.
+bool path_store_writer_close(PathStoreWriter* writer) {
+    bool ok = !writer->failed;
+    if (ok && writer->used > 0) ok = write_all(writer->scratch_fd, writer->buffer, writer->used);
+    writer->scratch_bytes += writer->used;
+    writer->used = 0;
+
+    qsort(writer->slots, writer->slot_count, sizeof(PathStoreSlot), compare_slots);
+
+    size_t temp_length = strlen(writer->path) + sizeof(".tmp");
+    char* temp = malloc(temp_length);
+    PathStoreEntry* entries = malloc((writer->slot_count + 1) * sizeof(PathStoreEntry));
+    PathStoreCell* cells = malloc((writer->slot_count + 1) * sizeof(PathStoreCell));
+    StoreOutput out = { .fd = -1, .buffer = writer->buffer };
+    if (!temp || !entries || !cells) ok = false;
+    if (ok) {
+        snprintf(temp, temp_length, "%s.tmp", writer->path);
+        out.fd = open(temp, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        ok = out.fd >= 0;
+    }
+
+    PathStoreHeader header = {0};
+    size_t cell_count = 0;
+    if (ok) {
+        output_write(&out, &header, sizeof(header));
+        for (size_t i = 0; i < writer->slot_count; i++) {
+            const PathStoreSlot* slot = &writer->slots[i];
+            PathStoreCell* cell = cell_count > 0 ? &cells[cell_count - 1] : NULL;
+            if (!cell || cell->lat_grid != slot->lat_grid || cell->lon_grid != slot->lon_grid) {
+                cell = &cells[cell_count++];
+                *cell = (PathStoreCell){ slot->lat_grid, slot->lon_grid, i, 0, out.offset, 0 };
+            }
+            entries[i].start_time = slot->start_time;
+            entries[i].offset = out.offset;
+            output_copy(&out, writer->scratch_fd, slot->offset, slot->bytes);
+            cell->entry_count++;
+            cell->bytes += slot->bytes;
+        }
+
+        memcpy(header.magic, PATH_STORE_MAGIC, sizeof(header.magic));
+        header.version = PATH_STORE_VERSION;
+        header.path_count = writer->slot_count;
+        header.point_count = writer->point_count;
+        header.segment_offset = sizeof(PathStoreHeader);
+        header.segment_bytes = out.offset - sizeof(PathStoreHeader);
+        header.entry_offset = out.offset;
+        output_write(&out, entries, writer->slot_count * sizeof(PathStoreEntry));
+        header.cell_count = cell_count;
+        header.cell_offset = out.offset;
+        output_write(&out, cells, cell_count * sizeof(PathStoreCell));
+        if (!out.failed && out.used > 0) out.failed = !write_all(out.fd, out.buffer, out.used);
+        ok = !out.failed && pwrite(out.fd, &header, sizeof(header), 0) == (ssize_t)sizeof(header);
+    }
+    if (out.fd >= 0) {
+        ok = close(out.fd) == 0 && ok;
+        if (ok) ok = rename(temp, writer->path) == 0;
+        if (!ok) unlink(temp);
+    }
+
+    free(temp);
+    free(entries);
+    free(cells);
+    free_writer(writer);
+    return ok;
+}
@@ -0,0 +1,126 @@
+#ifndef PATH_STORE_H
+#define PATH_STORE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <pthread.h>
+
+// Binary store of travel paths, written once by location_processor and
+// mmap'd by readers. Paths are sorted by grid cell, then start time, and
+// keep every point (nothing is truncated). Layout (little-endian, every
+// section and record 8-byte aligned):
+//   PathStoreHeader
+//   segment: per path a PathRecord, the advertiser id padded to 8 bytes,
+//            then PathStorePoint[point_count]
+//   PathStoreEntry[path_count], in segment order
+//   PathStoreCell[cell_count], sorted by (lat_grid, lon_grid)
+#define PATH_STORE_MAGIC "SHDPATH1"
+#define PATH_STORE_VERSION 1
+
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t reserved;
+    uint64_t path_count;
+    uint64_t point_count;
+    uint64_t segment_offset;
+    uint64_t segment_bytes;
+    uint64_t entry_offset;
+    uint64_t cell_count;
+    uint64_t cell_offset;
+} PathStoreHeader;
+
+typedef struct {
+    int64_t start_time;         // Epoch seconds of the first point
+    uint32_t point_count;
+    uint32_t id_length;
+} PathRecord;
+
+typedef struct {
+    int32_t latitude;           // Microdegrees
+    int32_t longitude;
+    int32_t time_offset;        // Seconds after the path's start
+    int16_t speed;              // cm/s
+    int16_t reserved;
+} PathStorePoint;
+
+// One path in the index: enough to binary search a cell by start time
+typedef struct {
+    int64_t start_time;
+    uint64_t offset;            // PathRecord's byte offset in the file
+} PathStoreEntry;
+
+// A cell's paths are entries [first_entry, first_entry + entry_count) and
+// bytes [offset, offset + bytes) of the file
+typedef struct {
+    int32_t lat_grid;
+    int32_t lon_grid;
+    uint64_t first_entry;
+    uint64_t entry_count;
+    uint64_t offset;
+    uint64_t bytes;
+} PathStoreCell;
+
+// One decoded path, pointing into the mapping
+typedef struct {
+    int64_t start_time;
+    const char* id;             // Not NUL-terminated
+    size_t id_length;
+    const PathStorePoint* points;
+    size_t point_count;
+} PathStorePath;
+
+// Read-only view of a mapped path store
+typedef struct {
+    int fd;
+    const uint8_t* data;
+    size_t size;
+    const PathStoreHeader* header;
+    const PathStoreEntry* entries;
+    size_t entry_count;
+    const PathStoreCell* cells;
+    size_t cell_count;
+} PathStore;
+
+// Where a path's record sits in the writer's scratch file, and its sort key
+typedef struct {
+    int32_t lat_grid;
+    int32_t lon_grid;
+    int64_t start_time;
+    uint64_t id_hash;           // Orders equal starts the same way every run
+    uint64_t offset;
+    uint64_t bytes;
+} PathStoreSlot;
+
+// Builds a path store. Any number of threads may add paths; records go to
+// an unlinked scratch file in arrival order and are sorted into the store
+// on close, so memory holds only a PathStoreSlot per path.
+typedef struct {
+    pthread_mutex_t lock;
+    char* path;
+    int scratch_fd;
+    uint64_t scratch_bytes;     // Written to the scratch file so far
+    char* buffer;               // Records not yet in the scratch file
+    size_t used;
+    PathStoreSlot* slots;
+    size_t slot_count;
+    size_t slot_capacity;
+    uint64_t point_count;
+    bool failed;
+} PathStoreWriter;
+
+// Function prototypes
+bool path_store_open(PathStore* store, const char* path);
+void path_store_close(PathStore* store);
+const PathStoreCell* path_store_find_cell(const PathStore* store, int32_t lat_grid, int32_t lon_grid);
+size_t path_store_cell_range(const PathStore* store, const PathStoreCell* cell, int64_t from, int64_t to,
+                             size_t* first);
+bool path_store_path(const PathStore* store, size_t entry, PathStorePath* path);
+
+bool path_store_writer_open(PathStoreWriter* writer, const char* path);
+bool path_store_writer_add(PathStoreWriter* writer, int32_t lat_grid, int32_t lon_grid, const char* id,
+                           size_t id_length, int64_t start_time, const PathStorePoint* points, size_t count);
+bool path_store_writer_close(PathStoreWriter* writer);
+
+#endif // PATH_STORE_H
@@ -0,0 +1,175 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sys/stat.h>
+#include "csv_reader.h"
+#include "parquet_reader.h"
+#include "timestamp.h"
+#include "fixed_point.h"
+#include "file_pool.h"
+#include "ping_file.h"
+
+// Input columns used from each ping row, as in the tools
+#define COL_ADVERTISER_ID 0
+#define COL_TIMESTAMP 3
+#define COL_LATITUDE 4
+#define COL_LONGITUDE 5
+#define COL_SPEED 10
+#define CSV_COLUMNS 11
+
+static const char* const PARQUET_COLUMNS[] = {
+    "advertiser_id", "local_location_at", "latitude", "longitude", "speed"
+};
+enum { PQ_ADVERTISER_ID, PQ_TIMESTAMP, PQ_LATITUDE, PQ_LONGITUDE, PQ_SPEED, PQ_COLUMNS };
+
+typedef struct {
+    size_t rows;                // Rows read
+    size_t written;             // Pings written
+} ConvertStats;
+
+// Monotonic clock in seconds
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// Rows the tools would drop anyway (no device, bad timestamp or location)
+// are left out; an empty speed is kept as 0
+static void convert_csv(PingWriter* writer, const char* path, ConvertStats* stats) {
+    CsvReader reader;
+    if (!csv_reader_open(&reader, path)) {
+        fprintf(stderr, "Failed to open %s\n", path);
+        return;
+    }
+
+    CsvField fields[CSV_COLUMNS];
+    TimestampCache time_cache = {0};
+    int field_count;
+    while ((field_count = csv_reader_next(&reader, fields, CSV_COLUMNS)) >= 0) {
+        stats->rows++;
+        if (field_count < CSV_COLUMNS || fields[COL_ADVERTISER_ID].len == 0) {
+            continue;
+        }
+        Timestamp time;
+        int32_t latitude, longitude;
+        if (!timestamp_parse(&time_cache, fields[COL_TIMESTAMP].ptr, fields[COL_TIMESTAMP].len, &time) ||
+            !fixed_parse_microdegrees(fields[COL_LATITUDE].ptr, fields[COL_LATITUDE].len, &latitude) ||
+            !fixed_parse_microdegrees(fields[COL_LONGITUDE].ptr, fields[COL_LONGITUDE].len, &longitude)) {
+            continue;
+        }
+        int16_t speed = 0;
+        fixed_parse_speed(fields[COL_SPEED].ptr, fields[COL_SPEED].len, &speed);
+
+        stats->written += ping_writer_add(writer, fields[COL_ADVERTISER_ID].ptr, fields[COL_ADVERTISER_ID].len,
+                                          time.epoch, latitude, longitude, speed);
+    }
+    csv_reader_close(&reader);
+}
+
+static void convert_parquet(PingWriter* writer, const char* path, ConvertStats* stats) {
+    ParquetReader reader;
+    if (!parquet_open(&reader, path, PARQUET_COLUMNS, PQ_COLUMNS)) {
+        fprintf(stderr, "Failed to open %s: %s\n", path, reader.error);
+        parquet_close(&reader);
+        return;
+    }
+    const ParquetColumn* columns = reader.columns;
+    if (columns[PQ_ADVERTISER_ID].type != PARQUET_BYTE_ARRAY || columns[PQ_TIMESTAMP].type != PARQUET_BYTE_ARRAY ||
+        (columns[PQ_LATITUDE].type != PARQUET_DOUBLE && columns[PQ_LATITUDE].type != PARQUET_FLOAT) ||
+        (columns[PQ_LONGITUDE].type != PARQUET_DOUBLE && columns[PQ_LONGITUDE].type != PARQUET_FLOAT) ||
+        (columns[PQ_SPEED].type != PARQUET_DOUBLE && columns[PQ_SPEED].type != PARQUET_FLOAT)) {
+        fprintf(stderr, "Unexpected column types in %s\n", path);
+        parquet_close(&reader);
+        return;
+    }
+
+    TimestampCache time_cache = {0};
+    const ParquetColumn* ids = &columns[PQ_ADVERTISER_ID];
+    const ParquetColumn* times = &columns[PQ_TIMESTAMP];
+    const ParquetColumn* speeds = &columns[PQ_SPEED];
+    for (size_t g = 0; g < reader.row_group_count; g++) {
+        if (!parquet_read_row_group(&reader, g)) {
+            fprintf(stderr, "Failed to read %s: %s\n", path, reader.error);
+            break;
+        }
+        stats->rows += reader.group_rows;
+        for (size_t i = 0; i < reader.group_rows; i++) {
+            Timestamp time;
+            int32_t latitude, longitude;
+            if (!ids->present[i] || ids->strings[i].len == 0 || !times->present[i] ||
+                !timestamp_parse(&time_cache, times->strings[i].ptr, times->strings[i].len, &time) ||
+                !columns[PQ_LATITUDE].present[i] || !columns[PQ_LONGITUDE].present[i] ||
+                !fixed_microdegrees_from_double(columns[PQ_LATITUDE].doubles[i], &latitude) ||
+                !fixed_microdegrees_from_double(columns[PQ_LONGITUDE].doubles[i], &longitude)) {
+                continue;
+            }
+            int16_t speed = 0;
+            if (speeds->present[i]) {
+                fixed_speed_from_double(speeds->doubles[i], &speed);
+            }
+
+            stats->written += ping_writer_add(writer, ids->strings[i].ptr, ids->strings[i].len,
+                                              time.epoch, latitude, longitude, speed);
+        }
+    }
+    parquet_close(&reader);
+}
+
+// Convert CSV and Parquet ping files into one columnar ping file. Rows keep
+// their input order (directories in scan order), so the tools give the same
+// results on the converted file as on the originals.
+int main(int argc, char* argv[]) {
+    if (argc < 3) {
+        fprintf(stderr, "Usage: %s <output.ping> <file or directory>...\n", argv[0]);
+        return 1;
+    }
+
+    FileList files = {0};
+    for (int i = 2; i < argc; i++) {
+        struct stat st;
+        if (stat(argv[i], &st) == 0 && S_ISDIR(st.st_mode)) {
+            file_list_scan(&files, argv[i], ".csv");
+            file_list_scan(&files, argv[i], ".parquet");
+        } else {
+            file_list_add(&files, argv[i]);
+        }
+    }
+
+    PingWriter writer;
+    if (!ping_writer_open(&writer, argv[1])) {
+        fprintf(stderr, "Failed to create %s\n", argv[1]);
+        file_list_free(&files);
+        return 1;
+    }
+
+    ConvertStats stats = {0};
+    size_t input_bytes = 0;
+    double start = now_seconds();
+    for (size_t i = 0; i < files.count; i++) {
+        struct stat st;
+        if (stat(files.paths[i], &st) == 0) input_bytes += (size_t)st.st_size;
+        printf("Converting %s\n", files.paths[i]);
+        if (parquet_is_file_name(files.paths[i])) {
+            convert_parquet(&writer, files.paths[i], &stats);
+        } else {
+            convert_csv(&writer, files.paths[i], &stats);
+        }
+    }
+    size_t devices = writer.device_count;
+    size_t blocks = writer.block_count + (writer.rows > 0);
+    bool ok = ping_writer_close(&writer);
+    double seconds = now_seconds() - start;
+    file_list_free(&files);
+    if (!ok) {
+        fprintf(stderr, "Failed writing %s\n", argv[1]);
+        return 1;
+    }
+
+    struct stat st;
+    size_t output_bytes = stat(argv[1], &st) == 0 ? (size_t)st.st_size : 0;
+    printf("Wrote %zu of %zu rows (%zu devices, %zu blocks) in %.3f s: %zu bytes in, %zu bytes out\n",
+           stats.written, stats.rows, devices, blocks, seconds, input_bytes, output_bytes);
+    return 0;
+}
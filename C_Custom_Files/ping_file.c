@@ -0,0 +1,338 @@
+#include "ping_file.h"
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define PING_ROW_BYTES (3 * sizeof(int32_t) + sizeof(uint32_t) + sizeof(int16_t))
+#define INITIAL_DICTIONARY_SLOTS 4096   // Power of two
+#define ALIGN8(n) (((n) + 7) & ~(uint64_t)7)
+
+// Bytes one block's columns take, padded so the next block stays aligned
+static uint64_t block_bytes(uint64_t rows) {
+    return ALIGN8(rows * PING_ROW_BYTES);
+}
+
+// Whether a path names a ping file (by its .ping extension)
+bool ping_is_file_name(const char* path) {
+    size_t length = strlen(path);
+    return length >= 5 && strcmp(path + length - 5, ".ping") == 0;
+}
+
+// A filter every block matches
+void ping_filter_all(PingFilter* filter) {
+    filter->min_time = filter->min_latitude = filter->min_longitude = INT32_MIN;
+    filter->max_time = filter->max_latitude = filter->max_longitude = INT32_MAX;
+}
+
+// Map a ping file and check that every section lies inside it. Returns
+// false for missing, truncated or foreign files; the file is then closed.
+bool ping_file_open(PingFile* file, const char* path) {
+    memset(file, 0, sizeof(*file));
+    file->fd = open(path, O_RDONLY);
+    if (file->fd < 0) return false;
+
+    struct stat st;
+    if (fstat(file->fd, &st) != 0 || (size_t)st.st_size < sizeof(PingFileHeader)) {
+        ping_file_close(file);
+        return false;
+    }
+    file->size = (size_t)st.st_size;
+    void* data = mmap(NULL, file->size, PROT_READ, MAP_PRIVATE, file->fd, 0);
+    if (data == MAP_FAILED) {
+        ping_file_close(file);
+        return false;
+    }
+    file->data = data;
+    file->header = data;
+
+    const PingFileHeader* header = file->header;
+    uint64_t size = file->size;
+    bool ok = memcmp(header->magic, PING_FILE_MAGIC, sizeof(header->magic)) == 0 &&
+              header->version == PING_FILE_VERSION && header->block_rows > 0 &&
+              header->block_index_offset % 8 == 0 && header->block_index_offset <= size &&
+              header->block_count <= (size - header->block_index_offset) / sizeof(PingBlockHeader) &&
+              header->dictionary_offset % 8 == 0 && header->dictionary_offset <= size &&
+              header->device_count < (size - header->dictionary_offset) / sizeof(uint64_t);
+    if (ok) {
+        file->blocks = (const PingBlockHeader*)(file->data + header->block_index_offset);
+        file->block_count = (size_t)header->block_count;
+        file->device_offsets = (const uint64_t*)(file->data + header->dictionary_offset);
+        file->device_count = (size_t)header->device_count;
+        file->device_bytes = (const char*)(file->device_offsets + file->device_count + 1);
+
+        uint64_t dictionary_bytes = size - ((const uint8_t*)file->device_bytes - file->data);
+        ok = file->device_offsets[0] == 0 && file->device_offsets[file->device_count] <= dictionary_bytes;
+        for (size_t i = 0; ok && i < file->device_count; i++) {
+            ok = file->device_offsets[i] <= file->device_offsets[i + 1];
+        }
+        for (size_t i = 0; ok && i < file->block_count; i++) {
+            const PingBlockHeader* block = &file->blocks[i];
+            ok = block->rows <= header->block_rows && block->offset % 8 == 0 &&
+                 block->offset >= sizeof(PingFileHeader) && block->offset <= header->block_index_offset &&
+                 block_bytes(block->rows) <= header->block_index_offset - block->offset;
+        }
+    }
+    if (!ok) {
+        ping_file_close(file);
+        return false;
+    }
+
+    madvise(data, file->size, MADV_SEQUENTIAL);
+    return true;
+}
+
+void ping_file_close(PingFile* file) {
+    if (file->data) munmap((void*)file->data, file->size);
+    if (file->fd >= 0) close(file->fd);
+    memset(file, 0, sizeof(*file));
+    file->fd = -1;
+}
+
+// Whether block index can hold rows inside the filter's time and bounds
+bool ping_file_block_matches(const PingFile* file, size_t index, const PingFilter* filter) {
+    const PingBlockHeader* block = &file->blocks[index];
+    return block->rows > 0 &&
+           block->max_time >= filter->min_time && block->min_time <= filter->max_time &&
+           block->max_latitude >= filter->min_latitude && block->min_latitude <= filter->max_latitude &&
+           block->max_longitude >= filter->min_longitude && block->min_longitude <= filter->max_longitude;
+}
+
+void ping_file_block(const PingFile* file, size_t index, PingBlock* block) {
+    const PingBlockHeader* header = &file->blocks[index];
+    const uint8_t* p = file->data + header->offset;
+    size_t rows = header->rows;
+    block->rows = rows;
+    block->device = (const uint32_t*)p;
+    block->epoch = (const int32_t*)(p + rows * 4);
+    block->latitude = (const int32_t*)(p + rows * 8);
+    block->longitude = (const int32_t*)(p + rows * 12);
+    block->speed = (const int16_t*)(p + rows * 16);
+}
+
+// Device id text for a dictionary index (not NUL-terminated), or NULL if
+// the index is out of range
+const char* ping_file_device(const PingFile* file, uint32_t device, size_t* length) {
+    if (device >= file->device_count) return NULL;
+    *length = (size_t)(file->device_offsets[device + 1] - file->device_offsets[device]);
+    return file->device_bytes + file->device_offsets[device];
+}
+
+static bool write_all(PingWriter* writer, const void* buffer, size_t length) {
+    const char* p = buffer;
+    while (length > 0 && !writer->failed) {
+        ssize_t written = write(writer->fd, p, length);
+        if (written <= 0) {
+            writer->failed = true;
+            break;
+        }
+        p += written;
+        length -= (size_t)written;
+        writer->offset += (uint64_t)written;
+    }
+    return !writer->failed;
+}
+
+static bool write_padding(PingWriter* writer) {
+    static const char zeros[8] = {0};
+    return write_all(writer, zeros, (size_t)(ALIGN8(writer->offset) - writer->offset));
+}
+
+// FNV-1a; the dictionary only needs a cheap, decent spread
+static uint64_t hash_bytes(const char* p, size_t length) {
+    uint64_t hash = 14695981039346656037ULL;
+    for (size_t i = 0; i < length; i++) {
+        hash = (hash ^ (uint8_t)p[i]) * 1099511628211ULL;
+    }
+    return hash;
+}
+
+static bool grow_slots(PingWriter* writer) {
+    size_t capacity = writer->slot_capacity * 2;
+    uint32_t* slots = calloc(capacity, sizeof(uint32_t));
+    if (!slots) return false;
+    for (size_t d = 0; d < writer->device_count; d++) {
+        const char* id = writer->device_bytes + writer->device_offsets[d];
+        size_t length = (size_t)(writer->device_offsets[d + 1] - writer->device_offsets[d]);
+        size_t i = hash_bytes(id, length) & (capacity - 1);
+        while (slots[i]) i = (i + 1) & (capacity - 1);
+        slots[i] = (uint32_t)d + 1;
+    }
+    free(writer->slots);
+    writer->slots = slots;
+    writer->slot_capacity = capacity;
+    return true;
+}
+
+// Dictionary index of a device id, adding it on first sight
+static bool intern_device(PingWriter* writer, const char* id, size_t length, uint32_t* index) {
+    size_t mask = writer->slot_capacity - 1;
+    size_t i = hash_bytes(id, length) & mask;
+    for (; writer->slots[i]; i = (i + 1) & mask) {
+        uint32_t d = writer->slots[i] - 1;
+        if (writer->device_offsets[d + 1] - writer->device_offsets[d] == length &&
+            memcmp(writer->device_bytes + writer->device_offsets[d], id, length) == 0) {
+            *index = d;
+            return true;
+        }
+    }
+    if (writer->device_count >= UINT32_MAX - 1) return false;
+
+    if (writer->bytes_used + length > writer->bytes_capacity) {
+        size_t capacity = writer->bytes_capacity * 2;
+        while (writer->bytes_used + length > capacity) capacity *= 2;
+        char* bytes = realloc(writer->device_bytes, capacity);
+        if (!bytes) return false;
+        writer->device_bytes = bytes;
+        writer->bytes_capacity = capacity;
+    }
+    if (writer->device_count + 2 > writer->device_capacity) {
+        size_t capacity = writer->device_capacity * 2;
+        uint64_t* offsets = realloc(writer->device_offsets, capacity * sizeof(uint64_t));
+        if (!offsets) return false;
+        writer->device_offsets = offsets;
+        writer->device_capacity = capacity;
+    }
+
+    memcpy(writer->device_bytes + writer->bytes_used, id, length);
+    writer->bytes_used += length;
+    *index = (uint32_t)writer->device_count++;
+    writer->device_offsets[writer->device_count] = writer->bytes_used;
+    writer->slots[i] = *index + 1;
+
+    // Keep the table at most half full
+    if (writer->device_count * 2 > writer->slot_capacity) return grow_slots(writer);
+    return true;
+}
+
+// Write the block being filled and record its header
+static bool flush_block(PingWriter* writer) {
+    if (writer->rows == 0) return true;
+    if (writer->block_count == writer->block_capacity) {
+        size_t capacity = writer->block_capacity ? writer->block_capacity * 2 : 64;
+        PingBlockHeader* blocks = realloc(writer->blocks, capacity * sizeof(PingBlockHeader));
+        if (!blocks) {
+            writer->failed = true;
+            return false;
+        }
+        writer->blocks = blocks;
+        writer->block_capacity = capacity;
+    }
+
+    size_t rows = writer->rows;
+    PingBlockHeader* header = &writer->blocks[writer->block_count++];
+    memset(header, 0, sizeof(*header));
+    header->offset = writer->offset;
+    header->rows = (uint32_t)rows;
+    header->min_time = header->max_time = writer->epoch[0];
+    header->min_latitude = header->max_latitude = writer->latitude[0];
+    header->min_longitude = header->max_longitude = writer->longitude[0];
+    for (size_t i = 1; i < rows; i++) {
+        if (writer->epoch[i] < header->min_time) header->min_time = writer->epoch[i];
+        if (writer->epoch[i] > header->max_time) header->max_time = writer->epoch[i];
+        if (writer->latitude[i] < header->min_latitude) header->min_latitude = writer->latitude[i];
+        if (writer->latitude[i] > header->max_latitude) header->max_latitude = writer->latitude[i];
+        if (writer->longitude[i] < header->min_longitude) header->min_longitude = writer->longitude[i];
+        if (writer->longitude[i] > header->max_longitude) header->max_longitude = writer->longitude[i];
+    }
+
+    write_all(writer, writer->device, rows * sizeof(uint32_t));
+    write_all(writer, writer->epoch, rows * sizeof(int32_t));
+    write_all(writer, writer->latitude, rows * sizeof(int32_t));
+    write_all(writer, writer->longitude, rows * sizeof(int32_t));
+    write_all(writer, writer->speed, rows * sizeof(int16_t));
+    write_padding(writer);
+    writer->rows = 0;
+    return !writer->failed;
+}
+
+static void free_writer(PingWriter* writer) {
+    free(writer->device);
+    free(writer->epoch);
+    free(writer->latitude);
+    free(writer->longitude);
+    free(writer->speed);
+    free(writer->blocks);
+    free(writer->slots);
+    free(writer->device_offsets);
+    free(writer->device_bytes);
+}
+
+// Create (or truncate) a ping file and reserve room for its header
+bool ping_writer_open(PingWriter* writer, const char* path) {
+    memset(writer, 0, sizeof(*writer));
+    writer->device = malloc(PING_BLOCK_ROWS * sizeof(uint32_t));
+    writer->epoch = malloc(PING_BLOCK_ROWS * sizeof(int32_t));
+    writer->latitude = malloc(PING_BLOCK_ROWS * sizeof(int32_t));
+    writer->longitude = malloc(PING_BLOCK_ROWS * sizeof(int32_t));
+    writer->speed = malloc(PING_BLOCK_ROWS * sizeof(int16_t));
+    writer->slot_capacity = INITIAL_DICTIONARY_SLOTS;
+    writer->slots = calloc(writer->slot_capacity, sizeof(uint32_t));
+    writer->device_capacity = INITIAL_DICTIONARY_SLOTS;
+    writer->device_offsets = calloc(writer->device_capacity, sizeof(uint64_t));
+    writer->bytes_capacity = 1 << 20;
+    writer->device_bytes = malloc(writer->bytes_capacity);
+    if (!writer->device || !writer->epoch || !writer->latitude || !writer->longitude || !writer->speed ||
+        !writer->slots || !writer->device_offsets || !writer->device_bytes) {
+        free_writer(writer);
+        return false;
+    }
+
+    writer->fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (writer->fd < 0) {
+        free_writer(writer);
+        return false;
+    }
+    PingFileHeader header = {0};
+    if (!write_all(writer, &header, sizeof(header))) {
+        close(writer->fd);
+        free_writer(writer);
+        return false;
+    }
+    return true;
+}
+
+// Append one ping. Epochs outside the int32 range are rejected.
+bool ping_writer_add(PingWriter* writer, const char* device, size_t length, int64_t epoch,
+                     int32_t latitude, int32_t longitude, int16_t speed) {
+    if (writer->failed || epoch < INT32_MIN || epoch > INT32_MAX) return false;
+    uint32_t index;
+    if (!intern_device(writer, device, length, &index)) {
+        writer->failed = true;
+        return false;
+    }
+    size_t i = writer->rows++;
+    writer->device[i] = index;
+    writer->epoch[i] = (int32_t)epoch;
+    writer->latitude[i] = latitude;
+    writer->longitude[i] = longitude;
+    writer->speed[i] = speed;
+    writer->row_count++;
+    return writer->rows < PING_BLOCK_ROWS || flush_block(writer);
+}
+
+// Write the last block, the block index and the dictionary, then fill in
+// the header. Returns false if any write failed along the way.
+bool ping_writer_close(PingWriter* writer) {
+    flush_block(writer);
+
+    PingFileHeader header = {0};
+    memcpy(header.magic, PING_FILE_MAGIC, sizeof(header.magic));
+    header.version = PING_FILE_VERSION;
+    header.block_rows = PING_BLOCK_ROWS;
+    header.row_count = writer->row_count;
+    header.block_count = writer->block_count;
+    header.block_index_offset = writer->offset;
+    write_all(writer, writer->blocks, writer->block_count * sizeof(PingBlockHeader));
+    header.device_count = writer->device_count;
+    header.dictionary_offset = writer->offset;
+    write_all(writer, writer->device_offsets, (writer->device_count + 1) * sizeof(uint64_t));
+    write_all(writer, writer->device_bytes, writer->bytes_used);
+
+    bool ok = !writer->failed && pwrite(writer->fd, &header, sizeof(header), 0) == (ssize_t)sizeof(header);
+    ok = close(writer->fd) == 0 && ok;
+    free_writer(writer);
+    return ok;
+}
@@ -0,0 +1,120 @@
+#ifndef PING_FILE_H
+#define PING_FILE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+// Columnar binary ping file, written once by ping_convert and mmap'd by the
+// tools. Layout (little-endian, every section 8-byte aligned):
+//   PingFileHeader
+//   blocks: uint32 device[rows], int32 epoch[rows], int32 latitude[rows],
+//           int32 longitude[rows], int16 speed[rows]
+//   PingBlockHeader[block_count]
+//   device dictionary: uint64 offsets[device_count + 1], then the id bytes
+#define PING_FILE_MAGIC "SHDPING1"
+#define PING_FILE_VERSION 1
+#define PING_BLOCK_ROWS 65536       // Rows per block (the last one may hold fewer)
+
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t block_rows;        // Maximum rows per block
+    uint64_t row_count;
+    uint64_t block_count;
+    uint64_t block_index_offset;
+    uint64_t device_count;
+    uint64_t dictionary_offset;
+} PingFileHeader;
+
+// Summary of one block, enough to skip it without touching its columns
+typedef struct {
+    uint64_t offset;            // First byte of the block's columns
+    uint32_t rows;
+    int32_t min_time;           // Epoch seconds
+    int32_t max_time;
+    int32_t min_latitude;       // Microdegrees
+    int32_t max_latitude;
+    int32_t min_longitude;
+    int32_t max_longitude;
+    uint32_t reserved;
+} PingBlockHeader;
+
+// Columns of one block, pointing into the mapping
+typedef struct {
+    size_t rows;
+    const uint32_t* device;     // Index into the device dictionary
+    const int32_t* epoch;       // Epoch seconds
+    const int32_t* latitude;    // Microdegrees
+    const int32_t* longitude;   // Microdegrees
+    const int16_t* speed;       // cm/s; 0 when the source had none
+} PingBlock;
+
+// Inclusive ranges a block must overlap to be read. Blocks are skipped as a
+// whole; rows inside a matching block still need their own checks.
+typedef struct {
+    int32_t min_time;
+    int32_t max_time;
+    int32_t min_latitude;
+    int32_t max_latitude;
+    int32_t min_longitude;
+    int32_t max_longitude;
+} PingFilter;
+
+// Read-only view of a mapped ping file
+typedef struct {
+    int fd;
+    const uint8_t* data;
+    size_t size;
+    const PingFileHeader* header;
+    const PingBlockHeader* blocks;
+    size_t block_count;
+    const uint64_t* device_offsets;
+    const char* device_bytes;
+    size_t device_count;
+} PingFile;
+
+// Builds a ping file: rows are buffered into blocks in input order, and the
+// block index and device dictionary are written on close
+typedef struct {
+    int fd;
+    uint64_t offset;            // Bytes written so far
+    uint64_t row_count;
+    bool failed;
+    // Rows of the block being filled
+    uint32_t* device;
+    int32_t* epoch;
+    int32_t* latitude;
+    int32_t* longitude;
+    int16_t* speed;
+    size_t rows;
+    PingBlockHeader* blocks;
+    size_t block_count;
+    size_t block_capacity;
+    // Device dictionary: open-addressing table of device index + 1
+    uint32_t* slots;
+    size_t slot_capacity;
+    uint64_t* device_offsets;
+    size_t device_count;
+    size_t device_capacity;
+    char* device_bytes;
+    size_t bytes_used;
+    size_t bytes_capacity;
+} PingWriter;
+
+// Function prototypes
+bool ping_is_file_name(const char* path);
+void ping_filter_all(PingFilter* filter);
+
+bool ping_file_open(PingFile* file, const char* path);
+void ping_file_close(PingFile* file);
+bool ping_file_block_matches(const PingFile* file, size_t index, const PingFilter* filter);
+void ping_file_block(const PingFile* file, size_t index, PingBlock* block);
+const char* ping_file_device(const PingFile* file, uint32_t device, size_t* length);
+
+bool ping_writer_open(PingWriter* writer, const char* path);
+bool ping_writer_add(PingWriter* writer, const char* device, size_t length, int64_t epoch,
+                     int32_t latitude, int32_t longitude, int16_t speed);
+bool ping_writer_close(PingWriter* writer);
+
+#endif // PING_FILE_H
@@ -0,0 +1,370 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <math.h>
+#include <time.h>
+#include <unistd.h>
+#include <errno.h>
+#include <sys/stat.h>
+#include "fixed_point.h"
+
+// Synthetic ping CSVs for benchmarks, in the column layout process_csv_file
+// reads (advertiser id, local time, latitude, longitude and speed at
+// columns 0, 3, 4, 5 and 10). Device activity is Pareto distributed, so a
+// few devices send most pings; each device moves around a home location
+// inside the LA box the tools filter on.
+static const char* const CSV_HEADER =
+    "advertiser_id,platform,location_at,local_location_at,latitude,longitude,"
+    "altitude,horizontal_accuracy,vertical_accuracy,heading,speed\n";
+
+// LA box, as in mobile_map_filter
+#define LAT_MIN MICRODEGREES(33.4)
+#define LAT_MAX MICRODEGREES(34.3)
+#define LON_MIN MICRODEGREES(-118.6)
+#define LON_MAX MICRODEGREES(-117.6)
+
+#define DAY_SECONDS 86400
+#define UTC_OFFSET_SECONDS (7 * 3600)   // local_location_at is PDT
+#define MICRODEGREES_PER_METER_LAT 8.983
+#define MICRODEGREES_PER_METER_LON 10.836  // At ~34 degrees north
+#define HOME_SPREAD_METERS 8000.0
+#define MAX_STEP_METERS 5000.0
+#define UUID_ID_SHARE 0.7               // The rest are 64-hex hashed ids
+#define EMPTY_SPEED_SHARE 0.05
+#define OUTPUT_BUFFER_BYTES (1u << 20)
+#define ROW_MAX 256
+
+// Population centers homes cluster around; a share of homes is uniform
+static const double HOME_CENTERS[][2] = {
+    { 34.05, -118.25 },             // Downtown
+    { 34.02, -118.49 },             // Santa Monica
+    { 33.77, -118.19 },             // Long Beach
+    { 34.15, -118.14 },             // Pasadena
+    { 33.84, -117.91 },             // Anaheim
+    { 34.19, -118.45 },             // Van Nuys
+};
+#define HOME_CENTER_COUNT (sizeof(HOME_CENTERS) / sizeof(HOME_CENTERS[0]))
+#define UNIFORM_HOME_SHARE 0.3
+
+typedef struct {
+    char id[65];
+    uint8_t id_length;
+    bool ios;
+    int32_t home_latitude;
+    int32_t home_longitude;
+    int32_t latitude;
+    int32_t longitude;
+    double time;                    // Seconds into the day of the last ping
+    double mean_gap;                // Seconds between pings at this device's rate
+} Device;
+
+// Walker alias table: device sampling in O(1) per row
+typedef struct {
+    float* probability;
+    uint32_t* alias;
+    size_t count;
+} AliasTable;
+
+static uint64_t rng_state;
+
+// splitmix64
+static uint64_t next_random(void) {
+    uint64_t z = (rng_state += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+// Uniform in [0, 1)
+static double next_uniform(void) {
+    return (next_random() >> 11) * 0x1.0p-53;
+}
+
+static double next_gaussian(void) {
+    double u = 1.0 - next_uniform();
+    return sqrt(-2.0 * log(u)) * cos(2.0 * M_PI * next_uniform());
+}
+
+static double next_exponential(double mean) {
+    return -mean * log(1.0 - next_uniform());
+}
+
+static int32_t clamp(int32_t value, int32_t low, int32_t high) {
+    return value < low ? low : value > high ? high : value;
+}
+
+static void random_hex(char* out, size_t digits) {
+    static const char HEX[] = "0123456789abcdef";
+    uint64_t bits = 0;
+    for (size_t i = 0; i < digits; i++) {
+        if (i % 16 == 0) bits = next_random();
+        out[i] = HEX[bits & 15];
+        bits >>= 4;
+    }
+}
+
+// Build the alias table for weights (normalized in place)
+static bool alias_build(AliasTable* table, double* weights, size_t count) {
+    table->probability = malloc(count * sizeof(float));
+    table->alias = malloc(count * sizeof(uint32_t));
+    uint32_t* small = malloc(count * sizeof(uint32_t));
+    uint32_t* large = malloc(count * sizeof(uint32_t));
+    table->count = count;
+    if (!table->probability || !table->alias || !small || !large) {
+        free(small);
+        free(large);
+        return false;
+    }
+
+    double total = 0;
+    for (size_t i = 0; i < count; i++) total += weights[i];
+    size_t small_count = 0, large_count = 0;
+    for (size_t i = 0; i < count; i++) {
+        weights[i] = weights[i] * count / total;
+        if (weights[i] < 1.0) small[small_count++] = (uint32_t)i; else large[large_count++] = (uint32_t)i;
+    }
+    while (small_count > 0 && large_count > 0) {
+        uint32_t s = small[--small_count];
+        uint32_t l = large[large_count - 1];
+        table->probability[s] = (float)weights[s];
+        table->alias[s] = l;
+        weights[l] -= 1.0 - weights[s];
+        if (weights[l] < 1.0) {
+            large_count--;
+            small[small_count++] = l;
+        }
+    }
+    while (large_count > 0) table->probability[large[--large_count]] = 1.0f;
+    while (small_count > 0) table->probability[small[--small_count]] = 1.0f;
+
+    free(small);
+    free(large);
+    return true;
+}
+
+static size_t alias_sample(const AliasTable* table) {
+    size_t i = next_random() % table->count;
+    return next_uniform() < table->probability[i] ? i : table->alias[i];
+}
+
+// Pick devices: ids, homes, and a Pareto(alpha) activity weight each.
+// A device's mean gap spreads its expected share of rows over the day.
+static bool create_devices(Device* devices, size_t count, double alpha, size_t rows, AliasTable* table) {
+    double* weights = malloc(count * sizeof(double));
+    if (!weights) return false;
+    double total = 0;
+    for (size_t i = 0; i < count; i++) {
+        weights[i] = pow(1.0 - next_uniform(), -1.0 / alpha);
+        total += weights[i];
+
+        Device* device = &devices[i];
+        if (next_uniform() < UUID_ID_SHARE) {
+            char hex[32];
+            random_hex(hex, sizeof(hex));
+            snprintf(device->id, sizeof(device->id), "%.8s-%.4s-%.4s-%.4s-%.12s",
+                     hex, hex + 8, hex + 12, hex + 16, hex + 20);
+            device->id_length = 36;
+        } else {
+            random_hex(device->id, 64);
+            device->id_length = 64;
+        }
+        device->ios = next_uniform() < 0.5;
+
+        double latitude, longitude;
+        if (next_uniform() < UNIFORM_HOME_SHARE) {
+            latitude = LAT_MIN + next_uniform() * (LAT_MAX - LAT_MIN);
+            longitude = LON_MIN + next_uniform() * (LON_MAX - LON_MIN);
+        } else {
+            const double* center = HOME_CENTERS[next_random() % HOME_CENTER_COUNT];
+            latitude = MICRODEGREES(center[0]) + next_gaussian() * HOME_SPREAD_METERS * MICRODEGREES_PER_METER_LAT;
+            longitude = MICRODEGREES(center[1]) + next_gaussian() * HOME_SPREAD_METERS * MICRODEGREES_PER_METER_LON;
+        }
+        device->home_latitude = device->latitude = clamp((int32_t)latitude, LAT_MIN, LAT_MAX);
+        device->home_longitude = device->longitude = clamp((int32_t)longitude, LON_MIN, LON_MAX);
+        device->time = next_uniform() * DAY_SECONDS;
+    }
+    for (size_t i = 0; i < count; i++) {
+        double expected = weights[i] / total * rows;
+        devices[i].mean_gap = DAY_SECONDS / (expected > 1.0 ? expected : 1.0);
+    }
+
+    bool ok = alias_build(table, weights, count);
+    free(weights);
+    return ok;
+}
+
+// Advance a device to its next ping: mostly dwelling near where it was,
+// sometimes travelling (walking or driving, some fast enough for
+// location_processor to drop), sometimes back home. Returns the speed in
+// cm/s. Times past midnight wrap to the morning, so a device's pings are
+// not always in order.
+static int32_t advance_device(Device* device) {
+    double gap = next_exponential(device->mean_gap);
+    device->time += gap;
+    if (device->time >= DAY_SECONDS) device->time = fmod(device->time, DAY_SECONDS);
+
+    double choice = next_uniform();
+    double meters_per_second = 0;
+    if (choice < 0.05) {
+        device->latitude = device->home_latitude;
+        device->longitude = device->home_longitude;
+    } else if (choice < 0.3) {
+        meters_per_second = choice < 0.2 ? 0.5 + next_uniform() * 2.0 : 5.0 + next_uniform() * 25.0;
+        double meters = fmin(meters_per_second * gap, MAX_STEP_METERS);
+        double heading = next_uniform() * 2.0 * M_PI;
+        device->latitude = clamp(device->latitude + (int32_t)(meters * cos(heading) * MICRODEGREES_PER_METER_LAT),
+                                 LAT_MIN, LAT_MAX);
+        device->longitude = clamp(device->longitude + (int32_t)(meters * sin(heading) * MICRODEGREES_PER_METER_LON),
+                                  LON_MIN, LON_MAX);
+    } else {
+        meters_per_second = next_uniform() * 0.5;
+        device->latitude = clamp(device->latitude + (int32_t)(next_gaussian() * 20.0 * MICRODEGREES_PER_METER_LAT),
+                                 LAT_MIN, LAT_MAX);
+        device->longitude = clamp(device->longitude + (int32_t)(next_gaussian() * 20.0 * MICRODEGREES_PER_METER_LON),
+                                  LON_MIN, LON_MAX);
+    }
+    return (int32_t)(meters_per_second * 100.0);
+}
+
+// Write value as exactly digits decimal digits, zero padded
+static char* write_digits(char* p, int value, int digits) {
+    for (int i = digits - 1; i >= 0; i--) {
+        p[i] = (char)('0' + value % 10);
+        value /= 10;
+    }
+    return p + digits;
+}
+
+// Format one row into out (at least ROW_MAX bytes); returns its length
+static size_t format_row(char* out, const Device* device, const char* date, int64_t day_epoch, int32_t speed) {
+    int millis = (int)(device->time * 1000.0) % (DAY_SECONDS * 1000);
+    int seconds = millis / 1000;
+    char* p = out;
+    memcpy(p, device->id, device->id_length);
+    p += device->id_length;
+    memcpy(p, device->ios ? ",IDFA," : ",AAID,", 6);
+    p += 6;
+    p += fixed_write(p, (day_epoch + UTC_OFFSET_SECONDS) * 1000 + millis, 0);
+    *p++ = ',';
+    memcpy(p, date, 10);
+    p += 10;
+    *p++ = ' ';
+    p = write_digits(p, seconds / 3600, 2);
+    *p++ = ':';
+    p = write_digits(p, seconds / 60 % 60, 2);
+    *p++ = ':';
+    p = write_digits(p, seconds % 60, 2);
+    *p++ = '.';
+    p = write_digits(p, millis % 1000, 3);
+    *p++ = ',';
+    p += fixed_write(p, device->latitude, MICRODEGREE_DECIMALS);
+    *p++ = ',';
+    p += fixed_write(p, device->longitude, MICRODEGREE_DECIMALS);
+    memcpy(p, ",100.0,5.0,3.0,", 15);
+    p += 15;
+    p += fixed_write(p, (int64_t)(next_uniform() * 360000), 3);
+    *p++ = ',';
+    if (next_uniform() >= EMPTY_SPEED_SHARE) {
+        p += fixed_write(p, speed, SPEED_DECIMALS);
+    }
+    *p++ = '\n';
+    return (size_t)(p - out);
+}
+
+static void usage(const char* program) {
+    fprintf(stderr, "Usage: %s [-n rows] [-p pings_per_device | -d devices] [-a alpha] [-f rows_per_file] "
+            "[-s seed] [-D yyyy-mm-dd] <output directory>\n", program);
+}
+
+int main(int argc, char* argv[]) {
+    size_t rows = 1000000;
+    size_t pings_per_device = 100;
+    size_t device_count = 0;
+    size_t rows_per_file = 1000000;
+    double alpha = 1.2;
+    uint64_t seed = 1;
+    const char* date = "2024-07-23";
+    int opt;
+    while ((opt = getopt(argc, argv, "n:p:d:a:f:s:D:")) != -1) {
+        switch (opt) {
+            case 'n': rows = strtoull(optarg, NULL, 10); break;
+            case 'p': pings_per_device = strtoull(optarg, NULL, 10); break;
+            case 'd': device_count = strtoull(optarg, NULL, 10); break;
+            case 'a': alpha = strtod(optarg, NULL); break;
+            case 'f': rows_per_file = strtoull(optarg, NULL, 10); break;
+            case 's': seed = strtoull(optarg, NULL, 10); break;
+            case 'D': date = optarg; break;
+            default:
+                usage(argv[0]);
+                return 1;
+        }
+    }
+    struct tm day = {0};
+    if (argc - optind != 1 || strlen(date) != 10 ||
+        sscanf(date, "%4d-%2d-%2d", &day.tm_year, &day.tm_mon, &day.tm_mday) != 3 || alpha <= 0) {
+        usage(argv[0]);
+        return 1;
+    }
+    day.tm_year -= 1900;
+    day.tm_mon -= 1;
+    int64_t day_epoch = (int64_t)timegm(&day);
+    const char* output_dir = argv[optind];
+    if (mkdir(output_dir, 0755) != 0 && errno != EEXIST) {
+        perror(output_dir);
+        return 1;
+    }
+
+    if (device_count == 0) device_count = rows / (pings_per_device ? pings_per_device : 1);
+    if (device_count == 0) device_count = 1;
+    if (rows_per_file == 0) rows_per_file = rows;
+    rng_state = seed;
+
+    Device* devices = calloc(device_count, sizeof(Device));
+    AliasTable table = {0};
+    char* buffer = malloc(OUTPUT_BUFFER_BYTES);
+    bool ok = devices && buffer && create_devices(devices, device_count, alpha, rows, &table);
+
+    size_t written = 0, files = 0;
+    uint64_t bytes = 0;
+    while (ok && written < rows) {
+        char path[4096];
+        snprintf(path, sizeof(path), "%s/part-%05zu.csv", output_dir, files++);
+        FILE* f = fopen(path, "w");
+        if (!f) {
+            perror(path);
+            ok = false;
+            break;
+        }
+        size_t used = strlen(CSV_HEADER);
+        memcpy(buffer, CSV_HEADER, used);
+        size_t file_rows = rows - written < rows_per_file ? rows - written : rows_per_file;
+        for (size_t i = 0; i < file_rows; i++) {
+            if (used + ROW_MAX > OUTPUT_BUFFER_BYTES) {
+                ok = ok && fwrite(buffer, 1, used, f) == used;
+                bytes += used;
+                used = 0;
+            }
+            Device* device = &devices[alias_sample(&table)];
+            int32_t speed = advance_device(device);
+            used += format_row(buffer + used, device, date, day_epoch, speed);
+        }
+        ok = ok && fwrite(buffer, 1, used, f) == used;
+        bytes += used;
+        ok = (fclose(f) == 0) && ok;
+        written += file_rows;
+    }
+
+    if (ok) {
+        fprintf(stderr, "Wrote %zu rows for %zu devices (alpha %.2f) to %zu files in %s, %llu bytes\n",
+                written, device_count, alpha, files, output_dir, (unsigned long long)bytes);
+    } else {
+        fprintf(stderr, "Error generating pings in %s\n", output_dir);
+    }
+    free(table.probability);
+    free(table.alias);
+    free(buffer);
+    free(devices);
+    return ok ? 0 : 1;
+}
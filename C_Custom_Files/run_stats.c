@@ -0,0 +1,117 @@
+#include "run_stats.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <pthread.h>
+#include <sys/resource.h>
+
+static const char* const STAGE_NAMES[STAGE_COUNT] = {
+    "read", "parse", "insert", "sort", "segment", "write"
+};
+
+__thread RunCounters* run_thread_counters;
+
+static pthread_mutex_t stats_lock = PTHREAD_MUTEX_INITIALIZER;
+static RunCounters* all_counters;       // Every thread's set, newest first
+static RunCounters fallback_counters;   // Shared if a thread's set cannot be allocated
+static size_t thread_count;
+static size_t peak_map_entries;
+static uint64_t map_resizes;
+static uint64_t start_ns;
+
+// Log one line to stderr, whole even when workers log concurrently
+void log_write(const char* format, ...) {
+    va_list args;
+    va_start(args, format);
+    flockfile(stderr);
+    vfprintf(stderr, format, args);
+    fputc('\n', stderr);
+    funlockfile(stderr);
+    va_end(args);
+}
+
+// Give the calling thread its own counters; they outlive the thread so the
+// report still sees pool workers that have exited
+RunCounters* run_counters_attach(void) {
+    RunCounters* counters = calloc(1, sizeof(RunCounters));
+    pthread_mutex_lock(&stats_lock);
+    if (counters) {
+        counters->next = all_counters;
+        all_counters = counters;
+        thread_count++;
+    } else {
+        counters = &fallback_counters;
+    }
+    pthread_mutex_unlock(&stats_lock);
+    run_thread_counters = counters;
+    return counters;
+}
+
+void run_stats_start(void) {
+    start_ns = run_clock_ns();
+}
+
+// Record a map about to be dropped or merged: its size counts toward the
+// peak, its resizes toward the total
+void run_stats_map(size_t entries, size_t resizes) {
+    pthread_mutex_lock(&stats_lock);
+    if (entries > peak_map_entries) peak_map_entries = entries;
+    map_resizes += resizes;
+    pthread_mutex_unlock(&stats_lock);
+}
+
+// Peak resident set size of the process so far, in bytes
+size_t run_peak_rss_bytes(void) {
+    struct rusage usage;
+    return getrusage(RUSAGE_SELF, &usage) == 0 ? (size_t)usage.ru_maxrss << 10 : 0;
+}
+
+static double per_second(uint64_t count, double seconds) {
+    return seconds > 0 ? count / seconds : 0.0;
+}
+
+// Write the run summary as JSON. Stage times are summed over threads, so
+// with several workers they can add up to more than the wall time.
+bool run_stats_write_report(const char* path, const char* program) {
+    double wall = (run_clock_ns() - start_ns) * 1e-9;
+    RunCounters total = {0};
+
+    pthread_mutex_lock(&stats_lock);
+    for (const RunCounters* c = all_counters; c; c = c->next) {
+        for (int s = 0; s < STAGE_COUNT; s++) total.stage_ns[s] += c->stage_ns[s];
+        total.rows += c->rows;
+        total.pings += c->pings;
+        total.bytes += c->bytes;
+        total.devices += c->devices;
+        total.paths += c->paths;
+        total.points += c->points;
+    }
+    size_t threads = thread_count;
+    size_t peak_entries = peak_map_entries;
+    uint64_t resizes = map_resizes;
+    pthread_mutex_unlock(&stats_lock);
+
+    FILE* f = fopen(path, "w");
+    if (!f) return false;
+    fprintf(f, "{\n");
+    fprintf(f, "  \"program\": \"%s\",\n", program);
+    fprintf(f, "  \"wall_seconds\": %.6f,\n", wall);
+    fprintf(f, "  \"threads\": %zu,\n", threads);
+    fprintf(f, "  \"rows\": %llu,\n", (unsigned long long)total.rows);
+    fprintf(f, "  \"pings\": %llu,\n", (unsigned long long)total.pings);
+    fprintf(f, "  \"bytes\": %llu,\n", (unsigned long long)total.bytes);
+    fprintf(f, "  \"rows_per_second\": %.1f,\n", per_second(total.rows, wall));
+    fprintf(f, "  \"bytes_per_second\": %.1f,\n", per_second(total.bytes, wall));
+    fprintf(f, "  \"devices\": %llu,\n", (unsigned long long)total.devices);
+    fprintf(f, "  \"paths\": %llu,\n", (unsigned long long)total.paths);
+    fprintf(f, "  \"path_points\": %llu,\n", (unsigned long long)total.points);
+    fprintf(f, "  \"peak_map_entries\": %zu,\n", peak_entries);
+    fprintf(f, "  \"map_resizes\": %llu,\n", (unsigned long long)resizes);
+    fprintf(f, "  \"peak_rss_bytes\": %zu,\n", run_peak_rss_bytes());
+    fprintf(f, "  \"stage_seconds\": {");
+    for (int s = 0; s < STAGE_COUNT; s++) {
+        fprintf(f, "%s\n    \"%s\": %.6f", s ? "," : "", STAGE_NAMES[s], total.stage_ns[s] * 1e-9);
+    }
+    fprintf(f, "\n  }\n}\n");
+    return fclose(f) == 0;
+}
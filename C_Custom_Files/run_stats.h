@@ -0,0 +1,78 @@
+#ifndef RUN_STATS_H
+#define RUN_STATS_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <time.h>
+
+// Log levels. Calls above LOG_LEVEL are dead code the compiler drops, so
+// per-path tracing costs nothing unless built with -DLOG_LEVEL=LOG_TRACE.
+#define LOG_ERROR 0
+#define LOG_INFO 1
+#define LOG_DEBUG 2
+#define LOG_TRACE 3
+#ifndef LOG_LEVEL
+#define LOG_LEVEL LOG_DEBUG
+#endif
+
+#define LOG_AT(level, ...) do { if ((level) <= LOG_LEVEL) log_write(__VA_ARGS__); } while (0)
+#define log_error(...) LOG_AT(LOG_ERROR, __VA_ARGS__)
+#define log_info(...) LOG_AT(LOG_INFO, __VA_ARGS__)
+#define log_debug(...) LOG_AT(LOG_DEBUG, __VA_ARGS__)
+#define log_trace(...) LOG_AT(LOG_TRACE, __VA_ARGS__)
+
+// Pipeline stages timed by the run report
+typedef enum {
+    STAGE_READ,                 // Opening inputs, reading and decompressing blocks
+    STAGE_PARSE,                // Decoding rows into pings
+    STAGE_INSERT,               // Appending pings to maps or spill runs
+    STAGE_SORT,                 // Per-device timestamp sort
+    STAGE_SEGMENT,              // Cutting sorted pings into paths
+    STAGE_WRITE,                // Handing paths to the output and finishing it
+    STAGE_COUNT
+} RunStage;
+
+// Counters of one thread. Each thread bumps its own without locking; the
+// report sums every thread's set.
+typedef struct RunCounters {
+    struct RunCounters* next;
+    uint64_t stage_ns[STAGE_COUNT];
+    uint64_t rows;              // Input rows read
+    uint64_t pings;             // Rows kept
+    uint64_t bytes;             // Input bytes
+    uint64_t devices;
+    uint64_t paths;
+    uint64_t points;            // Points across all paths
+    uint64_t ticks;             // Call counter for sampled timers
+} RunCounters;
+
+extern __thread RunCounters* run_thread_counters;
+RunCounters* run_counters_attach(void);
+
+// The calling thread's counters
+static inline RunCounters* run_counters(void) {
+    return run_thread_counters ? run_thread_counters : run_counters_attach();
+}
+
+static inline uint64_t run_clock_ns(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000u + (uint64_t)now.tv_nsec;
+}
+
+// Book the time since start_ns (from run_clock_ns) to stage; returns now
+static inline uint64_t run_stage_add(RunStage stage, uint64_t start_ns) {
+    uint64_t now = run_clock_ns();
+    run_counters()->stage_ns[stage] += now - start_ns;
+    return now;
+}
+
+// Function prototypes
+void log_write(const char* format, ...) __attribute__((format(printf, 1, 2)));
+void run_stats_start(void);
+void run_stats_map(size_t entries, size_t resizes);
+size_t run_peak_rss_bytes(void);
+bool run_stats_write_report(const char* path, const char* program);
+
+#endif // RUN_STATS_H
@@ -0,0 +1,99 @@
+#include "snappy.h"
+#include <string.h>
+
+// Element tags: the low two bits pick the kind
+#define SNAPPY_LITERAL 0
+#define SNAPPY_COPY_1 1         // 3-bit length, 11-bit offset
+#define SNAPPY_COPY_2 2         // 6-bit length, 16-bit offset
+#define SNAPPY_COPY_4 3         // 6-bit length, 32-bit offset
+
+// Little-endian base-128 varint; returns bytes consumed or 0 if malformed
+static size_t read_varint32(const uint8_t* p, const uint8_t* end, uint32_t* value) {
+    uint32_t result = 0;
+    for (size_t i = 0; i < 5 && p + i < end; i++) {
+        result |= (uint32_t)(p[i] & 0x7F) << (7 * i);
+        if (p[i] < 0x80) {
+            *value = result;
+            return i + 1;
+        }
+    }
+    return 0;
+}
+
+static inline uint32_t load_le(const uint8_t* p, size_t bytes) {
+    uint32_t value = 0;
+    for (size_t i = 0; i < bytes; i++) value |= (uint32_t)p[i] << (8 * i);
+    return value;
+}
+
+// Length of the block once decompressed, from its preamble
+bool snappy_uncompressed_length(const uint8_t* input, size_t input_length, size_t* length) {
+    uint32_t value;
+    if (read_varint32(input, input + input_length, &value) == 0) return false;
+    *length = value;
+    return true;
+}
+
+// Decompress a whole block into output, which must be exactly the
+// uncompressed length. Every length and offset is bounds-checked, so
+// corrupt input fails instead of reading or writing out of range.
+bool snappy_decompress(const uint8_t* input, size_t input_length, uint8_t* output, size_t output_length) {
+    const uint8_t* p = input;
+    const uint8_t* end = input + input_length;
+    uint32_t expected;
+    size_t used = read_varint32(p, end, &expected);
+    if (used == 0 || expected != output_length) return false;
+    p += used;
+
+    uint8_t* out = output;
+    uint8_t* out_end = output + output_length;
+    while (p < end) {
+        uint8_t tag = *p++;
+        size_t length, offset;
+        switch (tag & 3) {
+            case SNAPPY_LITERAL:
+                length = tag >> 2;
+                if (length >= 60) {
+                    // 60..63: the length-1 follows in 1..4 bytes
+                    size_t bytes = length - 59;
+                    if ((size_t)(end - p) < bytes) return false;
+                    length = load_le(p, bytes);
+                    p += bytes;
+                }
+                length++;
+                if ((size_t)(end - p) < length || (size_t)(out_end - out) < length) return false;
+                memcpy(out, p, length);
+                p += length;
+                out += length;
+                continue;
+            case SNAPPY_COPY_1:
+                if (p >= end) return false;
+                length = 4 + ((tag >> 2) & 7);
+                offset = ((size_t)(tag >> 5) << 8) | *p++;
+                break;
+            case SNAPPY_COPY_2:
+                if (end - p < 2) return false;
+                length = 1 + (tag >> 2);
+                offset = load_le(p, 2);
+                p += 2;
+                break;
+            default:
+                if (end - p < 4) return false;
+                length = 1 + (tag >> 2);
+                offset = load_le(p, 4);
+                p += 4;
+                break;
+        }
+
+        if (offset == 0 || offset > (size_t)(out - output) || (size_t)(out_end - out) < length) return false;
+        const uint8_t* from = out - offset;
+        if (offset >= length) {
+            memcpy(out, from, length);
+            out += length;
+        } else {
+            // Overlapping copy repeats the last `offset` bytes
+            for (size_t i = 0; i < length; i++) *out++ = from[i];
+        }
+    }
+    return out == out_end;
+}
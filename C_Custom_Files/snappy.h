@@ -0,0 +1,14 @@
+#ifndef SNAPPY_H
+#define SNAPPY_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+// Raw (unframed) Snappy blocks, as used for Parquet pages
+
+// Function prototypes
+bool snappy_uncompressed_length(const uint8_t* input, size_t input_length, size_t* length);
+bool snappy_decompress(const uint8_t* input, size_t input_length, uint8_t* output, size_t output_length);
+
+#endif // SNAPPY_H
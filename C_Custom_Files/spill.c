@@ -0,0 +1,186 @@
+#include "spill.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#define SPILL_RECORD_HEADER 4   // uint16 key length, uint16 payload size
+
+// FNV-1a of the key, folded so partitions do not follow the low bits any
+// in-memory table uses
+static uint64_t hash_key(const char* p, size_t length) {
+    uint64_t hash = 14695981039346656037ULL;
+    for (size_t i = 0; i < length; i++) {
+        hash = (hash ^ (uint8_t)p[i]) * 1099511628211ULL;
+    }
+    return hash ^ (hash >> 29);
+}
+
+static bool write_all(int fd, const char* buffer, size_t length) {
+    while (length > 0) {
+        ssize_t written = write(fd, buffer, length);
+        if (written <= 0) return false;
+        buffer += written;
+        length -= (size_t)written;
+    }
+    return true;
+}
+
+// Write a partition's buffer out; caller holds its lock
+static bool flush_partition(SpillSet* set, SpillPartition* partition) {
+    if (partition->used == 0) return true;
+    if (!write_all(partition->fd, partition->buffer, partition->used)) {
+        // Writers flushing other partitions may fail at the same time
+        __atomic_store_n(&set->failed, true, __ATOMIC_RELAXED);
+        return false;
+    }
+    partition->bytes += partition->used;
+    partition->used = 0;
+    return true;
+}
+
+// Create `partitions` unlinked run files in directory, each with a
+// buffer_size write buffer. Returns false (with nothing left behind) if
+// any file or buffer cannot be created.
+bool spill_create(SpillSet* set, const char* directory, size_t partitions, size_t buffer_size) {
+    memset(set, 0, sizeof(*set));
+    if (partitions < 1) partitions = 1;
+    size_t minimum = SPILL_RECORD_HEADER + SPILL_MAX_KEY + SPILL_MAX_PAYLOAD;
+    set->buffer_size = buffer_size < minimum ? minimum : buffer_size;
+    set->partitions = calloc(partitions, sizeof(SpillPartition));
+    if (!set->partitions) return false;
+
+    size_t path_size = strlen(directory) + 32;
+    char* path = malloc(path_size);
+    if (!path) {
+        free(set->partitions);
+        set->partitions = NULL;
+        return false;
+    }
+    for (size_t i = 0; i < partitions; i++) {
+        SpillPartition* partition = &set->partitions[i];
+        snprintf(path, path_size, "%s/spill-XXXXXX", directory);
+        partition->fd = mkstemp(path);
+        if (partition->fd >= 0) unlink(path);
+        partition->buffer = malloc(set->buffer_size);
+        pthread_mutex_init(&partition->lock, NULL);
+        set->count++;
+        if (partition->fd < 0 || !partition->buffer) {
+            free(path);
+            spill_destroy(set);
+            return false;
+        }
+    }
+    free(path);
+    return true;
+}
+
+// Append one record to its key's partition. Safe to call from several
+// threads; records from one thread keep their order.
+bool spill_add(SpillSet* set, const char* key, size_t key_length, const void* payload, size_t payload_size) {
+    if (key_length > SPILL_MAX_KEY || payload_size > SPILL_MAX_PAYLOAD) return false;
+    SpillPartition* partition = &set->partitions[hash_key(key, key_length) % set->count];
+    size_t length = SPILL_RECORD_HEADER + key_length + payload_size;
+    uint16_t sizes[2] = { (uint16_t)key_length, (uint16_t)payload_size };
+
+    pthread_mutex_lock(&partition->lock);
+    bool ok = partition->used + length <= set->buffer_size || flush_partition(set, partition);
+    if (ok) {
+        char* p = partition->buffer + partition->used;
+        memcpy(p, sizes, SPILL_RECORD_HEADER);
+        memcpy(p + SPILL_RECORD_HEADER, key, key_length);
+        memcpy(p + SPILL_RECORD_HEADER + key_length, payload, payload_size);
+        partition->used += length;
+        partition->records++;
+    }
+    pthread_mutex_unlock(&partition->lock);
+    return ok;
+}
+
+// Write out every buffer and free them; call once all records are added.
+// Returns false if any write failed.
+bool spill_finish(SpillSet* set) {
+    for (size_t i = 0; i < set->count; i++) {
+        SpillPartition* partition = &set->partitions[i];
+        flush_partition(set, partition);
+        free(partition->buffer);
+        partition->buffer = NULL;
+    }
+    return !__atomic_load_n(&set->failed, __ATOMIC_RELAXED);
+}
+
+// Drop a partition's file once it has been read, returning its disk space
+void spill_release(SpillSet* set, size_t partition) {
+    if (set->partitions[partition].fd >= 0) close(set->partitions[partition].fd);
+    set->partitions[partition].fd = -1;
+}
+
+void spill_destroy(SpillSet* set) {
+    for (size_t i = 0; i < set->count; i++) {
+        SpillPartition* partition = &set->partitions[i];
+        if (partition->fd >= 0) close(partition->fd);
+        free(partition->buffer);
+        pthread_mutex_destroy(&partition->lock);
+    }
+    free(set->partitions);
+    memset(set, 0, sizeof(*set));
+}
+
+bool spill_reader_open(SpillReader* reader, const SpillSet* set, size_t partition, size_t buffer_size) {
+    memset(reader, 0, sizeof(*reader));
+    size_t minimum = SPILL_RECORD_HEADER + SPILL_MAX_KEY + SPILL_MAX_PAYLOAD;
+    reader->size = buffer_size < minimum ? minimum : buffer_size;
+    reader->buffer = malloc(reader->size);
+    reader->fd = set->partitions[partition].fd;
+    reader->file_bytes = set->partitions[partition].bytes;
+    return reader->buffer != NULL && reader->fd >= 0;
+}
+
+// Next record in the order it was added, pointing into the reader's
+// buffer until the following call. Returns false at the end of the run
+// or on a read error (reader->failed).
+bool spill_reader_next(SpillReader* reader, const char** key, size_t* key_length,
+                       const void** payload, size_t* payload_size) {
+    for (;;) {
+        size_t available = reader->end - reader->start;
+        if (available >= SPILL_RECORD_HEADER) {
+            uint16_t sizes[2];
+            memcpy(sizes, reader->buffer + reader->start, SPILL_RECORD_HEADER);
+            size_t length = SPILL_RECORD_HEADER + sizes[0] + sizes[1];
+            if (available >= length) {
+                const char* p = reader->buffer + reader->start;
+                *key = p + SPILL_RECORD_HEADER;
+                *key_length = sizes[0];
+                *payload = p + SPILL_RECORD_HEADER + sizes[0];
+                *payload_size = sizes[1];
+                reader->start += length;
+                return true;
+            }
+        }
+        if (reader->offset >= reader->file_bytes) {
+            reader->failed = available > 0;   // Truncated record
+            return false;
+        }
+
+        // Keep the partial record and refill behind it
+        memmove(reader->buffer, reader->buffer + reader->start, available);
+        reader->start = 0;
+        reader->end = available;
+        size_t want = reader->size - available;
+        if (want > reader->file_bytes - reader->offset) want = (size_t)(reader->file_bytes - reader->offset);
+        ssize_t got = pread(reader->fd, reader->buffer + reader->end, want, (off_t)reader->offset);
+        if (got <= 0) {
+            reader->failed = true;
+            return false;
+        }
+        reader->end += (size_t)got;
+        reader->offset += (uint64_t)got;
+    }
+}
+
+void spill_reader_close(SpillReader* reader) {
+    free(reader->buffer);
+    memset(reader, 0, sizeof(*reader));
+    reader->fd = -1;
+}
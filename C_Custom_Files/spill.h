@@ -0,0 +1,58 @@
+#ifndef SPILL_H
+#define SPILL_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <pthread.h>
+
+// Hash-partitioned spill runs for inputs too big to hold in memory at once.
+// Records are (key, payload) pairs; every record with the same key bytes
+// lands in the same partition, in the order it was added, so a partition
+// can be loaded and processed on its own. Partitions are unlinked
+// temporary files, read back through a fixed-size buffer so reading a
+// partition costs no more memory than writing it did.
+#define SPILL_MAX_KEY 4096
+#define SPILL_MAX_PAYLOAD 256
+
+typedef struct {
+    pthread_mutex_t lock;       // Writers on several threads share a partition
+    int fd;
+    char* buffer;               // Records not yet written
+    size_t used;
+    uint64_t bytes;             // Written to the file so far
+    uint64_t records;
+} SpillPartition;
+
+typedef struct {
+    SpillPartition* partitions;
+    size_t count;
+    size_t buffer_size;         // Per-partition write buffer
+    bool failed;                // A write failed; the runs are incomplete (set atomically)
+} SpillSet;
+
+// Sequential reader over one partition's records
+typedef struct {
+    int fd;
+    char* buffer;
+    size_t size;
+    size_t start;               // Next unread byte in buffer
+    size_t end;                 // Bytes of buffer filled
+    uint64_t offset;            // File offset of buffer[end]
+    uint64_t file_bytes;
+    bool failed;
+} SpillReader;
+
+// Function prototypes
+bool spill_create(SpillSet* set, const char* directory, size_t partitions, size_t buffer_size);
+bool spill_add(SpillSet* set, const char* key, size_t key_length, const void* payload, size_t payload_size);
+bool spill_finish(SpillSet* set);
+void spill_release(SpillSet* set, size_t partition);
+void spill_destroy(SpillSet* set);
+
+bool spill_reader_open(SpillReader* reader, const SpillSet* set, size_t partition, size_t buffer_size);
+bool spill_reader_next(SpillReader* reader, const char** key, size_t* key_length,
+                       const void** payload, size_t* payload_size);
+void spill_reader_close(SpillReader* reader);
+
+#endif // SPILL_H
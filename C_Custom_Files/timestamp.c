@@ -0,0 +1,77 @@
+#include "timestamp.h"
+#include <string.h>
+
+// Days from 1970-01-01 to year-month-day in the proleptic Gregorian
+// calendar (Hinnant's days_from_civil; no tables, no time zone)
+int64_t timestamp_days_from_civil(int year, int month, int day) {
+    year -= month <= 2;
+    int64_t era = (year >= 0 ? year : year - 399) / 400;
+    unsigned year_of_era = (unsigned)(year - era * 400);
+    unsigned day_of_year = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+    unsigned day_of_era = year_of_era * 365 + year_of_era / 4 - year_of_era / 100 + day_of_year;
+    return era * 146097 + (int64_t)day_of_era - 719468;
+}
+
+static inline bool is_leap_year(int year) {
+    return year % 4 == 0 && (year % 100 != 0 || year % 400 == 0);
+}
+
+static inline int days_in_month(int year, int month) {
+    static const int days[12] = { 31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31 };
+    return month == 2 && is_leap_year(year) ? 29 : days[month - 1];
+}
+
+// Two ASCII digits as a number; bad is set for any non-digit, so one
+// check at the end covers every field
+static inline int two_digits(const char* p, unsigned* bad) {
+    unsigned hi = (unsigned char)p[0] - '0';
+    unsigned lo = (unsigned char)p[1] - '0';
+    *bad |= (hi > 9) | (lo > 9);
+    return (int)(hi * 10 + lo);
+}
+
+// Decode "YYYY-MM-DD HH:MM:SS" (a fractional part or other trailing text
+// is ignored) as UTC. Returns false if the text is not in that format or a
+// field is out of range. The date is only converted when it differs from
+// the cached one.
+bool timestamp_parse(TimestampCache* cache, const char* text, size_t length, Timestamp* out) {
+    if (length < TIMESTAMP_LENGTH ||
+        text[4] != '-' || text[7] != '-' || text[10] != ' ' || text[13] != ':' || text[16] != ':') {
+        return false;
+    }
+
+    unsigned bad = 0;
+    int hour = two_digits(text + 11, &bad);
+    int minute = two_digits(text + 14, &bad);
+    int second = two_digits(text + 17, &bad);
+    if (bad || hour > 23 || minute > 59 || second > 60) {
+        return false;
+    }
+
+    if (!cache->valid || memcmp(cache->date, text, sizeof(cache->date)) != 0) {
+        int year = two_digits(text, &bad) * 100 + two_digits(text + 2, &bad);
+        int month = two_digits(text + 5, &bad);
+        int day = two_digits(text + 8, &bad);
+        if (bad || month < 1 || month > 12 || day < 1 || day > days_in_month(year, month)) {
+            return false;
+        }
+        memcpy(cache->date, text, sizeof(cache->date));
+        cache->days = timestamp_days_from_civil(year, month, day);
+        cache->valid = true;
+    }
+
+    out->epoch = cache->days * SECONDS_PER_DAY + hour * 3600 + minute * 60 + second;
+    out->hour = hour;
+    out->minute = minute;
+    return true;
+}
+
+// Fill in hour and minute for epoch seconds already decoded (ping files
+// store only the epoch)
+void timestamp_from_epoch(int64_t epoch, Timestamp* out) {
+    int64_t second_of_day = epoch % SECONDS_PER_DAY;
+    if (second_of_day < 0) second_of_day += SECONDS_PER_DAY;
+    out->epoch = epoch;
+    out->hour = (int)(second_of_day / 3600);
+    out->minute = (int)(second_of_day / 60 % 60);
+}
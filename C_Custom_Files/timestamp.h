@@ -0,0 +1,31 @@
+#ifndef TIMESTAMP_H
+#define TIMESTAMP_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#define TIMESTAMP_LENGTH 19     // "YYYY-MM-DD HH:MM:SS"
+#define SECONDS_PER_DAY 86400
+
+// A decoded ping time. The text is taken as UTC whatever the host TZ is.
+typedef struct {
+    int64_t epoch;              // Seconds since 1970-01-01 00:00:00
+    int hour;                   // 0-23
+    int minute;                 // 0-59
+} Timestamp;
+
+// Days-since-epoch of the last date decoded. Rows arrive roughly in date
+// order, so most rows reuse it. One per thread; zero-initialize before use.
+typedef struct {
+    char date[10];              // "YYYY-MM-DD" of the cached day
+    int64_t days;
+    bool valid;
+} TimestampCache;
+
+// Function prototypes
+bool timestamp_parse(TimestampCache* cache, const char* text, size_t length, Timestamp* out);
+void timestamp_from_epoch(int64_t epoch, Timestamp* out);
+int64_t timestamp_days_from_civil(int year, int month, int day);
+
+#endif // TIMESTAMP_H
@@ -0,0 +1,82 @@
+#include <stdio.h>
+#include <string.h>
+#include "timestamp.h"
+
+// timestamp_parse against known epochs and malformed or impossible dates
+
+static int failures = 0;
+
+#define CHECK(condition) do { \
+    if (!(condition)) { \
+        fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition); \
+        failures++; \
+    } \
+} while (0)
+
+static bool parse(const char* text, Timestamp* out) {
+    TimestampCache cache = {0};
+    return timestamp_parse(&cache, text, strlen(text), out);
+}
+
+static void check_epoch(const char* text, int64_t epoch) {
+    Timestamp time;
+    bool ok = parse(text, &time);
+    CHECK(ok);
+    if (ok && time.epoch != epoch) {
+        fprintf(stderr, "%s: epoch %lld, expected %lld\n", text, (long long)time.epoch, (long long)epoch);
+        failures++;
+    }
+}
+
+static void check_rejected(const char* text) {
+    Timestamp time;
+    if (parse(text, &time)) {
+        fprintf(stderr, "%s: accepted, expected rejection\n", text);
+        failures++;
+    }
+}
+
+int main(void) {
+    check_epoch("1970-01-01 00:00:00", 0);
+    check_epoch("2024-07-22 05:07:04", 1721624824);
+    check_epoch("2024-07-22 05:07:04.123 UTC", 1721624824);
+    check_epoch("2024-02-29 12:00:00", 1709208000);   // Leap year
+    check_epoch("2000-02-29 00:00:00", 951782400);    // Divisible by 400: leap
+    check_epoch("2024-04-30 23:59:59", 1714521599);
+    check_epoch("2024-12-31 23:59:59", 1735689599);
+
+    // Days past the end of their month must not roll into the next one
+    check_rejected("2024-02-31 00:00:00");
+    check_rejected("2024-02-30 00:00:00");
+    check_rejected("2023-02-29 00:00:00");            // Not a leap year
+    check_rejected("1900-02-29 00:00:00");            // Divisible by 100: not leap
+    check_rejected("2024-04-31 00:00:00");
+    check_rejected("2024-06-31 00:00:00");
+    check_rejected("2024-09-31 00:00:00");
+    check_rejected("2024-11-31 00:00:00");
+    check_rejected("2024-01-32 00:00:00");
+    check_rejected("2024-01-00 00:00:00");
+    check_rejected("2024-13-01 00:00:00");
+    check_rejected("2024-00-01 00:00:00");
+    check_rejected("2024-07-22 24:00:00");
+    check_rejected("2024-07-22 05:60:00");
+    check_rejected("2024-07-22T05:07:04");
+    check_rejected("2024-07-22 05:07");
+    check_rejected("2024-7-22 05:07:04");
+
+    // A cached date is reused for the next row; a bad one never is
+    TimestampCache cache = {0};
+    Timestamp time;
+    CHECK(timestamp_parse(&cache, "2024-07-22 05:07:04", TIMESTAMP_LENGTH, &time));
+    CHECK(timestamp_parse(&cache, "2024-07-22 06:00:00", TIMESTAMP_LENGTH, &time) && time.epoch == 1721628000);
+    CHECK(time.hour == 6 && time.minute == 0);
+    CHECK(!timestamp_parse(&cache, "2024-04-31 06:00:00", TIMESTAMP_LENGTH, &time));
+    CHECK(timestamp_parse(&cache, "2024-07-22 06:00:00", TIMESTAMP_LENGTH, &time) && time.epoch == 1721628000);
+
+    if (failures) {
+        fprintf(stderr, "timestamp_test: %d failures\n", failures);
+        return 1;
+    }
+    printf("timestamp_test: ok\n");
+    return 0;
+}
@@ -0,0 +1,314 @@
+// Header-only Robin Hood hash table, specialized at compile time per key and
+// value type. Define the parameters, then include this file once per table:
+//
+//   #define TYPED_MAP_NAME      HashMap         table type
+//   #define TYPED_MAP_SLOT      Entry           slot type
+//   #define TYPED_MAP_PREFIX    hashmap_table   prefix of the generated functions
+//   #define TYPED_MAP_KEY       HashMapKey      lookup key type
+//   #define TYPED_MAP_STORED    DeviceKey       key type kept in the slot
+//   #define TYPED_MAP_KEY_OPS   device_key      prefix of the key functions
+//   #define TYPED_MAP_KEY_STORE Arena           per-table storage the keys live in
+//   #define TYPED_MAP_FIELDS    uint16_t value1; int32_t latitude;
+//   #include "typed_map.h"
+//
+// TYPED_MAP_CALLOC optionally replaces calloc for the slot arrays (tests use
+// it to inject allocation failures); they are freed with free.
+//
+// The value fields are declared inline in the slot, so the compiler packs
+// them beside the probe distance and a slot holds no boxed value. The key
+// functions, usually static inline, are:
+//
+//   uint64_t ops_hash(const KEY* key)
+//   bool ops_matches(const STORED* stored, uint8_t tag, const KEY* key)
+//   bool ops_copy(STORE* store, STORED* stored, uint8_t* tag, const KEY* key)
+//   void ops_release(STORE* store, STORED* stored, uint8_t tag)
+//   void ops_store_init(STORE* store) / void ops_store_release(STORE* store)
+//
+// tag is a spare slot byte the key type may use (device keys keep their
+// kind there). ops_release hands one removed key back to the store;
+// ops_store_release frees every key at once, so releasing a table never
+// walks its slots. Generated functions, for prefix p:
+//
+//   bool p_init(Map*, capacity) / void p_release(Map*)
+//   Slot* p_find(Map*, key, hash)      Slot* p_upsert(Map*, key, &inserted)
+//   Slot* p_upsert_hashed(Map*, key, hash, &inserted)
+//   bool p_reserve(Map*, expected)     bool p_remove(Map*, key)
+//   void p_remove_slot(Map*, slot)
+//
+// A slot pointer is valid until the next insert or remove. Capacity is a
+// power of two, the load factor 70%, and every slot keeps its key's full
+// hash: probes compare it before the key and resizes never re-hash.
+
+#ifndef TYPED_MAP_COMMON_H
+#define TYPED_MAP_COMMON_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define TYPED_MAP_MIN_CAPACITY 16
+#define TYPED_MAP_PAGE_BYTES 4096
+// Slot indexes come from bits 32..63 of the Fibonacci product, so 2^32 slots
+// is the most they can address. (A table can't take the top bits instead:
+// concurrent_hashmap picks its shard from those.)
+#define TYPED_MAP_MAX_CAPACITY ((size_t)1 << 32)
+
+// Outcome of moving a table into a new slot array
+typedef enum {
+    TYPED_MAP_REHASHED,
+    TYPED_MAP_NO_MEMORY,        // The new slot array could not be allocated
+    TYPED_MAP_OVERFLOW          // A cluster overflowed a probe distance; a larger table may not
+} TypedMapRehash;
+
+#define TYPED_MAP_CONCAT_(a, b) a##b
+#define TYPED_MAP_CONCAT(a, b) TYPED_MAP_CONCAT_(a, b)
+
+// Fibonacci hashing: spread the key hash over a power-of-two table with a
+// multiply and a shift instead of a division
+static inline size_t typed_map_slot_index(uint64_t hash_value, size_t capacity) {
+    return (size_t)((hash_value * 0x9E3779B97F4A7C15ULL) >> 32) & (capacity - 1);
+}
+
+static inline size_t typed_map_next_index(size_t index, size_t capacity) {
+    return (index + 1) & (capacity - 1);
+}
+
+// Smallest power-of-two capacity holding entries under the 70% load factor,
+// at most TYPED_MAP_MAX_CAPACITY
+static inline size_t typed_map_capacity_for(size_t entries) {
+    size_t capacity = TYPED_MAP_MIN_CAPACITY;
+    while (capacity < TYPED_MAP_MAX_CAPACITY && capacity * 7 / 10 < entries) capacity *= 2;
+    return capacity;
+}
+
+#endif // TYPED_MAP_COMMON_H
+
+#if !defined(TYPED_MAP_NAME) || !defined(TYPED_MAP_SLOT) || !defined(TYPED_MAP_PREFIX) || \
+    !defined(TYPED_MAP_KEY) || !defined(TYPED_MAP_STORED) || !defined(TYPED_MAP_KEY_OPS) || \
+    !defined(TYPED_MAP_KEY_STORE) || !defined(TYPED_MAP_FIELDS)
+#error "typed_map.h: define every TYPED_MAP_* parameter before including"
+#endif
+
+#ifndef TYPED_MAP_CALLOC
+#define TYPED_MAP_CALLOC calloc
+#endif
+
+#define TM_FN(name) TYPED_MAP_CONCAT(TYPED_MAP_PREFIX, _##name)
+#define TM_KEY_FN(name) TYPED_MAP_CONCAT(TYPED_MAP_KEY_OPS, _##name)
+
+typedef struct {
+    uint8_t dist;               // Probe distance + 1 (0 marks an empty slot)
+    uint8_t tag;                // Spare byte for the key type
+    TYPED_MAP_FIELDS
+    uint64_t hash;              // Full key hash
+    TYPED_MAP_STORED key;
+} TYPED_MAP_SLOT;
+
+typedef struct {
+    TYPED_MAP_SLOT* slots;      // Flat slot array
+    size_t capacity;            // Total capacity (a power of two)
+    size_t size;                // Number of keys
+    size_t resize_threshold;    // Resize threshold (70% load factor)
+    size_t resize_count;        // Slot table doublings so far
+    TYPED_MAP_KEY_STORE keys;   // Storage behind the stored keys
+} TYPED_MAP_NAME;
+
+static inline bool TM_FN(init)(TYPED_MAP_NAME* map, size_t capacity) {
+    map->capacity = TYPED_MAP_MIN_CAPACITY;
+    while (map->capacity < capacity && map->capacity < TYPED_MAP_MAX_CAPACITY) map->capacity *= 2;
+    map->slots = TYPED_MAP_CALLOC(map->capacity, sizeof(TYPED_MAP_SLOT));
+    map->size = 0;
+    map->resize_threshold = (size_t)(map->capacity * 0.7);
+    map->resize_count = 0;
+    TM_KEY_FN(store_init)(&map->keys);
+    return map->slots != NULL;
+}
+
+// Free the key store and the slot array, without visiting the slots
+static inline void TM_FN(release)(TYPED_MAP_NAME* map) {
+    TM_KEY_FN(store_release)(&map->keys);
+    free(map->slots);
+    map->slots = NULL;
+}
+
+// Whether placing a key of this hash keeps every probe distance within the
+// dist byte. Read-only: follows the same displacements place would make.
+static inline bool TM_FN(fits)(const TYPED_MAP_SLOT* slots, size_t capacity, uint64_t hash_value) {
+    size_t index = typed_map_slot_index(hash_value, capacity);
+    for (uint8_t dist = 1; slots[index].dist != 0; dist++) {
+        if (slots[index].dist < dist) dist = slots[index].dist;  // Now carrying the resident
+        if (dist == UINT8_MAX) return false;
+        index = typed_map_next_index(index, capacity);
+    }
+    return true;
+}
+
+// Place a slot known to be absent using Robin Hood displacement. Returns
+// false, leaving the table and *slot untouched, if a probe distance would
+// overflow the dist byte. *placed (when not NULL) gets the slot's place.
+static inline bool TM_FN(place)(TYPED_MAP_SLOT* slots, size_t capacity, TYPED_MAP_SLOT* slot,
+                                TYPED_MAP_SLOT** placed) {
+    if (!TM_FN(fits)(slots, capacity, slot->hash)) return false;
+
+    TYPED_MAP_SLOT carried = *slot;
+    size_t index = typed_map_slot_index(carried.hash, capacity);
+    carried.dist = 1;
+    if (placed) *placed = NULL;
+    while (slots[index].dist != 0) {
+        if (slots[index].dist < carried.dist) {
+            // Take from the rich: the resident is closer to home than we are
+            TYPED_MAP_SLOT displaced = slots[index];
+            slots[index] = carried;
+            carried = displaced;
+            if (placed && !*placed) *placed = &slots[index];
+        }
+        carried.dist++;
+        index = typed_map_next_index(index, capacity);
+    }
+    slots[index] = carried;
+    if (placed && !*placed) *placed = &slots[index];
+    return true;
+}
+
+// Move every slot into a table of the given capacity by its stored hash
+static inline TypedMapRehash TM_FN(rehash)(TYPED_MAP_NAME* map, size_t new_capacity) {
+    TYPED_MAP_SLOT* new_slots = TYPED_MAP_CALLOC(new_capacity, sizeof(TYPED_MAP_SLOT));
+    if (!new_slots) return TYPED_MAP_NO_MEMORY;
+
+    for (size_t i = 0; i < map->capacity; i++) {
+        if (map->slots[i].dist == 0) continue;
+        TYPED_MAP_SLOT moved = map->slots[i];
+        if (!TM_FN(place)(new_slots, new_capacity, &moved, NULL)) {
+            free(new_slots);
+            return TYPED_MAP_OVERFLOW;
+        }
+    }
+
+    free(map->slots);
+    map->slots = new_slots;
+    map->capacity = new_capacity;
+    map->resize_threshold = (size_t)(new_capacity * 0.7);
+    return TYPED_MAP_REHASHED;
+}
+
+// Double the table, again if a cluster still overflows a probe distance.
+// Out of memory gives up at once rather than asking for ever more.
+static inline bool TM_FN(grow)(TYPED_MAP_NAME* map) {
+    if (map->capacity >= TYPED_MAP_MAX_CAPACITY) return false;
+    size_t new_capacity = map->capacity;
+    TypedMapRehash result;
+    do {
+        new_capacity *= 2;
+        result = TM_FN(rehash)(map, new_capacity);
+    } while (result == TYPED_MAP_OVERFLOW && new_capacity < TYPED_MAP_MAX_CAPACITY);
+    if (result != TYPED_MAP_REHASHED) return false;
+    map->resize_count++;
+    return true;
+}
+
+// Pre-size for an expected number of keys so inserts up to that count never
+// stop for a rehash; a table already large enough is left alone
+static inline bool TM_FN(reserve)(TYPED_MAP_NAME* map, size_t expected) {
+    if (expected > TYPED_MAP_MAX_CAPACITY / 10 * 7) return false;
+    size_t capacity = typed_map_capacity_for(expected);
+    if (capacity <= map->capacity) return true;
+    if (TM_FN(rehash)(map, capacity) != TYPED_MAP_REHASHED) return false;
+
+    // A large calloc hands back untouched zero pages; fault them in now
+    // rather than one page per insert
+    volatile uint8_t* bytes = (volatile uint8_t*)map->slots;
+    for (size_t i = 0; i < capacity * sizeof(TYPED_MAP_SLOT); i += TYPED_MAP_PAGE_BYTES) bytes[i] = bytes[i];
+    return true;
+}
+
+// Find the slot holding key, or NULL
+static inline TYPED_MAP_SLOT* TM_FN(find)(TYPED_MAP_NAME* map, const TYPED_MAP_KEY* key, uint64_t hash_value) {
+    size_t index = typed_map_slot_index(hash_value, map->capacity);
+    for (uint8_t dist = 1; ; dist++) {
+        TYPED_MAP_SLOT* slot = &map->slots[index];
+        // Robin Hood invariant: the key cannot sit further than a poorer resident
+        if (slot->dist < dist) return NULL;
+        if (slot->dist == dist && slot->hash == hash_value && TM_KEY_FN(matches)(&slot->key, slot->tag, key)) {
+            return slot;
+        }
+        if (dist == UINT8_MAX) return NULL;
+        index = typed_map_next_index(index, map->capacity);
+    }
+}
+
+// Insert key, known to be absent, with zeroed fields; returns its slot
+static inline TYPED_MAP_SLOT* TM_FN(insert_absent)(TYPED_MAP_NAME* map, const TYPED_MAP_KEY* key, uint64_t hash_value) {
+    if (map->size + 1 > map->resize_threshold && !TM_FN(grow)(map)) {
+        return NULL;
+    }
+
+    TYPED_MAP_SLOT slot;
+    memset(&slot, 0, sizeof(slot));
+    slot.hash = hash_value;
+    if (!TM_KEY_FN(copy)(&map->keys, &slot.key, &slot.tag, key)) return NULL;
+
+    TYPED_MAP_SLOT* placed;
+    if (TM_FN(place)(map->slots, map->capacity, &slot, &placed)) {
+        map->size++;
+        return placed;
+    }
+    do {
+        // A pathological cluster: nothing was placed, so grow and retry; on
+        // failure slot still holds only the caller's key
+        if (!TM_FN(grow)(map)) {
+            TM_KEY_FN(release)(&map->keys, &slot.key, slot.tag);
+            return NULL;
+        }
+    } while (!TM_FN(place)(map->slots, map->capacity, &slot, &placed));
+    map->size++;
+    return placed;
+}
+
+// Find or insert in one probe: a miss inserts from the same hash. The
+// hashed form takes a hash already known, e.g. a slot's when merging tables.
+static inline TYPED_MAP_SLOT* TM_FN(upsert_hashed)(TYPED_MAP_NAME* map, const TYPED_MAP_KEY* key, uint64_t hash_value,
+                                                   bool* inserted) {
+    TYPED_MAP_SLOT* slot = TM_FN(find)(map, key, hash_value);
+    *inserted = slot == NULL;
+    return slot ? slot : TM_FN(insert_absent)(map, key, hash_value);
+}
+
+static inline TYPED_MAP_SLOT* TM_FN(upsert)(TYPED_MAP_NAME* map, const TYPED_MAP_KEY* key, bool* inserted) {
+    return TM_FN(upsert_hashed)(map, key, TM_KEY_FN(hash)(key), inserted);
+}
+
+// Remove a slot's key, shifting the following cluster back one slot
+static inline void TM_FN(remove_slot)(TYPED_MAP_NAME* map, TYPED_MAP_SLOT* slot) {
+    TM_KEY_FN(release)(&map->keys, &slot->key, slot->tag);
+
+    size_t hole = (size_t)(slot - map->slots);
+    size_t index = typed_map_next_index(hole, map->capacity);
+    while (map->slots[index].dist > 1) {
+        map->slots[hole] = map->slots[index];
+        map->slots[hole].dist--;
+        hole = index;
+        index = typed_map_next_index(index, map->capacity);
+    }
+    map->slots[hole].dist = 0;
+    map->size--;
+}
+
+static inline bool TM_FN(remove)(TYPED_MAP_NAME* map, const TYPED_MAP_KEY* key) {
+    TYPED_MAP_SLOT* slot = TM_FN(find)(map, key, TM_KEY_FN(hash)(key));
+    if (!slot) return false;
+    TM_FN(remove_slot)(map, slot);
+    return true;
+}
+
+#undef TM_FN
+#undef TM_KEY_FN
+#undef TYPED_MAP_NAME
+#undef TYPED_MAP_SLOT
+#undef TYPED_MAP_PREFIX
+#undef TYPED_MAP_KEY
+#undef TYPED_MAP_STORED
+#undef TYPED_MAP_KEY_OPS
+#undef TYPED_MAP_KEY_STORE
+#undef TYPED_MAP_FIELDS
+#undef TYPED_MAP_CALLOC
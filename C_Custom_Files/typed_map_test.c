@@ -0,0 +1,200 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+// typed_map.h tests on a table whose key hashes are chosen by the test, so
+// a cluster can be driven to the probe-distance limit, with slot-array
+// allocations that can be made to fail.
+
+static int failures = 0;
+
+#define CHECK(condition) do { \
+    if (!(condition)) { \
+        fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition); \
+        failures++; \
+    } \
+} while (0)
+
+// A key is an id plus the hash the test wants it to have
+typedef struct {
+    uint64_t id;
+    uint64_t hash;
+} TestKey;
+
+// Live key copies per id, to catch a key released that was never removed
+#define MAX_KEYS 4096
+static int live_copies[MAX_KEYS];
+
+typedef struct {
+    int unused;
+} TestStore;
+
+static inline uint64_t test_key_hash(const TestKey* key) {
+    return key->hash;
+}
+
+static inline bool test_key_matches(const uint64_t* stored, uint8_t tag, const TestKey* key) {
+    (void)tag;
+    return *stored == key->id;
+}
+
+static inline bool test_key_copy(TestStore* store, uint64_t* stored, uint8_t* tag, const TestKey* key) {
+    (void)store;
+    *stored = key->id;
+    *tag = 0;
+    live_copies[key->id]++;
+    return true;
+}
+
+static inline void test_key_release(TestStore* store, uint64_t* stored, uint8_t tag) {
+    (void)store;
+    (void)tag;
+    live_copies[*stored]--;
+}
+
+static inline void test_key_store_init(TestStore* store) {
+    (void)store;
+}
+
+static inline void test_key_store_release(TestStore* store) {
+    (void)store;
+}
+
+// Slot-array allocator that fails while fail_allocations is set
+static bool fail_allocations = false;
+static size_t allocation_attempts = 0;
+
+static void* test_calloc(size_t count, size_t size) {
+    allocation_attempts++;
+    return fail_allocations ? NULL : calloc(count, size);
+}
+
+#define TYPED_MAP_NAME TestMap
+#define TYPED_MAP_SLOT TestSlot
+#define TYPED_MAP_PREFIX test_map
+#define TYPED_MAP_KEY TestKey
+#define TYPED_MAP_STORED uint64_t
+#define TYPED_MAP_KEY_OPS test_key
+#define TYPED_MAP_KEY_STORE TestStore
+#define TYPED_MAP_FIELDS uint32_t value;
+#define TYPED_MAP_CALLOC test_calloc
+#include "typed_map.h"
+
+// Some hash whose home slot in a table of this capacity is index
+static uint64_t hash_for_index(size_t index, size_t capacity) {
+    for (uint64_t hash = 0; ; hash++) {
+        if (typed_map_slot_index(hash, capacity) == index) return hash;
+    }
+}
+
+static bool contains(TestMap* map, const TestKey* key) {
+    return test_map_find(map, key, key->hash) != NULL;
+}
+
+// Fill a cluster to the limit: UINT8_MAX keys share home slot 101, behind
+// one key at home 100. A new key homed at 100 displaces the home-101 keys
+// until the last would need distance 256, so the insert must grow; when
+// growing fails, the table must be exactly as before.
+static void test_failed_grow_keeps_table(void) {
+    TestMap map;
+    const size_t capacity = 1024;
+    CHECK(test_map_init(&map, capacity));
+
+    uint64_t cluster_hash = hash_for_index(101, capacity);
+    TestKey keys[UINT8_MAX + 1];
+    keys[0] = (TestKey){ 0, hash_for_index(100, capacity) };
+    for (uint64_t id = 1; id <= UINT8_MAX; id++) keys[id] = (TestKey){ id, cluster_hash };
+    for (size_t i = 0; i <= UINT8_MAX; i++) {
+        bool inserted;
+        TestSlot* slot = test_map_upsert(&map, &keys[i], &inserted);
+        CHECK(slot && inserted);
+        if (slot) slot->value = (uint32_t)i;
+    }
+    CHECK(map.size == UINT8_MAX + 1);
+    CHECK(map.capacity == capacity);
+
+    TestKey extra = { UINT8_MAX + 1, keys[0].hash };
+    bool inserted;
+    fail_allocations = true;
+    allocation_attempts = 0;
+    CHECK(test_map_upsert(&map, &extra, &inserted) == NULL);
+    CHECK(allocation_attempts == 1);  // No retries at ever larger sizes
+    fail_allocations = false;
+
+    CHECK(map.size == UINT8_MAX + 1);
+    CHECK(map.capacity == capacity);
+    CHECK(!contains(&map, &extra));
+    CHECK(live_copies[extra.id] == 0);
+    for (size_t i = 0; i <= UINT8_MAX; i++) {
+        TestSlot* slot = test_map_find(&map, &keys[i], keys[i].hash);
+        CHECK(slot && slot->value == i);
+        CHECK(live_copies[i] == 1);
+    }
+
+    // With memory back, the same insert grows and succeeds
+    TestSlot* slot = test_map_upsert(&map, &extra, &inserted);
+    CHECK(slot && inserted);
+    CHECK(map.size == UINT8_MAX + 2);
+    CHECK(map.capacity > capacity);
+    CHECK(live_copies[extra.id] == 1);
+    for (size_t i = 0; i <= UINT8_MAX; i++) CHECK(contains(&map, &keys[i]));
+    CHECK(contains(&map, &extra));
+
+    for (size_t i = 0; i <= UINT8_MAX + 1; i++) {
+        TestKey key = i <= UINT8_MAX ? keys[i] : extra;
+        CHECK(test_map_remove(&map, &key));
+        CHECK(live_copies[i] == 0);
+    }
+    CHECK(map.size == 0);
+    test_map_release(&map);
+}
+
+// Ordinary inserts, growth and removals keep every key findable
+static void test_insert_remove(void) {
+    TestMap map;
+    CHECK(test_map_init(&map, 0));
+    const uint64_t count = MAX_KEYS;
+    for (uint64_t id = 0; id < count; id++) {
+        TestKey key = { id, id * 0xD6E8FEB86659FD93ULL };
+        bool inserted;
+        CHECK(test_map_upsert(&map, &key, &inserted) && inserted);
+    }
+    CHECK(map.size == count);
+    CHECK(map.resize_count > 0);
+    for (uint64_t id = 0; id < count; id += 2) {
+        TestKey key = { id, id * 0xD6E8FEB86659FD93ULL };
+        CHECK(test_map_remove(&map, &key));
+    }
+    for (uint64_t id = 0; id < count; id++) {
+        TestKey key = { id, id * 0xD6E8FEB86659FD93ULL };
+        CHECK(contains(&map, &key) == (id % 2 == 1));
+    }
+    test_map_release(&map);
+}
+
+// Sizes past what slot indexes can address are refused, not allocated
+static void test_capacity_limit(void) {
+    CHECK(typed_map_capacity_for(SIZE_MAX) == TYPED_MAP_MAX_CAPACITY);
+    CHECK(typed_map_slot_index(UINT64_MAX, TYPED_MAP_MAX_CAPACITY) < TYPED_MAP_MAX_CAPACITY);
+
+    TestMap map;
+    CHECK(test_map_init(&map, 0));
+    allocation_attempts = 0;
+    CHECK(!test_map_reserve(&map, SIZE_MAX));
+    CHECK(allocation_attempts == 0);
+    test_map_release(&map);
+}
+
+int main(void) {
+    test_failed_grow_keeps_table();
+    test_insert_remove();
+    test_capacity_limit();
+
+    if (failures) {
+        fprintf(stderr, "typed_map_test: %d failures\n", failures);
+        return 1;
+    }
+    printf("typed_map_test: ok\n");
+    return 0;
+}
@@ -2,210 +2,546 @@
 #include <stdlib.h>
 #include <string.h>
 #include <dirent.h> // For directory operations
+#include <unistd.h>
+#include <getopt.h>
+#include <time.h>
+#include <sys/stat.h>
+#include <sys/resource.h>
 #include "../C_Custom_Files/hashmap.h"
+#include "../C_Custom_Files/file_pool.h"
+#include "../C_Custom_Files/csv_reader.h"
+#include "../C_Custom_Files/timestamp.h"
+#include "../C_Custom_Files/fixed_point.h"
+#include "../C_Custom_Files/parquet_reader.h"
+#include "../C_Custom_Files/ping_file.h"
+#include "../C_Custom_Files/spill.h"
 
-#define GRID_SIZE 0.02
-#define LAT_MIN 33.4
-#define LAT_MAX 34.3  // Fixed to include polygon
-#define LON_MIN -118.6
-#define LON_MAX -117.6
+// Coordinates are in microdegrees
+#define GRID_SIZE MICRODEGREES(0.02)
+#define LAT_MIN MICRODEGREES(33.4)
+#define LAT_MAX MICRODEGREES(34.3)  // Fixed to include polygon
+#define LON_MIN MICRODEGREES(-118.6)
+#define LON_MAX MICRODEGREES(-117.6)
+#define MAX_ABS_SPEED SPEED_CMS(3.0)  // Stationary: |speed| below 3 m/s
+
+// Division by GRID_SIZE as a multiply and shift: with the reciprocal rounded
+// up, the result is exact for offsets below 2^GRID_SHIFT / GRID_SIZE
+#define GRID_SHIFT 40
+#define GRID_RECIPROCAL (((1ULL << GRID_SHIFT) + GRID_SIZE - 1) / GRID_SIZE)
 
 #define GRID_ROWS 45  // (34.3-33.4)/0.02 = 45
 #define GRID_COLS 50
-#define MAX_LINE_LENGTH 10000
-#define MAX_FIELD_LENGTH 4096
 #define KEEP_MIN_LOC true
+#define INGEST_RANGE_BYTES (64u << 20)  // Work unit when splitting files across workers
+#define DEVICE_MAP_CAPACITY (1u << 21)  // Initial map slots; --devices presizes beyond it
+
+// Spill mode (--mem-limit): a worst-case device map of one device per
+// input row, at ~100 bytes a row (CSV or Parquet) or 18 (ping files) and
+// ~64 bytes a device. Over half the limit, devices are split by id hash
+// into partitions estimated at half the limit each.
+#define DEVICE_MAP_ESTIMATE(input_bytes) ((input_bytes) / 100 * 64)
+#define PING_FILE_DEVICE_MAP_ESTIMATE(input_bytes) ((input_bytes) / 18 * 64)
+#define SPILL_BUFFER_BYTES (256u << 10)  // Per-partition write buffer, and the read buffer
+#define SPILL_MIN_PARTITIONS 2
+
+// Input columns used from each ping row
+#define COL_ADVERTISER_ID 0
+#define COL_TIMESTAMP 3
+#define COL_LATITUDE 4
+#define COL_LONGITUDE 5
+#define COL_SPEED 10
+#define CSV_COLUMNS 11
+
+// The same columns by name in Parquet input
+static const char* const PARQUET_COLUMNS[] = {
+    "advertiser_id", "local_location_at", "latitude", "longitude", "speed"
+};
+enum { PQ_ADVERTISER_ID, PQ_TIMESTAMP, PQ_LATITUDE, PQ_LONGITUDE, PQ_SPEED, PQ_COLUMNS };
 
 int grid_data[GRID_ROWS][GRID_COLS] = {{0}};
 
-// Function to map latitude and longitude to grid cell
-void map_to_grid(double latitude, double longitude, int *row, int *col) {
-    *row = (int)((latitude - LAT_MIN) / GRID_SIZE);
-    *col = (int)((longitude - LON_MIN) / GRID_SIZE);
+// Where an ingest worker puts night-time pings: its own map, or in spill
+// mode the shared partitions
+typedef struct {
+    HashMap* map;
+    SpillSet* spill;
+    size_t dropped;             // Pings the spill refused (e.g. ids over SPILL_MAX_KEY)
+} DeviceSink;
+
+// A spilled ping: HHMM time and location
+typedef struct {
+    uint16_t time;
+    int32_t latitude;
+    int32_t longitude;
+} SpilledPing;
+
+// Function to map latitude and longitude to grid cell. Points below the
+// minimums wrap to huge offsets, which the callers' bounds checks reject.
+void map_to_grid(int32_t latitude, int32_t longitude, int *row, int *col) {
+    *row = (int)(((uint64_t)(uint32_t)(latitude - LAT_MIN) * GRID_RECIPROCAL) >> GRID_SHIFT);
+    *col = (int)(((uint64_t)(uint32_t)(longitude - LON_MIN) * GRID_RECIPROCAL) >> GRID_SHIFT);
+}
+
+// Fold a device's night-time window [first, last] (HHMM) and a location into the map.
+// value1 keeps the earliest time, value2 the latest; the stored location follows
+// value1 when KEEP_MIN_LOC is set and value2 otherwise. A single ping is first == last,
+// and merging a worker's map replays each of its devices through the same rule.
+static void update_device(HashMap* map, const HashMapKey* key, int first, int last, int32_t latitude, int32_t longitude) {
+    bool inserted;
+    Entry* entry = hashmap_table_upsert(map, key, &inserted); // one inlined probe, found or new
+    if (!entry) return;
+
+    bool new_min = inserted || entry->value1 == 0 || first < entry->value1;
+    bool new_max = inserted || entry->value2 == 0 || last > entry->value2;
+    if (new_min) entry->value1 = (uint16_t)first;
+    if (new_max) entry->value2 = (uint16_t)last;
+    if (KEEP_MIN_LOC ? new_min : new_max) { //the kept location moves with its time
+        entry->latitude = latitude;
+        entry->longitude = longitude;
+    }
+}
+
+// Count each device once, in the grid cell of its stored location
+static void build_grid(HashMap* map) {
+    for (size_t i = 0; i < map->capacity; i++) {
+        const Entry* entry = &map->slots[i];
+        if (entry->dist == 0) continue;
+        int row, col;
+        map_to_grid(entry->latitude, entry->longitude, &row, &col);
+        if (row >= 0 && row < GRID_ROWS && col >= 0 && col < GRID_COLS) {
+            grid_data[row][col]++;
+        }
+    }
 }
 
-void process_csv_file(HashMap* map, char *filename) {
-    FILE* file = fopen(filename, "r");
-    if (!file) {
+// Fold a night-time ping at time t (HHMM) into the map if it lies within the bounds.
+// Shared by the CSV, Parquet and ping file readers.
+static void add_ping(DeviceSink* sink, const char* dev_id, size_t length, int t, int32_t latitude, int32_t longitude) {
+    // Check if the latitude and longitude are within the bounds
+    if (latitude >= LAT_MIN && latitude <= LAT_MAX &&
+        longitude >= LON_MIN && longitude <= LON_MAX) {
+        if (sink->spill) {
+            SpilledPing ping;
+            memset(&ping, 0, sizeof(ping));  // No stray padding bytes in spill runs
+            ping.time = (uint16_t)t;
+            ping.latitude = latitude;
+            ping.longitude = longitude;
+            if (!spill_add(sink->spill, dev_id, length, &ping, sizeof(ping))) {
+                sink->dropped++;
+            }
+            return;
+        }
+        // Parse the device id once for the lookup and the update
+        HashMapKey dev_key;
+        hashmap_key_init(&dev_key, dev_id, length);
+        update_device(sink->map, &dev_key, t, t, latitude, longitude);
+    }
+}
+
+// Process the rows of a CSV file that start in [begin, end)
+void process_csv_file(DeviceSink* sink, const char *filename, size_t begin, size_t end) {
+    CsvReader reader;
+    if (!csv_reader_open_range(&reader, filename, begin, end)) {
         fprintf(stderr, "Failed to open file\n");
         return;
     }
 
-    char line[MAX_LINE_LENGTH + 2];
-    int line_number = 0;
-
-    while (fgets(line, sizeof(line), file)) {
-        int col = 0;
-        line_number++;
-        size_t len = strlen(line);
-
-        // Extract the latitude and longitude from the line
-        char *dev_id_str = NULL;
-        char *latitude_str = NULL;
-        char *longitude_str = NULL;
-        char *token = strtok(line, ",");
-        char *time_str = NULL;
-        char *speed_str = NULL;
-
-        while (token != NULL && col < 11) {
-            if (col == 0) {
-                dev_id_str = token;
-            } else
-            if (col == 3) {
-                time_str = token;
-            } else
-            if (col == 4) {
-                latitude_str = token;
-            } else if (col == 5) {
-                longitude_str = token;
+    CsvField fields[CSV_COLUMNS];
+    TimestampCache time_cache = {0};
+    int field_count;
+
+    while ((field_count = csv_reader_next(&reader, fields, CSV_COLUMNS)) >= 0) {
+        // Extract the device id, timestamp, latitude, longitude and speed from the row
+        if (field_count < CSV_COLUMNS) {
+            continue;
+        }
+        const CsvField* dev_id = &fields[COL_ADVERTISER_ID];
+
+        // Decode the timestamp (which is in the format "YYYY-MM-DD HH:MM:SS")
+        Timestamp time;
+        if (!timestamp_parse(&time_cache, fields[COL_TIMESTAMP].ptr, fields[COL_TIMESTAMP].len, &time)) {
+            printf("Invalid timestamp format.\n");
+            continue;
+        }
+        int hour_int = time.hour;
+        int minutes_int = time.minute;
+
+        //conver the speed to cm/s (an empty speed is unknown and reads as 0)
+        int16_t speed = 0;
+        fixed_parse_speed(fields[COL_SPEED].ptr, fields[COL_SPEED].len, &speed);
+
+        // Check if the hour is between 20:00 (8 PM) or before 04:00 (4 AM)
+        if (!((hour_int >= 20 || hour_int < 4) && speed < MAX_ABS_SPEED && speed > -MAX_ABS_SPEED)) {
+            continue;  // Skip the data if the time is not in the valid range
+        }
+
+        int32_t latitude, longitude;
+        if (dev_id->len == 0 ||
+            !fixed_parse_microdegrees(fields[COL_LATITUDE].ptr, fields[COL_LATITUDE].len, &latitude) ||
+            !fixed_parse_microdegrees(fields[COL_LONGITUDE].ptr, fields[COL_LONGITUDE].len, &longitude)) {
+            continue;
+        }
+
+        add_ping(sink, dev_id->ptr, dev_id->len, hour_int * 100 + minutes_int, latitude, longitude);
+    }
+
+    csv_reader_close(&reader);
+}
+
+// Process the row groups of a Parquet file that start in [begin, end),
+// applying the same filters as the CSV path. Null speeds read as 0 like
+// empty CSV fields; other nulls skip the row.
+void process_parquet_file(DeviceSink* sink, const char *filename, size_t begin, size_t end) {
+    ParquetReader reader;
+    if (!parquet_open(&reader, filename, PARQUET_COLUMNS, PQ_COLUMNS)) {
+        fprintf(stderr, "Failed to open file: %s\n", reader.error);
+        parquet_close(&reader);
+        return;
+    }
+    const ParquetColumn* columns = reader.columns;
+    if (columns[PQ_ADVERTISER_ID].type != PARQUET_BYTE_ARRAY || columns[PQ_TIMESTAMP].type != PARQUET_BYTE_ARRAY ||
+        (columns[PQ_LATITUDE].type != PARQUET_DOUBLE && columns[PQ_LATITUDE].type != PARQUET_FLOAT) ||
+        (columns[PQ_LONGITUDE].type != PARQUET_DOUBLE && columns[PQ_LONGITUDE].type != PARQUET_FLOAT) ||
+        (columns[PQ_SPEED].type != PARQUET_DOUBLE && columns[PQ_SPEED].type != PARQUET_FLOAT)) {
+        fprintf(stderr, "Unexpected column types in %s\n", filename);
+        parquet_close(&reader);
+        return;
+    }
+
+    TimestampCache time_cache = {0};
+    const ParquetColumn* dev_ids = &columns[PQ_ADVERTISER_ID];
+    const ParquetColumn* times = &columns[PQ_TIMESTAMP];
+    const ParquetColumn* speeds = &columns[PQ_SPEED];
+
+    for (size_t g = 0; g < reader.row_group_count; g++) {
+        // A row group belongs to the range holding its first byte
+        if (reader.row_groups[g].offset < begin || reader.row_groups[g].offset >= end) {
+            continue;
+        }
+        if (!parquet_read_row_group(&reader, g)) {
+            fprintf(stderr, "Failed to read %s: %s\n", filename, reader.error);
+            break;
+        }
+
+        for (size_t i = 0; i < reader.group_rows; i++) {
+            Timestamp time;
+            if (!times->present[i] ||
+                !timestamp_parse(&time_cache, times->strings[i].ptr, times->strings[i].len, &time)) {
+                printf("Invalid timestamp format.\n");
+                continue;
             }
-            else if (col == 10) {
-                speed_str = token;
+
+            int16_t speed = 0;
+            if (speeds->present[i]) {
+                fixed_speed_from_double(speeds->doubles[i], &speed);
             }
-            token = strtok(NULL, ",");
-            col++;
-        }
-        if (time_str) {
-            // Extract the hour portion from the time_str (which is in the format "HH:MM:SS")
-            char *space = strchr(time_str, ' ');
-            if (space != NULL) {
-                // Move past the space to the beginning of the time portion
-                char *time_portion = space + 1;
-
-                // Extract the two digits before the first colon ':' (the hour part)
-                char hour[3];  // To store the two digits + null terminator
-                strncpy(hour, time_portion, 2);
-                hour[2] = '\0';  // Null terminate the string
-
-                //do the same for the minutes
-                char minutes[3];
-                strncpy(minutes, time_portion+3, 2);
-                minutes[2] = '\0';
-                
-                // Convert the time to an integer (hour)
-                int hour_int = atoi(hour);
-                int minutes_int = atoi(minutes);
-
-                //conver the speed to a float
-                float speed = atof(speed_str);
-
-                bool modified = false;
-
-                // Check if the hour is between 20:00 (8 PM) or before 04:00 (4 AM)
-                if ((hour_int >= 20 || hour_int < 4) && speed < 3 && speed > -3) {
-                    
-                    if (latitude_str && longitude_str) {
-                        double latitude = atof(latitude_str);
-                        double longitude = atof(longitude_str);
-                        
-                        // Check if the latitude and longitude are within the bounds
-                        if (latitude >= LAT_MIN && latitude <= LAT_MAX &&
-                            longitude >= LON_MIN && longitude <= LON_MAX) {
-                            //check if the device id is already in the hashmap
-                            uint16_t value1 = 0;
-                            uint16_t value2 = 0;
-                            float lat = 0;
-                            float lon = 0;
-                            int t = hour_int * 100 +minutes_int;
-
-                            if(hashmap_get(map, dev_id_str, &value1, &value2, &lat, &lon)){
-                                //if value1 is zero or the new time is less than the old time, update the time
-                                if(value1 == 0 || t < value1){
-                                    if (KEEP_MIN_LOC) { //if we keep the first location, update the location
-                                        hashmap_set(map, dev_id_str, t, value2, latitude, longitude);
-                                        modified = true;
-                                    } else {
-                                        hashmap_set(map, dev_id_str, t, value2, lat, lon);
-                                    }
-                                    value1 = t;
-                                }
-                                if (value2 == 0 || t > value2){
-                                    if (!KEEP_MIN_LOC) { //if we keep the last location, update the location
-                                        hashmap_set(map, dev_id_str, value1, t, latitude, longitude);
-                                        modified = true;
-                                    } else {
-                                        hashmap_set(map, dev_id_str, value1, t, lat, lon);
-                                    }
-                                    value2 = t;
-                                }
-                            } else {
-                                //if it is not, add it to the hashmap
-                                hashmap_set(map, dev_id_str, t, t, latitude, longitude);
-                                modified = true;
-                            }
-                            if (modified) {
-                                int row, col;
-                                map_to_grid(latitude, longitude, &row, &col);
-
-                                // Increment the population count of the grid cell
-                                if (row >= 0 && row < GRID_ROWS && col >= 0 && col < GRID_COLS) {
-                                    grid_data[row][col]++;
-                                }
-                                if(lat != 0 && lon != 0){ //a previous location was stored, so we need to delete it from the map
-                                    map_to_grid(lat, lon, &row, &col);
-                                    if (row >= 0 && row < GRID_ROWS && col >= 0 && col < GRID_COLS) {
-                                        grid_data[row][col]--;
-                                    }
-                                }
-                            }
-                        }
-                    }
-                } else {
-                    continue;  // Skip the data if the time is not in the valid range
-                }
-                // Print the hour for debugging purposes
-            } else {
-                printf("Invalid timestamp format.\n");
+            if (!((time.hour >= 20 || time.hour < 4) && speed < MAX_ABS_SPEED && speed > -MAX_ABS_SPEED)) {
+                continue;
+            }
+
+            int32_t latitude, longitude;
+            if (!dev_ids->present[i] || dev_ids->strings[i].len == 0 ||
+                !columns[PQ_LATITUDE].present[i] || !columns[PQ_LONGITUDE].present[i] ||
+                !fixed_microdegrees_from_double(columns[PQ_LATITUDE].doubles[i], &latitude) ||
+                !fixed_microdegrees_from_double(columns[PQ_LONGITUDE].doubles[i], &longitude)) {
+                continue;
             }
+
+            add_ping(sink, dev_ids->strings[i].ptr, dev_ids->strings[i].len, time.hour * 100 + time.minute,
+                     latitude, longitude);
         }
     }
 
-    fclose(file);
+    parquet_close(&reader);
 }
 
-// Function to process all CSV files in a directory
-void process_csv_files_in_directory(HashMap* map, const char *directory_path) {
-    DIR *dir;
-    struct dirent *entry;
+// Whether [min_time, max_time] lies between 04:00 and 20:00 of one day, so
+// a block spanning it holds no night-time pings
+static bool daytime_only(int32_t min_time, int32_t max_time) {
+    int64_t day_start = (int64_t)min_time - (((int64_t)min_time % SECONDS_PER_DAY) + SECONDS_PER_DAY) % SECONDS_PER_DAY;
+    return min_time >= day_start + 4 * 3600 && max_time < day_start + 20 * 3600;
+}
 
-    // Open the directory
-    dir = opendir(directory_path);
-    if (!dir) {
-        perror("Failed to open directory");
+// Process the blocks of a ping file (see ping_convert) that start in
+// [begin, end). Blocks outside the bounds or wholly in daytime are skipped
+// from their headers without touching their columns.
+void process_ping_file(DeviceSink* sink, const char *filename, size_t begin, size_t end) {
+    PingFile file;
+    if (!ping_file_open(&file, filename)) {
+        fprintf(stderr, "Failed to open file\n");
         return;
     }
 
-    // Iterate over each entry in the directory
-    while ((entry = readdir(dir)) != NULL) {
-        // Skip "." and ".." entries
-        if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0) {
+    PingFilter bounds;
+    ping_filter_all(&bounds);
+    bounds.min_latitude = LAT_MIN;
+    bounds.max_latitude = LAT_MAX;
+    bounds.min_longitude = LON_MIN;
+    bounds.max_longitude = LON_MAX;
+
+    for (size_t b = 0; b < file.block_count; b++) {
+        // A block belongs to the range holding its first byte
+        const PingBlockHeader* header = &file.blocks[b];
+        if (header->offset < begin || header->offset >= end ||
+            !ping_file_block_matches(&file, b, &bounds) || daytime_only(header->min_time, header->max_time)) {
             continue;
         }
 
-        // Check if the entry is a regular file (not a directory)
-        if (entry->d_type == DT_REG) {
-            // Construct the full file path
-            char filepath[MAX_FIELD_LENGTH];
-            snprintf(filepath, sizeof(filepath), "%s/%s", directory_path, entry->d_name);
+        PingBlock block;
+        ping_file_block(&file, b, &block);
+        for (size_t i = 0; i < block.rows; i++) {
+            Timestamp time;
+            timestamp_from_epoch(block.epoch[i], &time);
+            int16_t speed = block.speed[i];
+            if (!((time.hour >= 20 || time.hour < 4) && speed < MAX_ABS_SPEED && speed > -MAX_ABS_SPEED)) {
+                continue;
+            }
+
+            size_t length;
+            const char* dev_id = ping_file_device(&file, block.device[i], &length);
+            if (dev_id) {
+                add_ping(sink, dev_id, length, time.hour * 100 + time.minute, block.latitude[i], block.longitude[i]);
+            }
+        }
+    }
+
+    ping_file_close(&file);
+}
+
+typedef struct {
+    DeviceSink* sinks;
+} IngestState;
+
+static void ingest_range_task(const char* path, size_t begin, size_t end, size_t worker, void* context) {
+    IngestState* state = context;
+    printf("Processing file: %s\n", path);
+    if (ping_is_file_name(path)) {
+        process_ping_file(&state->sinks[worker], path, begin, end);
+    } else if (parquet_is_file_name(path)) {
+        process_parquet_file(&state->sinks[worker], path, begin, end);
+    } else {
+        process_csv_file(&state->sinks[worker], path, begin, end);
+    }
+}
+
+// Run the ingest pool over files, one sink per worker
+static void ingest_files(const FileList* files, DeviceSink* sinks, size_t threads, size_t input_bytes) {
+    IngestState state = { sinks };
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    file_pool_run_ranges(files, threads, threads > 1 ? INGEST_RANGE_BYTES : 0, ingest_range_task, &state);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    double seconds = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) * 1e-9;
+    printf("Parsed %zu bytes in %.3f s (%.2f GB/s, %s scanner)\n",
+           input_bytes, seconds, seconds > 0 ? input_bytes / seconds / 1e9 : 0.0, csv_scanner_name());
+}
+
+// Function to process all CSV, Parquet and ping files of a directory. Files,
+// split into INGEST_RANGE_BYTES pieces at line (or row group, or block)
+// boundaries, go to a pool of `threads` workers, each with its own device
+// map; worker maps are folded into map once every file is done.
+void process_csv_files_in_directory(HashMap* map, const FileList* files, size_t input_bytes, size_t threads) {
+    DeviceSink* sinks = calloc(threads, sizeof(DeviceSink));
+    if (!sinks) {
+        return;
+    }
+    sinks[0].map = map;
+    for (size_t i = 1; i < threads; i++) {
+        sinks[i].map = hashmap_create(map->capacity / threads);
+        if (!sinks[i].map) {
+            threads = i;
+            break;
+        }
+    }
+
+    ingest_files(files, sinks, threads, input_bytes);
+
+    for (size_t i = 1; i < threads; i++) {
+        HashMap* worker_map = sinks[i].map;
+        for (size_t j = 0; j < worker_map->capacity; j++) {
+            const Entry* entry = &worker_map->slots[j];
+            if (entry->dist == 0) continue;
+            HashMapKey key;
+            hashmap_entry_key(entry, &key);
+            update_device(map, &key, entry->value1, entry->value2, entry->latitude, entry->longitude);
+        }
+        hashmap_destroy(worker_map);
+    }
+
+    free(sinks);
+}
+
+// Replay one spill partition's pings, in the order they were spilled, into map
+static bool load_spill_partition(const SpillSet* spill, size_t partition, HashMap* map) {
+    SpillReader reader;
+    if (!spill_reader_open(&reader, spill, partition, SPILL_BUFFER_BYTES)) {
+        spill_reader_close(&reader);
+        return false;
+    }
+
+    const char* dev_id;
+    size_t length, payload_size;
+    const void* payload;
+    bool ok = true;
+    while (spill_reader_next(&reader, &dev_id, &length, &payload, &payload_size)) {
+        SpilledPing ping;
+        if (payload_size != sizeof(ping)) {
+            ok = false;
+            break;
+        }
+        memcpy(&ping, payload, sizeof(ping));
+        HashMapKey key;
+        hashmap_key_init(&key, dev_id, length);
+        update_device(map, &key, ping.time, ping.time, ping.latitude, ping.longitude);
+    }
+    ok = ok && !reader.failed;
+    spill_reader_close(&reader);
+    return ok;
+}
+
+// Spill mode: ingest into device-hash partitions on disk, then build one
+// partition's map at a time and add its devices to the grid. A device's
+// pings all meet in one partition, so the grid matches the in-memory run.
+static bool process_files_spilled(const FileList* files, size_t input_bytes, size_t threads, size_t estimate,
+                                  size_t limit, const char* spill_directory, size_t expected_devices) {
+    size_t partitions = (estimate + limit / 2 - 1) / (limit / 2);
+    if (partitions < SPILL_MIN_PARTITIONS) partitions = SPILL_MIN_PARTITIONS;
+    size_t buffer_size = limit / 4 / partitions;
+    if (buffer_size > SPILL_BUFFER_BYTES) buffer_size = SPILL_BUFFER_BYTES;
+
+    SpillSet spill;
+    if (!spill_create(&spill, spill_directory, partitions, buffer_size)) {
+        fprintf(stderr, "Failed to create %zu spill runs in %s\n", partitions, spill_directory);
+        return false;
+    }
+    printf("Device map estimate %zu bytes over the %zu byte limit, spilling to %zu partitions\n",
+           estimate, limit, partitions);
+
+    DeviceSink* sinks = calloc(threads, sizeof(DeviceSink));
+    if (!sinks) {
+        spill_destroy(&spill);
+        return false;
+    }
+    for (size_t i = 0; i < threads; i++) {
+        sinks[i].spill = &spill;
+    }
+    ingest_files(files, sinks, threads, input_bytes);
+    size_t dropped = 0;
+    for (size_t i = 0; i < threads; i++) {
+        dropped += sinks[i].dropped;
+    }
+    free(sinks);
+    if (dropped > 0) {
+        fprintf(stderr, "Dropped %zu pings that could not be spilled\n", dropped);
+    }
 
-            // Process the CSV file
-            printf("Processing file: %s\n", filepath);
-            process_csv_file(map, filepath);
+    bool ok = spill_finish(&spill);
+    for (size_t p = 0; ok && p < partitions; p++) {
+        HashMap* map = hashmap_create(1024);
+        ok = map && hashmap_reserve(map, expected_devices / partitions) && load_spill_partition(&spill, p, map);
+        if (ok) {
+            printf("Partition %zu/%zu: %llu bytes spilled, %zu devices\n",
+                   p + 1, partitions, (unsigned long long)spill.partitions[p].bytes, map->size);
+            build_grid(map);
         }
+        hashmap_destroy(map);
+        spill_release(&spill, p);
     }
+    if (!ok) {
+        fprintf(stderr, "Failed writing or reading spill runs\n");
+    }
+    spill_destroy(&spill);
+    return ok;
+}
 
-    // Close the directory
-    closedir(dir);
+// Peak resident set size of the process so far, in bytes
+static size_t peak_rss_bytes(void) {
+    struct rusage usage;
+    return getrusage(RUSAGE_SELF, &usage) == 0 ? (size_t)usage.ru_maxrss << 10 : 0;
 }
 
-int main() {
-    HashMap* map = hashmap_create(2000003);
+enum { OPT_MEM_LIMIT = 256, OPT_SPILL_DIR, OPT_DEVICES, OPT_HUGE_PAGES };
+static const struct option LONG_OPTIONS[] = {
+    { "mem-limit", required_argument, NULL, OPT_MEM_LIMIT },
+    { "spill-dir", required_argument, NULL, OPT_SPILL_DIR },
+    { "devices", required_argument, NULL, OPT_DEVICES },
+    { "huge-pages", no_argument, NULL, OPT_HUGE_PAGES },
+    { NULL, 0, NULL, 0 }
+};
+
+int main(int argc, char *argv[]) {
+    size_t threads = 1;
+    size_t memory_limit = 0;
+    size_t expected_devices = 0;
+    const char* tmpdir = getenv("TMPDIR");
+    const char* spill_directory = tmpdir && *tmpdir ? tmpdir : "/tmp";
+    int opt;
+    while ((opt = getopt_long(argc, argv, "j:", LONG_OPTIONS, NULL)) != -1) {
+        switch (opt) {
+            case 'j':
+                threads = strtoul(optarg, NULL, 10);
+                if (threads < 1) threads = 1;
+                break;
+            case OPT_MEM_LIMIT:
+                memory_limit = (size_t)strtoull(optarg, NULL, 10) << 20;
+                break;
+            case OPT_SPILL_DIR:
+                spill_directory = optarg;
+                break;
+            case OPT_DEVICES:
+                expected_devices = (size_t)strtoull(optarg, NULL, 10);
+                break;
+            case OPT_HUGE_PAGES:
+                arena_set_huge_pages(true);
+                break;
+            default:
+                fprintf(stderr, "Usage: %s [-j threads] [--mem-limit mb] [--spill-dir directory] "
+                        "[--devices expected] [--huge-pages] [directory]\n", argv[0]);
+                return 1;
+        }
+    }
 
     // Directory containing the CSV files
-    const char *directory_path = "/Users/adityacode/Shade/july_csv";
+    const char *directory_path = optind < argc ? argv[optind] : "/Users/adityacode/Shade/july_csv";
+    FileList files = {0};
+    if (file_list_scan(&files, directory_path, NULL) == 0) {
+        perror("Failed to open directory");
+        file_list_free(&files);
+        return 1;
+    }
 
-    // Process all CSV files in the directory
-    process_csv_files_in_directory(map, directory_path);
+    size_t input_bytes = 0;
+    size_t estimate = 0;
+    for (size_t i = 0; i < files.count; i++) {
+        struct stat st;
+        if (stat(files.paths[i], &st) != 0) continue;
+        input_bytes += (size_t)st.st_size;
+        estimate += ping_is_file_name(files.paths[i]) ? PING_FILE_DEVICE_MAP_ESTIMATE((size_t)st.st_size)
+                                                      : DEVICE_MAP_ESTIMATE((size_t)st.st_size);
+    }
+
+    // Process all files in the directory, in memory unless the device map
+    // could outgrow half the memory limit
+    if (memory_limit > 0 && estimate > memory_limit / 2) {
+        if (!process_files_spilled(&files, input_bytes, threads, estimate, memory_limit, spill_directory,
+                                   expected_devices)) {
+            file_list_free(&files);
+            return 1;
+        }
+    } else {
+        HashMap* map = hashmap_create(DEVICE_MAP_CAPACITY);
+        if (!map || !hashmap_reserve(map, expected_devices)) {
+            fprintf(stderr, "Failed to allocate the device map\n");
+            hashmap_destroy(map);
+            file_list_free(&files);
+            return 1;
+        }
+        process_csv_files_in_directory(map, &files, input_bytes, threads);
+        build_grid(map);
+        hashmap_destroy(map);
+    }
+    file_list_free(&files);
 
     // Print the grid data (for debugging purposes)
     for (int i = 0; i < GRID_ROWS; i++) {
@@ -231,6 +567,6 @@ int main() {
     }
 
     fclose(f);
-    hashmap_destroy(map);
+    printf("Peak RSS %zu MB\n", peak_rss_bytes() >> 20);
     return 0;
-}
\ No newline at end of file
+}
@@ -2,116 +2,148 @@
 #include <stdlib.h>
 #include <string.h>
 #include <dirent.h> // For directory operations
-
-#define GRID_SIZE 0.02
-#define LAT_MIN 33.4
-#define LAT_MAX 34.3  // Fixed to include polygon
-#define LON_MIN -118.6
-#define LON_MAX -117.6
+#include "../C_Custom_Files/csv_reader.h"
+#include "../C_Custom_Files/timestamp.h"
+#include "../C_Custom_Files/fixed_point.h"
+#include "../C_Custom_Files/ping_file.h"
+
+// Coordinates are in microdegrees
+#define GRID_SIZE MICRODEGREES(0.02)
+#define LAT_MIN MICRODEGREES(33.4)
+#define LAT_MAX MICRODEGREES(34.3)  // Fixed to include polygon
+#define LON_MIN MICRODEGREES(-118.6)
+#define LON_MAX MICRODEGREES(-117.6)
+#define MAX_ABS_SPEED SPEED_CMS(3.0)  // Stationary: |speed| below 3 m/s
+
+// Division by GRID_SIZE as a multiply and shift: with the reciprocal rounded
+// up, the result is exact for offsets below 2^GRID_SHIFT / GRID_SIZE
+#define GRID_SHIFT 40
+#define GRID_RECIPROCAL (((1ULL << GRID_SHIFT) + GRID_SIZE - 1) / GRID_SIZE)
 
 #define GRID_ROWS 45  // (34.3-33.4)/0.02 = 45
 #define GRID_COLS 50
-#define MAX_LINE_LENGTH 10000
 #define MAX_FIELD_LENGTH 4096
 
+// Input columns used from each ping row
+#define COL_TIMESTAMP 3
+#define COL_LATITUDE 4
+#define COL_LONGITUDE 5
+#define COL_SPEED 10
+#define CSV_COLUMNS 11
+
 int grid_data[GRID_ROWS][GRID_COLS] = {{0}};
 
-// Function to map latitude and longitude to grid cell
-void map_to_grid(double latitude, double longitude, int *row, int *col) {
-    *row = (int)((latitude - LAT_MIN) / GRID_SIZE);
-    *col = (int)((longitude - LON_MIN) / GRID_SIZE);
+// Function to map latitude and longitude to grid cell. Points below the
+// minimums wrap to huge offsets, which the callers' bounds checks reject.
+void map_to_grid(int32_t latitude, int32_t longitude, int *row, int *col) {
+    *row = (int)(((uint64_t)(uint32_t)(latitude - LAT_MIN) * GRID_RECIPROCAL) >> GRID_SHIFT);
+    *col = (int)(((uint64_t)(uint32_t)(longitude - LON_MIN) * GRID_RECIPROCAL) >> GRID_SHIFT);
 }
 
 void process_csv_file(char *filename) {
-    FILE* file = fopen(filename, "r");
-    if (!file) {
+    CsvReader reader;
+    if (!csv_reader_open(&reader, filename)) {
         fprintf(stderr, "Failed to open file\n");
         return;
     }
 
-    char line[MAX_LINE_LENGTH + 2];
-    int line_number = 0;
-
-    while (fgets(line, sizeof(line), file)) {
-        int col = 0;
-        line_number++;
-        size_t len = strlen(line);
-
-        // Extract the latitude and longitude from the line
-        char *latitude_str = NULL;
-        char *longitude_str = NULL;
-        char *token = strtok(line, ",");
-        char *time_str = NULL;
-        char *speed_str = NULL;
-
-        while (token != NULL && col < 11) {
-            if (col == 3) {
-                time_str = token;
-            } else
-            if (col == 4) {
-                latitude_str = token;
-            } else if (col == 5) {
-                longitude_str = token;
-            }
-            else if (col == 10) {
-                speed_str = token;
+    CsvField fields[CSV_COLUMNS];
+    TimestampCache time_cache = {0};
+    int field_count;
+
+    while ((field_count = csv_reader_next(&reader, fields, CSV_COLUMNS)) >= 0) {
+        // Extract the timestamp, latitude, longitude and speed from the row
+        if (field_count < CSV_COLUMNS) {
+            continue;
+        }
+
+        // Decode the timestamp (which is in the format "YYYY-MM-DD HH:MM:SS")
+        Timestamp time;
+        if (!timestamp_parse(&time_cache, fields[COL_TIMESTAMP].ptr, fields[COL_TIMESTAMP].len, &time)) {
+            printf("Invalid timestamp format.\n");
+            continue;
+        }
+        int hour_int = time.hour;
+
+        //conver the speed to cm/s (an empty speed is unknown and reads as 0)
+        int16_t speed = 0;
+        fixed_parse_speed(fields[COL_SPEED].ptr, fields[COL_SPEED].len, &speed);
+
+        // Check if the hour is between 20:00 (8 PM) or before 04:00 (4 AM)
+        if (!((hour_int >= 20 || hour_int < 4) && speed < MAX_ABS_SPEED && speed > -MAX_ABS_SPEED)) {
+            continue;  // Skip the data if the time is not in the valid range
+        }
+
+        int32_t latitude, longitude;
+        if (!fixed_parse_microdegrees(fields[COL_LATITUDE].ptr, fields[COL_LATITUDE].len, &latitude) ||
+            !fixed_parse_microdegrees(fields[COL_LONGITUDE].ptr, fields[COL_LONGITUDE].len, &longitude)) {
+            continue;
+        }
+
+        // Check if the latitude and longitude are within the bounds
+        if (latitude >= LAT_MIN && latitude <= LAT_MAX &&
+            longitude >= LON_MIN && longitude <= LON_MAX) {
+
+            int row, col;
+            map_to_grid(latitude, longitude, &row, &col);
+
+            // Increment the population count of the grid cell
+            if (row >= 0 && row < GRID_ROWS && col >= 0 && col < GRID_COLS) {
+                grid_data[row][col]++;
             }
-            token = strtok(NULL, ",");
-            col++;
         }
-        if (time_str) {
-            // Extract the hour portion from the time_str (which is in the format "HH:MM:SS")
-            char *space = strchr(time_str, ' ');
-            if (space != NULL) {
-                // Move past the space to the beginning of the time portion
-                char *time_portion = space + 1;
-
-                // Extract the two digits before the first colon ':' (the hour part)
-                char hour[3];  // To store the two digits + null terminator
-                strncpy(hour, time_portion, 2);
-                hour[2] = '\0';  // Null terminate the string
-                
-                // Convert the time to an integer (hour)
-                int hour_int = atoi(hour);
-
-                //conver the speed to a float
-                float speed = atof(speed_str);
-
-                // Check if the hour is between 20:00 (8 PM) or before 04:00 (4 AM)
-                if ((hour_int >= 20 || hour_int < 4) && speed < 3 && speed > -3) {
-                    
-                    if (latitude_str && longitude_str) {
-                        double latitude = atof(latitude_str);
-                        double longitude = atof(longitude_str);
-                        
-                        // Check if the latitude and longitude are within the bounds
-                        if (latitude >= LAT_MIN && latitude <= LAT_MAX &&
-                            longitude >= LON_MIN && longitude <= LON_MAX) {
-                            
-                            int row, col;
-                            map_to_grid(latitude, longitude, &row, &col);
-
-                            // Increment the population count of the grid cell
-                            if (row >= 0 && row < GRID_ROWS && col >= 0 && col < GRID_COLS) {
-                                grid_data[row][col]++;
-                            }
-                        }
-                    }
-                } else {
-                    continue;  // Skip the data if the time is not in the valid range
-                }
+    }
 
-                // Print the hour for debugging purposes
-            } else {
-                printf("Invalid timestamp format.\n");
+    csv_reader_close(&reader);
+}
+
+// Count the night-time, stationary pings of a ping file (see ping_convert).
+// Blocks outside the bounds are skipped from their headers.
+void process_ping_file(const char *filename) {
+    PingFile file;
+    if (!ping_file_open(&file, filename)) {
+        fprintf(stderr, "Failed to open file\n");
+        return;
+    }
+
+    PingFilter bounds;
+    ping_filter_all(&bounds);
+    bounds.min_latitude = LAT_MIN;
+    bounds.max_latitude = LAT_MAX;
+    bounds.min_longitude = LON_MIN;
+    bounds.max_longitude = LON_MAX;
+
+    for (size_t b = 0; b < file.block_count; b++) {
+        if (!ping_file_block_matches(&file, b, &bounds)) {
+            continue;
+        }
+        PingBlock block;
+        ping_file_block(&file, b, &block);
+        for (size_t i = 0; i < block.rows; i++) {
+            Timestamp time;
+            timestamp_from_epoch(block.epoch[i], &time);
+            int16_t speed = block.speed[i];
+            if (!((time.hour >= 20 || time.hour < 4) && speed < MAX_ABS_SPEED && speed > -MAX_ABS_SPEED)) {
+                continue;
+            }
+
+            int32_t latitude = block.latitude[i];
+            int32_t longitude = block.longitude[i];
+            if (latitude >= LAT_MIN && latitude <= LAT_MAX &&
+                longitude >= LON_MIN && longitude <= LON_MAX) {
+                int row, col;
+                map_to_grid(latitude, longitude, &row, &col);
+                if (row >= 0 && row < GRID_ROWS && col >= 0 && col < GRID_COLS) {
+                    grid_data[row][col]++;
+                }
             }
         }
     }
 
-    fclose(file);
+    ping_file_close(&file);
 }
 
-// Function to process all CSV files in a directory
+// Function to process all CSV and ping files in a directory
 void process_csv_files_in_directory(const char *directory_path) {
     DIR *dir;
     struct dirent *entry;
@@ -136,9 +168,13 @@ void process_csv_files_in_directory(const char *directory_path) {
             char filepath[MAX_FIELD_LENGTH];
             snprintf(filepath, sizeof(filepath), "%s/%s", directory_path, entry->d_name);
 
-            // Process the CSV file
+            // Process the CSV (or ping) file
             printf("Processing file: %s\n", filepath);
-            process_csv_file(filepath);
+            if (ping_is_file_name(filepath)) {
+                process_ping_file(filepath);
+            } else {
+                process_csv_file(filepath);
+            }
         }
     }
 
@@ -0,0 +1,81 @@
+#!/bin/bash
+
+# End-to-end benchmark: generate synthetic ping CSVs with ping_gen, then run
+# location_processor and mobile_map_filter (mmap) on each size and record
+# wall time, throughput and peak RSS.
+#
+# Usage: bench.sh [rows...]        (default: 1000000 10000000 100000000)
+# Environment: BENCH_DIR    generated data and outputs (default /tmp/shade_bench)
+#              BENCH_THREADS ingest threads for both tools (default 1)
+#              BENCH_RESULTS results table, appended to (default bench_results.tsv)
+
+set -e
+
+SCRIPT_DIR="$( cd "$( dirname "${BASH_SOURCE[0]}" )" && pwd )"
+ROOT_DIR="$( cd "$SCRIPT_DIR/../../.." && pwd )"
+PING_GEN="$ROOT_DIR/C_Custom_Files/ping_gen"
+PROCESSOR="$SCRIPT_DIR/location_processor"
+MMAP="$ROOT_DIR/data_validation/mmap"
+BENCH_DIR="${BENCH_DIR:-/tmp/shade_bench}"
+BENCH_THREADS="${BENCH_THREADS:-1}"
+RESULTS="${BENCH_RESULTS:-$SCRIPT_DIR/bench_results.tsv}"
+
+if [ $# -eq 0 ]; then
+    set -- 1000000 10000000 100000000
+fi
+
+for tool in "$PING_GEN" "$PROCESSOR" "$MMAP"; do
+    if [ ! -x "$tool" ]; then
+        echo "Error: $tool is not built (run make bench)" >&2
+        exit 1
+    fi
+done
+
+now() {
+    date +%s.%N
+}
+
+# Print a one-line result and append it to the results table
+record() {
+    local tool=$1 rows=$2 bytes=$3 seconds=$4 rss=$5
+    local line
+    line=$(awk -v d="$(date +%Y-%m-%dT%H:%M:%S)" -v t="$tool" -v r="$rows" -v b="$bytes" -v s="$seconds" -v m="$rss" -v j="$BENCH_THREADS" \
+        'BEGIN { printf "%s\t%s\t%d\t%.0f\t%.0f\t%.3f\t%.0f\t%.1f\t%.1f\n", d, t, j, r, b, s, r / s, b / s / 1e6, m / 1048576 }')
+    echo "$line" >> "$RESULTS"
+    echo "$line" | awk -F'\t' '{ printf "  %-20s %12.0f rows  %8.3f s  %12.0f rows/s  %8.1f MB/s  peak RSS %8.1f MB\n", $2, $4, $6, $7, $8, $9 }'
+}
+
+if [ ! -f "$RESULTS" ]; then
+    printf "date\ttool\tthreads\trows\tbytes\tseconds\trows_per_second\tmb_per_second\tpeak_rss_mb\n" > "$RESULTS"
+fi
+
+for rows in "$@"; do
+    data="$BENCH_DIR/$rows"
+    out="$BENCH_DIR/out"
+    mkdir -p "$data" "$out"
+
+    # Generated data is reused across runs; the day directory layout is what
+    # location_processor expects, and mmap reads the day directory itself
+    if [ ! -f "$data/.complete" ]; then
+        echo "Generating $rows rows in $data..."
+        rm -rf "$data/day1"
+        "$PING_GEN" -n "$rows" "$data/day1"
+        touch "$data/.complete"
+    fi
+    bytes=$(find "$data/day1" -type f -name '*.csv' -printf '%s\n' | awk '{ total += $1 } END { printf "%.0f", total }')
+    echo "$rows rows ($bytes bytes):"
+
+    start=$(now)
+    "$PROCESSOR" -j "$BENCH_THREADS" -o "$out/paths.store" --report "$out/run_report.json" "$data" 2> "$out/location_processor.log"
+    end=$(now)
+    rss=$(sed -n 's/.*"peak_rss_bytes": \([0-9]*\).*/\1/p' "$out/run_report.json")
+    record location_processor "$rows" "$bytes" "$(awk -v a="$start" -v b="$end" 'BEGIN { print b - a }')" "$rss"
+
+    start=$(now)
+    (cd "$out" && "$MMAP" -j "$BENCH_THREADS" "$data/day1" > "$out/mmap.log" 2>&1)
+    end=$(now)
+    rss=$(sed -n 's/^Peak RSS \([0-9]*\) MB$/\1/p' "$out/mmap.log")
+    record mobile_map_filter "$rows" "$bytes" "$(awk -v a="$start" -v b="$end" 'BEGIN { print b - a }')" "$((rss * 1048576))"
+done
+
+echo "Results appended to $RESULTS"
@@ -1,3 +1,4 @@
+#define _GNU_SOURCE
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -5,23 +6,102 @@
 #include <sys/stat.h>
 #include <dirent.h>
 #include <math.h>
-#include <stdarg.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <pthread.h>
+#include <sys/file.h>
+#include <getopt.h>
 #include "../../../C_Custom_Files/hashmap.h"
-
-#define MAX_SPEED 7.0  // Maximum speed in m/s (25 km/h)
+#include "../../../C_Custom_Files/location_map.h"
+#include "../../../C_Custom_Files/file_pool.h"
+#include "../../../C_Custom_Files/csv_reader.h"
+#include "../../../C_Custom_Files/timestamp.h"
+#include "../../../C_Custom_Files/fixed_point.h"
+#include "../../../C_Custom_Files/parquet_reader.h"
+#include "../../../C_Custom_Files/ping_file.h"
+#include "../../../C_Custom_Files/path_store.h"
+#include "../../../C_Custom_Files/spill.h"
+#include "../../../C_Custom_Files/run_stats.h"
+
+#define MAX_SPEED SPEED_CMS(7.0)  // Maximum speed, 7 m/s (25 km/h), in cm/s
 #define MAX_TIME_DIFF 14400  // 4 hours in seconds
-#define GRID_SIZE 0.01  // Grid size in degrees (approximately 1km)
-#define MAX_LINE_LENGTH 1024
-#define MAX_PATH_LINE_LENGTH 4096  // Increased buffer for path lines
-
-// Debug logging function
-static void debug_log(const char* format, ...) {
-    va_list args;
-    va_start(args, format);
-    vfprintf(stderr, format, args);
-    fprintf(stderr, "\n");
-    va_end(args);
-}
+#define GRID_SIZE MICRODEGREES(0.01)  // Grid size, 0.01 degrees (approximately 1km), in microdegrees
+#define INGEST_RANGE_BYTES (64u << 20)  // Work unit when splitting files across workers
+#define INSERT_SAMPLE_SHIFT 6  // Time one ping insert in 2^6 and scale, keeping clock reads off the hot path
+#define DEFAULT_RUN_REPORT "run_report.json"  // Written at exit when --report is not given
+
+// Input columns used from each ping row
+#define COL_ADVERTISER_ID 0
+#define COL_TIMESTAMP 3
+#define COL_LATITUDE 4
+#define COL_LONGITUDE 5
+#define COL_SPEED 10
+#define CSV_COLUMNS 11
+
+// The same columns by name in Parquet input
+static const char* const PARQUET_COLUMNS[] = {
+    "advertiser_id", "local_location_at", "latitude", "longitude", "speed"
+};
+enum { PQ_ADVERTISER_ID, PQ_TIMESTAMP, PQ_LATITUDE, PQ_LONGITUDE, PQ_SPEED, PQ_COLUMNS };
+#define DEFAULT_PATH_STORE "paths.store"  // Output when -o is not given
+
+// Timestamp sort: arrays up to INSERTION_SORT_MAX pings use insertion sort,
+// longer ones an LSD radix sort on the time since their earliest ping. Two
+// 9-bit digits cover 2^18 s (~3 days); a day needs only 17 bits.
+#define INSERTION_SORT_MAX 32
+#define RADIX_DIGIT_BITS 9
+#define RADIX_BUCKETS (1u << RADIX_DIGIT_BITS)
+#define RADIX_PASSES 2
+#define RADIX_KEY_RANGE (1ull << (RADIX_DIGIT_BITS * RADIX_PASSES))
+
+// A day map holds a ping in ~24-48 bytes against ~150-250 bytes of CSV text,
+// so half the input size is a safe up-front reservation for the budget
+#define DAY_MAP_ESTIMATE(input_bytes) ((input_bytes) / 2)
+// Ping files spend ~18 bytes a ping, so the map outgrows them instead
+#define PING_FILE_MAP_ESTIMATE(input_bytes) ((input_bytes) * 3)
+
+// Spill mode (--mem-limit): a day whose map estimate is over its share of
+// the limit is split into partitions estimated at half the share each,
+// leaving the other half for buffers and the path stage
+#define SPILL_BUFFER_BYTES (256u << 10)  // Per-partition write buffer, and the read buffer
+#define SPILL_MIN_PARTITIONS 2
+
+// Global cap on the memory held by day maps alive at the same time (-m)
+typedef struct {
+    pthread_mutex_t lock;
+    pthread_cond_t released;
+    size_t limit;               // Bytes; 0 means unlimited
+    size_t reserved;            // Bytes currently reserved by running days
+} MemoryBudget;
+
+// Per-advertiser timestamp sort: a reusable radix scratch array plus
+// counts of which method each array took
+typedef struct {
+    LocationPoint* scratch;
+    size_t capacity;
+    size_t presorted;           // Already in order, left alone
+    size_t insertion;
+    size_t radix;
+    size_t fallback;            // qsort: span too wide for the radix key
+    double seconds;
+} PointSorter;
+
+// Shared state for the per-day workers
+typedef struct {
+    size_t ingest_threads;      // Workers per day (-j)
+    MemoryBudget budget;
+    PathStoreWriter paths;      // Shared by all days
+    size_t day_memory_limit;    // --mem-limit share of one running day; 0 keeps days in memory
+    const char* spill_directory;
+} DayRunner;
+
+// Where an ingest worker puts pings: its own map, or in spill mode the
+// day's partitions
+typedef struct {
+    LocationMap* map;
+    SpillSet* spill;
+} PingSink;
 
 // Comparison function for qsort
 static int compare_timestamps(const void* a, const void* b) {
@@ -30,180 +110,477 @@ static int compare_timestamps(const void* a, const void* b) {
     return (pa->timestamp > pb->timestamp) - (pa->timestamp < pb->timestamp);
 }
 
-// Function to ensure a directory exists
-static void ensure_directory_exists(const char* path) {
-    char tmp[256];
-    char *p = NULL;
-    size_t len;
-
-    snprintf(tmp, sizeof(tmp), "%s", path);
-    len = strlen(tmp);
-    if (tmp[len - 1] == '/')
-        tmp[len - 1] = 0;
-    for (p = tmp + 1; *p; p++) {
-        if (*p == '/') {
-            *p = 0;
-            mkdir(tmp, 0700);
-            *p = '/';
+static double elapsed_seconds(const struct timespec* start, const struct timespec* end) {
+    return (end->tv_sec - start->tv_sec) + (end->tv_nsec - start->tv_nsec) * 1e-9;
+}
+
+// Stable insertion sort by timestamp, for short arrays
+static void insertion_sort_points(LocationPoint* points, size_t count) {
+    for (size_t i = 1; i < count; i++) {
+        LocationPoint point = points[i];
+        size_t j = i;
+        while (j > 0 && points[j - 1].timestamp > point.timestamp) {
+            points[j] = points[j - 1];
+            j--;
         }
+        points[j] = point;
     }
-    mkdir(tmp, 0700);
 }
 
-// Function to process a single CSV file
-static void process_csv_file(const char* filename, HashMap* map) {
-    debug_log("Processing file: %s", filename);
-    
-    FILE* file = fopen(filename, "r");
-    if (!file) {
-        debug_log("Error opening file: %s", filename);
+// Stable LSD radix sort on the timestamp relative to the earliest one.
+// Needs a scratch array as long as points; passes whose digit is the same
+// for every point are skipped.
+static void radix_sort_points(LocationPoint* points, LocationPoint* scratch, size_t count, time_t base) {
+    size_t counts[RADIX_PASSES][RADIX_BUCKETS] = {{0}};
+    for (size_t i = 0; i < count; i++) {
+        uint32_t key = (uint32_t)(points[i].timestamp - base);
+        for (int pass = 0; pass < RADIX_PASSES; pass++) {
+            counts[pass][(key >> (pass * RADIX_DIGIT_BITS)) & (RADIX_BUCKETS - 1)]++;
+        }
+    }
+
+    LocationPoint* from = points;
+    LocationPoint* to = scratch;
+    for (int pass = 0; pass < RADIX_PASSES; pass++) {
+        int shift = pass * RADIX_DIGIT_BITS;
+        size_t* bucket = counts[pass];
+        if (bucket[((uint32_t)(from[0].timestamp - base) >> shift) & (RADIX_BUCKETS - 1)] == count) continue;
+
+        size_t offset = 0;
+        for (size_t b = 0; b < RADIX_BUCKETS; b++) {
+            size_t n = bucket[b];
+            bucket[b] = offset;
+            offset += n;
+        }
+        for (size_t i = 0; i < count; i++) {
+            uint32_t key = (uint32_t)(from[i].timestamp - base);
+            to[bucket[(key >> shift) & (RADIX_BUCKETS - 1)]++] = from[i];
+        }
+        LocationPoint* swap = from;
+        from = to;
+        to = swap;
+    }
+    if (from != points) memcpy(points, from, count * sizeof(LocationPoint));
+}
+
+// Grow the radix scratch array to hold count points
+static bool reserve_scratch(PointSorter* sorter, size_t count) {
+    if (count <= sorter->capacity) return true;
+    size_t capacity = sorter->capacity ? sorter->capacity : 1024;
+    while (capacity < count) capacity *= 2;
+    LocationPoint* scratch = realloc(sorter->scratch, capacity * sizeof(LocationPoint));
+    if (!scratch) return false;
+    sorter->scratch = scratch;
+    sorter->capacity = capacity;
+    return true;
+}
+
+// Sort one advertiser's pings by timestamp, picking the cheapest method:
+// nothing when already in order (the usual case within a part file),
+// insertion sort when short, radix sort when the pings span less than
+// RADIX_KEY_RANGE seconds, qsort otherwise. All of them keep equal
+// timestamps in input order.
+static void sort_points(PointSorter* sorter, LocationPoint* points, size_t count) {
+    uint64_t start = run_clock_ns();
+
+    bool sorted = true;
+    time_t min_time = count > 0 ? points[0].timestamp : 0;
+    time_t max_time = min_time;
+    for (size_t i = 1; i < count; i++) {
+        time_t t = points[i].timestamp;
+        if (t < points[i - 1].timestamp) sorted = false;
+        if (t < min_time) min_time = t;
+        if (t > max_time) max_time = t;
+    }
+
+    if (sorted) {
+        sorter->presorted++;
+    } else if (count <= INSERTION_SORT_MAX) {
+        insertion_sort_points(points, count);
+        sorter->insertion++;
+    } else if ((uint64_t)(max_time - min_time) < RADIX_KEY_RANGE && reserve_scratch(sorter, count)) {
+        radix_sort_points(points, sorter->scratch, count, min_time);
+        sorter->radix++;
+    } else {
+        qsort(points, count, sizeof(LocationPoint), compare_timestamps);
+        sorter->fallback++;
+    }
+
+    sorter->seconds += (run_stage_add(STAGE_SORT, start) - start) * 1e-9;
+}
+
+// Wait until bytes fit in the budget; a day always runs when nothing else holds memory
+static void budget_acquire(MemoryBudget* budget, size_t bytes) {
+    pthread_mutex_lock(&budget->lock);
+    while (budget->limit > 0 && budget->reserved > 0 && budget->reserved + bytes > budget->limit) {
+        pthread_cond_wait(&budget->released, &budget->lock);
+    }
+    budget->reserved += bytes;
+    pthread_mutex_unlock(&budget->lock);
+}
+
+// Replace a reservation with a measured size
+static void budget_adjust(MemoryBudget* budget, size_t from, size_t to) {
+    pthread_mutex_lock(&budget->lock);
+    budget->reserved = budget->reserved - from + to;
+    if (to < from) pthread_cond_broadcast(&budget->released);
+    pthread_mutex_unlock(&budget->lock);
+}
+
+static void budget_release(MemoryBudget* budget, size_t bytes) {
+    budget_adjust(budget, bytes, 0);
+}
+
+// Append one decoded ping to its advertiser's list unless it is too fast.
+// Shared by the CSV, Parquet and ping file readers; returns whether it was stored.
+static bool add_ping(PingSink* sink, const char* advertiser_id, size_t length, time_t timestamp,
+                     int32_t latitude, int32_t longitude, int16_t speed) {
+    // Skip if speed is too high
+    if (speed >= MAX_SPEED) {
+        return false;
+    }
+
+    LocationPoint point;
+    memset(&point, 0, sizeof(point));  // No stray padding bytes in spill runs
+    point.timestamp = timestamp;
+    point.latitude = latitude;
+    point.longitude = longitude;
+    point.speed = speed;
+
+    RunCounters* counters = run_counters();
+    bool timed = (counters->ticks++ & ((1u << INSERT_SAMPLE_SHIFT) - 1)) == 0;
+    uint64_t start = timed ? run_clock_ns() : 0;
+    bool stored;
+    if (sink->spill) {
+        stored = spill_add(sink->spill, advertiser_id, length, &point, sizeof(point));
+    } else {
+        HashMapKey key;
+        hashmap_key_init(&key, advertiser_id, length);
+        stored = location_map_append(sink->map, &key, &point);
+    }
+    if (timed) {
+        counters->stage_ns[STAGE_INSERT] += (run_clock_ns() - start) << INSERT_SAMPLE_SHIFT;
+    }
+    counters->pings += stored;
+    return stored;
+}
+
+// Book a row loop that started at start_ns as parsing: its time less the
+// insert time add_ping booked meanwhile (insert_ns is the insert total at
+// the start). Also counts the rows.
+static void end_parse_stage(uint64_t start_ns, uint64_t insert_ns, size_t rows) {
+    RunCounters* counters = run_counters();
+    uint64_t elapsed = run_clock_ns() - start_ns;
+    uint64_t inserted = counters->stage_ns[STAGE_INSERT] - insert_ns;
+    counters->stage_ns[STAGE_PARSE] += elapsed > inserted ? elapsed - inserted : 0;
+    counters->rows += rows;
+}
+
+// Function to process the rows of a CSV file that start in [begin, end)
+static void process_csv_file(const char* filename, size_t begin, size_t end, PingSink* sink) {
+    log_debug("Processing file: %s [%zu, %zu)", filename, begin, end);
+
+    uint64_t start = run_clock_ns();
+    CsvReader reader;
+    if (!csv_reader_open_range(&reader, filename, begin, end)) {
+        log_error("Error opening file: %s", filename);
         return;
     }
+    start = run_stage_add(STAGE_READ, start);
+    uint64_t insert_ns = run_counters()->stage_ns[STAGE_INSERT];
 
-    char line[MAX_LINE_LENGTH + 2];
+    CsvField fields[CSV_COLUMNS];
+    TimestampCache time_cache = {0};
     int line_count = 0;
     int valid_entries = 0;
+    int field_count;
 
-    while (fgets(line, sizeof(line), file)) {
+    while ((field_count = csv_reader_next(&reader, fields, CSV_COLUMNS)) >= 0) {
         line_count++;
-        size_t len = strlen(line);
-        if (len > 0 && line[len-1] == '\n') {
-            line[len-1] = '\0';  // Remove newline
-        }
-
-        // Parse CSV line using strtok
-        char* advertiser_id = NULL;
-        char* time_str = NULL;
-        char* latitude_str = NULL;
-        char* longitude_str = NULL;
-        char* speed_str = NULL;
-        
-        int col = 0;
-        char* token = strtok(line, ",");
-        
-        while (token != NULL && col < 11) {
-            switch (col) {
-                case 0:  // advertiser_id
-                    advertiser_id = token;
-                    break;
-                case 3:  // timestamp
-                    time_str = token;
-                    break;
-                case 4:  // latitude
-                    latitude_str = token;
-                    break;
-                case 5:  // longitude
-                    longitude_str = token;
-                    break;
-                case 10:  // speed
-                    speed_str = token;
-                    break;
-            }
-            token = strtok(NULL, ",");
-            col++;
-        }
 
         // Skip if we didn't get all required fields
-        if (!advertiser_id || !time_str || !latitude_str || !longitude_str || !speed_str) {
+        if (field_count < CSV_COLUMNS) {
             continue;
         }
-
-        // Convert timestamp string to time_t
-        struct tm tm = {0};
-        if (strptime(time_str, "%Y-%m-%d %H:%M:%S", &tm) == NULL) {
+        const CsvField* advertiser_id = &fields[COL_ADVERTISER_ID];
+        if (advertiser_id->len == 0) {
             continue;
         }
-        time_t timestamp = mktime(&tm);
-
-        // Convert coordinates and speed
-        double latitude = atof(latitude_str);
-        double longitude = atof(longitude_str);
-        double speed = atof(speed_str);
 
-        // Skip if speed is too high
-        if (speed >= MAX_SPEED) {
+        // Convert the timestamp (UTC) to epoch seconds
+        Timestamp time;
+        if (!timestamp_parse(&time_cache, fields[COL_TIMESTAMP].ptr, fields[COL_TIMESTAMP].len, &time)) {
             continue;
         }
+        time_t timestamp = (time_t)time.epoch;
 
-        // Store location in hashmap
-        if (!hashmap_set(map, advertiser_id, timestamp, latitude, longitude, speed)) {
+        // Convert coordinates to microdegrees and speed to cm/s (an empty
+        // speed is unknown and kept as 0)
+        int32_t latitude, longitude;
+        if (!fixed_parse_microdegrees(fields[COL_LATITUDE].ptr, fields[COL_LATITUDE].len, &latitude) ||
+            !fixed_parse_microdegrees(fields[COL_LONGITUDE].ptr, fields[COL_LONGITUDE].len, &longitude)) {
             continue;
         }
-        valid_entries++;
+        int16_t speed = 0;
+        fixed_parse_speed(fields[COL_SPEED].ptr, fields[COL_SPEED].len, &speed);
+
+        valid_entries += add_ping(sink, advertiser_id->ptr, advertiser_id->len, timestamp, latitude, longitude, speed);
     }
 
-    debug_log("File %s: processed %d lines, stored %d entries", 
+    end_parse_stage(start, insert_ns, (size_t)line_count);
+    log_debug("File %s: processed %d lines, stored %d entries",
               filename, line_count, valid_entries);
-    fclose(file);
+    csv_reader_close(&reader);
 }
 
-// Function to process a single day directory
-static void process_day_directory(const char* day_dir, HashMap* map) {
-    debug_log("Processing day directory: %s", day_dir);
-    
-    DIR* dir = opendir(day_dir);
-    if (!dir) {
-        debug_log("Error opening directory: %s", day_dir);
+// Function to process the row groups of a Parquet file that start in
+// [begin, end). Only the five ping columns are decoded; null speeds read as
+// 0 like empty CSV fields, and other nulls skip the row.
+static void process_parquet_file(const char* filename, size_t begin, size_t end, PingSink* sink) {
+    log_debug("Processing file: %s [%zu, %zu)", filename, begin, end);
+
+    uint64_t start = run_clock_ns();
+    ParquetReader reader;
+    if (!parquet_open(&reader, filename, PARQUET_COLUMNS, PQ_COLUMNS)) {
+        log_error("Error opening file: %s (%s)", filename, reader.error);
+        parquet_close(&reader);
+        return;
+    }
+    const ParquetColumn* columns = reader.columns;
+    if (columns[PQ_ADVERTISER_ID].type != PARQUET_BYTE_ARRAY || columns[PQ_TIMESTAMP].type != PARQUET_BYTE_ARRAY ||
+        (columns[PQ_LATITUDE].type != PARQUET_DOUBLE && columns[PQ_LATITUDE].type != PARQUET_FLOAT) ||
+        (columns[PQ_LONGITUDE].type != PARQUET_DOUBLE && columns[PQ_LONGITUDE].type != PARQUET_FLOAT) ||
+        (columns[PQ_SPEED].type != PARQUET_DOUBLE && columns[PQ_SPEED].type != PARQUET_FLOAT)) {
+        log_error("Error: unexpected column types in %s", filename);
+        parquet_close(&reader);
         return;
     }
 
-    struct dirent* entry;
-    while ((entry = readdir(dir)) != NULL) {
-        // Skip . and .. directories
-        if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0) {
+    TimestampCache time_cache = {0};
+    size_t row_count = 0;
+    int valid_entries = 0;
+
+    for (size_t g = 0; g < reader.row_group_count; g++) {
+        // A row group belongs to the range holding its first byte
+        if (reader.row_groups[g].offset < begin || reader.row_groups[g].offset >= end) {
             continue;
         }
+        if (!parquet_read_row_group(&reader, g)) {
+            log_error("Error reading %s: %s", filename, reader.error);
+            break;
+        }
+        row_count += reader.group_rows;
+        start = run_stage_add(STAGE_READ, start);
+        uint64_t insert_ns = run_counters()->stage_ns[STAGE_INSERT];
+
+        const ParquetColumn* ids = &columns[PQ_ADVERTISER_ID];
+        const ParquetColumn* times = &columns[PQ_TIMESTAMP];
+        const ParquetColumn* speeds = &columns[PQ_SPEED];
+        for (size_t i = 0; i < reader.group_rows; i++) {
+            if (!ids->present[i] || ids->strings[i].len == 0 || !times->present[i]) {
+                continue;
+            }
+            Timestamp time;
+            if (!timestamp_parse(&time_cache, times->strings[i].ptr, times->strings[i].len, &time)) {
+                continue;
+            }
+            int32_t latitude, longitude;
+            if (!columns[PQ_LATITUDE].present[i] || !columns[PQ_LONGITUDE].present[i] ||
+                !fixed_microdegrees_from_double(columns[PQ_LATITUDE].doubles[i], &latitude) ||
+                !fixed_microdegrees_from_double(columns[PQ_LONGITUDE].doubles[i], &longitude)) {
+                continue;
+            }
+            int16_t speed = 0;
+            if (speeds->present[i]) {
+                fixed_speed_from_double(speeds->doubles[i], &speed);
+            }
 
-        char full_path[1024];
-        snprintf(full_path, sizeof(full_path), "%s/%s", day_dir, entry->d_name);
+            valid_entries += add_ping(sink, ids->strings[i].ptr, ids->strings[i].len, (time_t)time.epoch,
+                                      latitude, longitude, speed);
+        }
+        end_parse_stage(start, insert_ns, reader.group_rows);
+        start = run_clock_ns();
+    }
 
-        struct stat st;
-        if (stat(full_path, &st) == -1) {
+    log_debug("File %s: processed %zu rows, stored %d entries", filename, row_count, valid_entries);
+    parquet_close(&reader);
+}
+
+// Function to process the blocks of a ping file (see ping_convert) that
+// start in [begin, end). Pings were decoded at conversion time, so this is
+// a scan over the mapped columns.
+static void process_ping_file(const char* filename, size_t begin, size_t end, PingSink* sink) {
+    log_debug("Processing file: %s [%zu, %zu)", filename, begin, end);
+
+    uint64_t start = run_clock_ns();
+    PingFile file;
+    if (!ping_file_open(&file, filename)) {
+        log_error("Error opening file: %s", filename);
+        return;
+    }
+    start = run_stage_add(STAGE_READ, start);
+    uint64_t insert_ns = run_counters()->stage_ns[STAGE_INSERT];
+
+    size_t row_count = 0;
+    int valid_entries = 0;
+    for (size_t b = 0; b < file.block_count; b++) {
+        // A block belongs to the range holding its first byte
+        if (file.blocks[b].offset < begin || file.blocks[b].offset >= end) {
             continue;
         }
+        PingBlock block;
+        ping_file_block(&file, b, &block);
+        row_count += block.rows;
+        for (size_t i = 0; i < block.rows; i++) {
+            size_t length;
+            const char* advertiser_id = ping_file_device(&file, block.device[i], &length);
+            if (!advertiser_id) {
+                continue;
+            }
+            valid_entries += add_ping(sink, advertiser_id, length, (time_t)block.epoch[i],
+                                      block.latitude[i], block.longitude[i], block.speed[i]);
+        }
+    }
+
+    end_parse_stage(start, insert_ns, row_count);
+    log_debug("File %s: processed %zu rows, stored %d entries", filename, row_count, valid_entries);
+    ping_file_close(&file);
+}
+
+// Per-worker ingest state: each worker appends into its own sink
+typedef struct {
+    PingSink* sinks;
+} DayIngest;
+
+static void ingest_range_task(const char* path, size_t begin, size_t end, size_t worker, void* context) {
+    DayIngest* ingest = context;
+    if (ping_is_file_name(path)) {
+        process_ping_file(path, begin, end, &ingest->sinks[worker]);
+    } else if (parquet_is_file_name(path)) {
+        process_parquet_file(path, begin, end, &ingest->sinks[worker]);
+    } else {
+        process_csv_file(path, begin, end, &ingest->sinks[worker]);
+    }
+}
+
+// Function to ingest a day's CSV and Parquet files. With threads > 1 the files,
+// split into INGEST_RANGE_BYTES pieces at line (or row group) boundaries, are
+// handed to a worker pool; worker 0 fills map directly and the other workers'
+// maps are merged into it at the end.
+static void process_day_directory(const FileList* files, LocationMap* map, size_t threads) {
+    if (threads < 1) threads = 1;
+
+    PingSink* sinks = calloc(threads, sizeof(PingSink));
+    if (!sinks) {
+        return;
+    }
+    sinks[0].map = map;
+    for (size_t i = 1; i < threads; i++) {
+        sinks[i].map = location_map_create(1000);
+        if (!sinks[i].map) {
+            log_error("Error creating worker hashmap, using %zu workers", i);
+            threads = i;
+            break;
+        }
+    }
 
-        if (S_ISREG(st.st_mode) && strstr(entry->d_name, ".csv") != NULL) {
-            // Process CSV file
-            process_csv_file(full_path, map);
+    DayIngest ingest = { sinks };
+    file_pool_run_ranges(files, threads, threads > 1 ? INGEST_RANGE_BYTES : 0, ingest_range_task, &ingest);
+
+    for (size_t i = 1; i < threads; i++) {
+        run_stats_map(sinks[i].map->devices.size, sinks[i].map->devices.resize_count);
+        if (!location_map_merge(map, sinks[i].map)) {
+            log_error("Error merging worker %zu results", i);
         }
     }
 
-    closedir(dir);
+    free(sinks);
+}
+
+// Ingest a day's files into spill partitions instead of a map. Every
+// worker appends to the same partitions; an advertiser's pings all land
+// in one partition, in input order when threads is 1.
+static bool spill_day_directory(const FileList* files, SpillSet* spill, size_t threads) {
+    if (threads < 1) threads = 1;
+
+    PingSink* sinks = calloc(threads, sizeof(PingSink));
+    if (!sinks) {
+        return false;
+    }
+    for (size_t i = 0; i < threads; i++) {
+        sinks[i].spill = spill;
+    }
+
+    DayIngest ingest = { sinks };
+    file_pool_run_ranges(files, threads, threads > 1 ? INGEST_RANGE_BYTES : 0, ingest_range_task, &ingest);
+    free(sinks);
+    return spill_finish(spill);
+}
+
+// Load one spill partition into a fresh map, keeping each advertiser's
+// pings in the order they were spilled. The replay books to the insert
+// stage: reading the run back is a small part of building the map.
+static bool load_spill_partition(const SpillSet* spill, size_t partition, LocationMap* map) {
+    uint64_t start = run_clock_ns();
+    SpillReader reader;
+    if (!spill_reader_open(&reader, spill, partition, SPILL_BUFFER_BYTES)) {
+        spill_reader_close(&reader);
+        return false;
+    }
+
+    const char* advertiser_id;
+    size_t length, payload_size;
+    const void* payload;
+    bool ok = true;
+    while (ok && spill_reader_next(&reader, &advertiser_id, &length, &payload, &payload_size)) {
+        LocationPoint point;
+        if (payload_size != sizeof(point)) {
+            ok = false;
+            break;
+        }
+        memcpy(&point, payload, sizeof(point));
+        HashMapKey key;
+        hashmap_key_init(&key, advertiser_id, length);
+        ok = location_map_append(map, &key, &point);
+    }
+    ok = ok && !reader.failed;
+    spill_reader_close(&reader);
+    run_stage_add(STAGE_INSERT, start);
+    return ok;
 }
 
 // Function to process all advertisers and create travel paths
-static void process_advertiser_data(HashMap* map) {
-    debug_log("Processing advertiser data from hashmap...");
+static void process_advertiser_data(LocationMap* map, PathStoreWriter* paths) {
+    log_info("Processing advertiser data from hashmap...");
     
-    HashMapIterator* iterator = hashmap_iterator_create(map);
+    LocationMapIterator* iterator = location_map_iterator_create(map);
     if (!iterator) {
-        debug_log("Error creating hashmap iterator");
+        log_error("Error creating hashmap iterator");
         return;
     }
 
-    char* advertiser_id;
+    const char* advertiser_id;
     LocationArray* locations;
     int advertiser_count = 0;
     int total_paths = 0;
 
-    // Create a map to store paths by grid location
-    typedef struct {
-        char* filename;
-        FILE* file;
-        int is_new;
-    } GridFile;
-
-    GridFile* grid_files = NULL;
-    size_t grid_files_count = 0;
-    size_t grid_files_capacity = 0;
+    // Points of the path being stored, grown to the longest path
+    PathStorePoint* points = NULL;
+    size_t point_capacity = 0;
+    PointSorter sorter = {0};
 
-    while (hashmap_iterator_next(iterator, &advertiser_id, &locations)) {
+    RunCounters* counters = run_counters();
+    while (location_map_iterator_next(iterator, &advertiser_id, &locations)) {
         advertiser_count++;
-        debug_log("Processing advertiser %s with %zu locations", 
-                 advertiser_id, locations->count);
+        log_trace("Processing advertiser %s with %zu locations",
+                  advertiser_id, locations->count);
 
         // Sort locations by timestamp
-        qsort(locations->points, locations->count, sizeof(LocationPoint), compare_timestamps);
+        sort_points(&sorter, locations->points, locations->count);
+
+        // Segment time is the path loop less the writes inside it
+        uint64_t segment_start = run_clock_ns();
+        uint64_t write_ns = counters->stage_ns[STAGE_WRITE];
 
         // Process locations into travel paths
         for (size_t i = 0; i < locations->count; i++) {
@@ -220,168 +597,300 @@ static void process_advertiser_data(HashMap* map) {
             }
 
             if (path_length > 1) {
-                // Create path directory structure
-                char path[256];
-                int lat_grid = (int)(start->latitude / GRID_SIZE);
-                int lon_grid = (int)(start->longitude / GRID_SIZE);
-                snprintf(path, sizeof(path), "paths/%d/%d", lat_grid, lon_grid);
-                ensure_directory_exists(path);
-
-                // Find or create grid file
-                char filename[512];
-                snprintf(filename, sizeof(filename), "%s/paths.csv", path);
-                
-                GridFile* grid_file = NULL;
-                for (size_t k = 0; k < grid_files_count; k++) {
-                    if (strcmp(grid_files[k].filename, filename) == 0) {
-                        grid_file = &grid_files[k];
+                // Integer division truncates toward zero like the old (int) cast
+                int lat_grid = start->latitude / GRID_SIZE;
+                int lon_grid = start->longitude / GRID_SIZE;
+
+                if (path_length > point_capacity) {
+                    size_t capacity = point_capacity ? point_capacity : 64;
+                    while (capacity < path_length) capacity *= 2;
+                    PathStorePoint* grown = realloc(points, capacity * sizeof(PathStorePoint));
+                    if (!grown) {
+                        log_error("Error allocating a %zu point path", path_length);
                         break;
                     }
+                    points = grown;
+                    point_capacity = capacity;
                 }
 
-                if (!grid_file) {
-                    // Check if file exists
-                    struct stat st;
-                    int file_exists = (stat(filename, &st) == 0);
-
-                    // Add new grid file
-                    if (grid_files_count >= grid_files_capacity) {
-                        grid_files_capacity = grid_files_capacity == 0 ? 16 : grid_files_capacity * 2;
-                        grid_files = realloc(grid_files, grid_files_capacity * sizeof(GridFile));
-                    }
-
-                    grid_file = &grid_files[grid_files_count++];
-                    grid_file->filename = strdup(filename);
-                    grid_file->file = fopen(filename, "a");
-                    grid_file->is_new = !file_exists;
-
-                    if (grid_file->is_new) {
-                        fprintf(grid_file->file, "advertiser_id;start_timestamp;path_points\n");
-                    }
+                // Every point of the path, timed from its start
+                for (size_t j = 0; j < path_length; j++) {
+                    const LocationPoint* point = &locations->points[i + j];
+                    points[j] = (PathStorePoint){ point->latitude, point->longitude,
+                                                  (int32_t)(point->timestamp - start->timestamp), point->speed, 0 };
                 }
 
-                if (grid_file->file) {
-                    // Create path line
-                    char path_line[MAX_PATH_LINE_LENGTH];
-                    char* current = path_line;
-                    int remaining = sizeof(path_line);
-
-                    // Write advertiser_id and start timestamp
-                    int written = snprintf(current, remaining, "%s;%ld;(", 
-                                         advertiser_id, start->timestamp);
-                    if (written >= 0 && written < remaining) {
-                        current += written;
-                        remaining -= written;
-                    }
-
-                    // Write all points in the path
-                    for (size_t j = 0; j < path_length; j++) {
-                        LocationPoint* point = &locations->points[i + j];
-                        if (j > 0) {
-                            written = snprintf(current, remaining, ",");
-                            if (written >= 0 && written < remaining) {
-                                current += written;
-                                remaining -= written;
-                            }
-                        }
-                        written = snprintf(current, remaining, "%.6f,%.6f,%.2f",
-                                         point->latitude, point->longitude, point->speed);
-                        if (written >= 0 && written < remaining) {
-                            current += written;
-                            remaining -= written;
-                        }
-                    }
-
-                    // Close the path
-                    written = snprintf(current, remaining, ")\n");
-                    if (written >= 0 && written < remaining) {
-                        current += written;
-                        remaining -= written;
-                    }
-
-                    // Write the complete path line
-                    fprintf(grid_file->file, "%s", path_line);
+                uint64_t write_start = run_clock_ns();
+                bool added = path_store_writer_add(paths, lat_grid, lon_grid, advertiser_id, strlen(advertiser_id),
+                                                   start->timestamp, points, path_length);
+                run_stage_add(STAGE_WRITE, write_start);
+                if (added) {
                     total_paths++;
-                    debug_log("Added path for advertiser %s to %s", advertiser_id, filename);
+                    counters->points += path_length;
+                    log_trace("Added path for advertiser %s to cell %d/%d",
+                              advertiser_id, lat_grid, lon_grid);
+                } else {
+                    log_error("Error storing path for cell %d/%d", lat_grid, lon_grid);
                 }
             }
 
             // Skip processed points
             i += path_length - 1;
         }
+        uint64_t segment_ns = run_clock_ns() - segment_start;
+        uint64_t written_ns = counters->stage_ns[STAGE_WRITE] - write_ns;
+        counters->stage_ns[STAGE_SEGMENT] += segment_ns > written_ns ? segment_ns - written_ns : 0;
     }
+    counters->devices += advertiser_count;
+    counters->paths += total_paths;
+
+    free(points);
+    free(sorter.scratch);
+    log_info("Sorted %d advertisers in %.3f s: %zu already in order, %zu insertion, %zu radix, %zu qsort",
+             advertiser_count, sorter.seconds, sorter.presorted, sorter.insertion, sorter.radix, sorter.fallback);
+    log_info("Processed %d advertisers, created %d paths", advertiser_count, total_paths);
+    location_map_iterator_destroy(iterator);
+}
 
-    // Close all grid files
-    for (size_t i = 0; i < grid_files_count; i++) {
-        if (grid_files[i].file) {
-            fclose(grid_files[i].file);
+// Spill mode for a day too big for its share of --mem-limit: ingest into
+// advertiser-hash partitions on disk, then load and process one partition
+// at a time. Each advertiser's pings meet in one partition, so the paths
+// are the same as from one in-memory map.
+static void process_day_spilled(DayRunner* runner, const FileList* files, const char* day_name,
+                                size_t input_bytes, size_t estimate) {
+    size_t limit = runner->day_memory_limit;
+    size_t partitions = (estimate + limit / 2 - 1) / (limit / 2);
+    if (partitions < SPILL_MIN_PARTITIONS) partitions = SPILL_MIN_PARTITIONS;
+    size_t buffer_size = limit / 4 / partitions;
+    if (buffer_size > SPILL_BUFFER_BYTES) buffer_size = SPILL_BUFFER_BYTES;
+
+    budget_acquire(&runner->budget, limit);
+    SpillSet spill;
+    if (!spill_create(&spill, runner->spill_directory, partitions, buffer_size)) {
+        log_error("Error creating %zu spill runs in %s for day %s", partitions, runner->spill_directory, day_name);
+        budget_release(&runner->budget, limit);
+        return;
+    }
+    log_info("Day %s: map estimate %zu bytes over the %zu byte limit, spilling to %zu partitions",
+             day_name, estimate, limit, partitions);
+
+    struct timespec ingest_start, ingest_end;
+    clock_gettime(CLOCK_MONOTONIC, &ingest_start);
+    bool spilled = spill_day_directory(files, &spill, runner->ingest_threads);
+    clock_gettime(CLOCK_MONOTONIC, &ingest_end);
+    double ingest_seconds = elapsed_seconds(&ingest_start, &ingest_end);
+    log_info("Day %s: parsed %zu bytes in %.3f s (%.2f GB/s, %s scanner)",
+             day_name, input_bytes, ingest_seconds,
+             ingest_seconds > 0 ? input_bytes / ingest_seconds / 1e9 : 0.0, csv_scanner_name());
+    if (!spilled) {
+        log_error("Error writing spill runs for day %s", day_name);
+    }
+
+    for (size_t p = 0; spilled && p < partitions; p++) {
+        LocationMap* map = location_map_create(1000);
+        if (!map || !load_spill_partition(&spill, p, map)) {
+            log_error("Error loading spill partition %zu of day %s", p, day_name);
+            location_map_destroy(map);
+            break;
         }
-        free(grid_files[i].filename);
+        run_stats_map(map->devices.size, map->devices.resize_count);
+        log_info("Day %s: partition %zu/%zu: %llu bytes spilled, %zu entries, %zu pings, %zu bytes",
+                 day_name, p + 1, partitions, (unsigned long long)spill.partitions[p].bytes,
+                 map->devices.size, map->ping_count, location_map_memory_usage(map));
+        spill_release(&spill, p);
+        process_advertiser_data(map, &runner->paths);
+        location_map_destroy(map);
     }
-    free(grid_files);
 
-    debug_log("Processed %d advertisers, created %d paths", advertiser_count, total_paths);
-    hashmap_iterator_destroy(iterator);
+    spill_destroy(&spill);
+    budget_release(&runner->budget, limit);
 }
 
-int main(int argc, char* argv[]) {
-    if (argc != 2) {
-        printf("Usage: %s <directory>\n", argv[0]);
-        return 1;
+// Process one day directory end to end: ingest, build paths, free the map.
+// Runs on a day worker; the memory budget bounds how many maps are alive.
+static void process_day_task(const char* day_path, size_t worker, void* context) {
+    (void)worker;
+    DayRunner* runner = context;
+    const char* day_name = strrchr(day_path, '/');
+    day_name = day_name ? day_name + 1 : day_path;
+
+    log_info("\nProcessing day: %s", day_name);
+
+    FileList files = {0};
+    file_list_scan(&files, day_path, ".csv");
+    file_list_scan(&files, day_path, ".parquet");
+    file_list_scan(&files, day_path, ".ping");
+    if (files.count == 0) {
+        log_info("No CSV, Parquet or ping files in directory: %s", day_path);
+        file_list_free(&files);
+        return;
     }
 
-    debug_log("Starting location processor...");
-    debug_log("Input directory: %s", argv[1]);
-
-    // Create base paths directory
-    ensure_directory_exists("paths");
-    debug_log("Created paths directory");
-
-    // Get list of day directories
-    DIR* root_dir = opendir(argv[1]);
-    if (!root_dir) {
-        debug_log("Error opening root directory: %s", argv[1]);
-        return 1;
+    // Reserve an estimate before the map exists, then true it up once built
+    size_t input_bytes = 0;
+    size_t reserved = 0;
+    for (size_t i = 0; i < files.count; i++) {
+        struct stat st;
+        if (stat(files.paths[i], &st) != 0) continue;
+        input_bytes += (size_t)st.st_size;
+        reserved += ping_is_file_name(files.paths[i]) ? PING_FILE_MAP_ESTIMATE((size_t)st.st_size)
+                                                      : DAY_MAP_ESTIMATE((size_t)st.st_size);
+    }
+    run_counters()->bytes += input_bytes;
+    if (runner->day_memory_limit > 0 && reserved > runner->day_memory_limit / 2) {
+        process_day_spilled(runner, &files, day_name, input_bytes, reserved);
+        file_list_free(&files);
+        log_info("Completed processing day: %s", day_name);
+        return;
+    }
+    budget_acquire(&runner->budget, reserved);
+
+    // Create new hashmap for this day
+    LocationMap* map = location_map_create(1000);
+    if (!map) {
+        log_error("Error creating hashmap for day %s", day_name);
+        budget_release(&runner->budget, reserved);
+        file_list_free(&files);
+        return;
     }
 
-    struct dirent* entry;
-    while ((entry = readdir(root_dir)) != NULL) {
-        // Skip . and .. directories
-        if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0) {
-            continue;
-        }
-
-        char day_path[1024];
-        snprintf(day_path, sizeof(day_path), "%s/%s", argv[1], entry->d_name);
+    // Process all CSV and Parquet files in this day's directory
+    log_debug("Processing day directory: %s", day_path);
+    struct timespec ingest_start, ingest_end;
+    clock_gettime(CLOCK_MONOTONIC, &ingest_start);
+    process_day_directory(&files, map, runner->ingest_threads);
+    clock_gettime(CLOCK_MONOTONIC, &ingest_end);
+    file_list_free(&files);
+
+    double ingest_seconds = elapsed_seconds(&ingest_start, &ingest_end);
+    log_info("Day %s: parsed %zu bytes in %.3f s (%.2f GB/s, %s scanner)",
+             day_name, input_bytes, ingest_seconds,
+             ingest_seconds > 0 ? input_bytes / ingest_seconds / 1e9 : 0.0, csv_scanner_name());
+
+    run_stats_map(map->devices.size, map->devices.resize_count);
+    size_t used = location_map_memory_usage(map);
+    budget_adjust(&runner->budget, reserved, used);
+    reserved = used;
+    log_info("Day %s: hashmap contains %zu entries, %zu pings, %zu bytes",
+             day_name, map->devices.size, map->ping_count, used);
+
+    // Process all advertisers and create travel paths
+    process_advertiser_data(map, &runner->paths);
+
+    // Cleanup hashmap for this day
+    location_map_destroy(map);
+    budget_release(&runner->budget, reserved);
+    log_info("Completed processing day: %s", day_name);
+}
 
-        struct stat st;
-        if (stat(day_path, &st) == -1 || !S_ISDIR(st.st_mode)) {
-            continue;
-        }
+static void usage(const char* program) {
+    printf("Usage: %s [-j threads] [-d days] [-m budget_mb] [-o paths.store] [--mem-limit mb] "
+           "[--spill-dir directory] [--report run_report.json] [--huge-pages] <directory>\n", program);
+}
 
-        debug_log("\nProcessing day: %s", entry->d_name);
+enum { OPT_MEM_LIMIT = 256, OPT_SPILL_DIR, OPT_REPORT, OPT_HUGE_PAGES };
+static const struct option LONG_OPTIONS[] = {
+    { "mem-limit", required_argument, NULL, OPT_MEM_LIMIT },
+    { "spill-dir", required_argument, NULL, OPT_SPILL_DIR },
+    { "report", required_argument, NULL, OPT_REPORT },
+    { "huge-pages", no_argument, NULL, OPT_HUGE_PAGES },
+    { NULL, 0, NULL, 0 }
+};
 
-        // Create new hashmap for this day
-        HashMap* map = hashmap_create(1000);
-        if (!map) {
-            debug_log("Error creating hashmap for day %s", entry->d_name);
-            continue;
+int main(int argc, char* argv[]) {
+    DayRunner runner = { .ingest_threads = 1 };
+    size_t parallel_days = 1;
+    size_t memory_limit = 0;
+    const char* output_path = DEFAULT_PATH_STORE;
+    const char* report_path = DEFAULT_RUN_REPORT;
+    const char* tmpdir = getenv("TMPDIR");
+    runner.spill_directory = tmpdir && *tmpdir ? tmpdir : "/tmp";
+    int opt;
+    while ((opt = getopt_long(argc, argv, "j:d:m:o:", LONG_OPTIONS, NULL)) != -1) {
+        switch (opt) {
+            case 'j':
+                runner.ingest_threads = strtoul(optarg, NULL, 10);
+                if (runner.ingest_threads < 1) runner.ingest_threads = 1;
+                break;
+            case 'd':
+                parallel_days = strtoul(optarg, NULL, 10);
+                if (parallel_days < 1) parallel_days = 1;
+                break;
+            case 'm':
+                runner.budget.limit = (size_t)strtoull(optarg, NULL, 10) << 20;
+                break;
+            case 'o':
+                output_path = optarg;
+                break;
+            case OPT_MEM_LIMIT:
+                memory_limit = (size_t)strtoull(optarg, NULL, 10) << 20;
+                break;
+            case OPT_SPILL_DIR:
+                runner.spill_directory = optarg;
+                break;
+            case OPT_REPORT:
+                report_path = optarg;
+                break;
+            case OPT_HUGE_PAGES:
+                arena_set_huge_pages(true);
+                break;
+            default:
+                usage(argv[0]);
+                return 1;
         }
+    }
+    if (argc - optind != 1) {
+        usage(argv[0]);
+        return 1;
+    }
+    const char* input_dir = argv[optind];
+    runner.day_memory_limit = memory_limit / parallel_days;
+    pthread_mutex_init(&runner.budget.lock, NULL);
+    pthread_cond_init(&runner.budget.released, NULL);
+    run_stats_start();
+
+    log_info("Starting location processor...");
+    log_info("Input directory: %s (%zu days at a time, %zu ingest threads per day)",
+             input_dir, parallel_days, runner.ingest_threads);
+    if (memory_limit > 0) {
+        log_info("Memory limit: %zu MB (%zu MB a day), spilling to %s",
+                 memory_limit >> 20, runner.day_memory_limit >> 20, runner.spill_directory);
+    }
 
-        // Process all CSV files in this day's directory
-        process_day_directory(day_path, map);
-
-        debug_log("Day %s: hashmap contains %zu entries", entry->d_name, map->size);
-
-        // Process all advertisers and create travel paths
-        process_advertiser_data(map);
+    // Get list of day directories
+    FileList days = {0};
+    if (file_list_scan_dirs(&days, input_dir) == 0) {
+        log_error("Error opening root directory or no day directories: %s", input_dir);
+        file_list_free(&days);
+        return 1;
+    }
 
-        // Cleanup hashmap for this day
-        hashmap_destroy(map);
-        debug_log("Completed processing day: %s", entry->d_name);
+    // All days' paths go to one store, sorted and indexed once they are in
+    if (!path_store_writer_open(&runner.paths, output_path)) {
+        log_error("Error creating path store %s", output_path);
+        file_list_free(&days);
+        return 1;
     }
 
-    closedir(root_dir);
-    debug_log("Processing complete");
+    // Days are independent: run up to parallel_days of them at once
+    file_pool_run(&days, parallel_days, process_day_task, &runner);
+    file_list_free(&days);
+
+    size_t path_count = runner.paths.slot_count;
+    uint64_t point_count = runner.paths.point_count;
+    uint64_t write_start = run_clock_ns();
+    bool written = path_store_writer_close(&runner.paths);
+    run_stage_add(STAGE_WRITE, write_start);
+    if (!written) {
+        log_error("Error writing path store %s", output_path);
+        return 1;
+    }
+    log_info("Wrote %zu paths (%llu points) to %s", path_count, (unsigned long long)point_count, output_path);
+    pthread_cond_destroy(&runner.budget.released);
+    pthread_mutex_destroy(&runner.budget.lock);
+    if (!run_stats_write_report(report_path, "location_processor")) {
+        log_error("Error writing run report %s", report_path);
+    }
+    log_info("Processing complete (peak RSS %zu MB)", run_peak_rss_bytes() >> 20);
     return 0;
-} 
\ No newline at end of file
+}
@@ -20,10 +20,14 @@ echo "Script directory: $SCRIPT_DIR"
 echo "Root directory: $ROOT_DIR"
 echo "July CSV directory: $JULY_CSV_DIR"
 
-# Check if july_csv directory exists
+# Without july_csv, run on a small synthetic day from ping_gen instead
 if [ ! -d "$JULY_CSV_DIR" ]; then
-    echo -e "${RED}Error: july_csv directory not found at $JULY_CSV_DIR${NC}"
-    exit 1
+    echo -e "${YELLOW}july_csv not found at $JULY_CSV_DIR, generating synthetic pings${NC}"
+    make -C "$ROOT_DIR/C_Custom_Files" ping_gen
+    INPUT_DIR="$(mktemp -d)"
+    trap 'rm -rf "$INPUT_DIR"' EXIT
+    "$ROOT_DIR/C_Custom_Files/ping_gen" -n 200000 -f 50000 "$INPUT_DIR/day1"
+    JULY_CSV_DIR="$INPUT_DIR"
 fi
 
 # Check if july_csv directory has any CSV files
@@ -54,11 +58,9 @@ if [ $? -ne 0 ]; then
     exit 1
 fi
 
-# Create output directory if it doesn't exist
-mkdir -p paths
-
 # Run the processor
 echo "Running processor on july_csv directory..."
+rm -f paths.store
 ./location_processor "$JULY_CSV_DIR"
 
 # Check if the processor ran successfully
@@ -67,42 +69,23 @@ if [ $? -ne 0 ]; then
     exit 1
 fi
 
-# Verify output structure
-echo "Verifying output structure..."
-
-# Check if paths directory was created
-if [ ! -d "paths" ]; then
-    echo -e "${RED}Error: paths directory not created${NC}"
+# Verify the path store
+echo "Verifying output..."
+if [ ! -s "paths.store" ]; then
+    echo -e "${RED}Error: paths.store not created${NC}"
     exit 1
 fi
 
-# Count the number of grid directories
-grid_dirs=$(find paths -type d | wc -l)
-echo "Found $grid_dirs grid directories"
-
-# Count the number of path files
-path_files=$(find paths -type f -name "*.csv" | wc -l)
-echo "Found $path_files path files"
-
-# Check if we have any output
-if [ $path_files -eq 0 ]; then
-    echo -e "${RED}Error: No path files were generated${NC}"
+make -C "$ROOT_DIR/C_Custom_Files" path_dump
+path_lines=$("$ROOT_DIR/C_Custom_Files/path_dump" paths.store | tail -n +2 | wc -l)
+echo "Found $path_lines paths"
+if [ "$path_lines" -eq 0 ]; then
+    echo -e "${RED}Error: No paths were generated${NC}"
     exit 1
 fi
 
-# Sample a few path files to verify content
-echo "Sampling path files..."
-for file in $(find paths -type f -name "*.csv" | head -n 3); do
-    echo "Checking file: $file"
-    # Check if file has header and at least one data point
-    if [ $(wc -l < "$file") -lt 2 ]; then
-        echo -e "${RED}Error: File $file is empty or missing data${NC}"
-        exit 1
-    fi
-    # Display first few lines
-    echo "First few lines of $file:"
-    head -n 3 "$file"
-done
+echo "First few paths:"
+"$ROOT_DIR/C_Custom_Files/path_dump" paths.store 2> /dev/null | head -n 4 | cut -c1-160
 
 echo -e "${GREEN}Test completed successfully!${NC}"
-echo "Generated $path_files path files in $grid_dirs grid directories" 
\ No newline at end of file
+echo "Generated $path_lines paths in paths.store"